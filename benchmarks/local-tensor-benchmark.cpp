@@ -0,0 +1,276 @@
+/*
+ * /benchmarks/local-tensor-benchmark.cpp
+ *
+ * Benchmarks for converting data in and out of ScortchLocalTensor
+ * and for the cost of the GObject machinery around it.
+ *
+ * Copyright (C) 2018 Sam Spilsbury.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string>
+#include <vector>
+
+#include <glib.h>
+#include <glib-object.h>
+
+#include <benchmark/benchmark.h>
+
+#include <scortch/local-tensor.h>
+
+#include <scortch/tensor-test-helpers.h>
+
+using scortch_test::dimensions_variant;
+
+namespace {
+  /* Every shape holds the same number of elements, so that the
+   * throughput of different ranks can be compared directly. The
+   * last shape has very short rows, where the cost of building
+   * one GVariant per row dominates. */
+  std::vector <std::vector <int64_t>> const shapes = {
+    { 65536 },
+    { 256, 256 },
+    { 16, 64, 64 },
+    { 16, 16, 16, 16 },
+    { 16384, 4 }
+  };
+
+  std::vector <ScortchDType> const dtypes = {
+    SCORTCH_DTYPE_FLOAT64,
+    SCORTCH_DTYPE_FLOAT32,
+    SCORTCH_DTYPE_INT64,
+    SCORTCH_DTYPE_UINT8
+  };
+
+  size_t dtype_size (ScortchDType dtype)
+  {
+    switch (dtype)
+      {
+        case SCORTCH_DTYPE_FLOAT64:
+        case SCORTCH_DTYPE_INT64:
+          return 8;
+        case SCORTCH_DTYPE_FLOAT32:
+        case SCORTCH_DTYPE_INT32:
+          return 4;
+        case SCORTCH_DTYPE_FLOAT16:
+        case SCORTCH_DTYPE_BFLOAT16:
+          return 2;
+        case SCORTCH_DTYPE_UINT8:
+        case SCORTCH_DTYPE_BOOL:
+          return 1;
+      }
+
+    g_assert_not_reached ();
+  }
+
+  int64_t n_elements (std::vector <int64_t> const &shape)
+  {
+    int64_t n = 1;
+
+    for (int64_t dimension : shape)
+      n *= dimension;
+
+    return n;
+  }
+
+  std::string describe (std::vector <int64_t> const &shape, ScortchDType dtype)
+  {
+    GEnumClass *dtype_class = G_ENUM_CLASS (g_type_class_ref (SCORTCH_TYPE_DTYPE));
+    std::string label = g_enum_get_value (dtype_class, dtype)->value_nick;
+
+    g_type_class_unref (dtype_class);
+
+    label += " [";
+
+    for (size_t i = 0; i < shape.size (); ++i)
+      label += (i == 0 ? "" : ", ") + std::to_string (shape[i]);
+
+    return label + "]";
+  }
+
+  /* A tensor of the given shape and dtype filled with a repeating
+   * byte pattern, which is a valid value for every dtype we use. */
+  ScortchLocalTensor * pattern_tensor (std::vector <int64_t> const &shape,
+                                       ScortchDType                 dtype)
+  {
+    size_t size = n_elements (shape) * dtype_size (dtype);
+    std::vector <guint8> pattern (size);
+
+    for (size_t i = 0; i < size; ++i)
+      pattern[i] = i % 64;
+
+    g_autoptr(GBytes) bytes = g_bytes_new (pattern.data (), size);
+
+    return scortch_local_tensor_new_from_bytes (bytes,
+                                                dimensions_variant (shape),
+                                                dtype,
+                                                nullptr);
+  }
+
+  void apply_conversion_arguments (benchmark::internal::Benchmark *benchmark)
+  {
+    for (size_t shape = 0; shape < shapes.size (); ++shape)
+      for (size_t dtype = 0; dtype < dtypes.size (); ++dtype)
+        benchmark->Args ({ static_cast <int64_t> (shape), static_cast <int64_t> (dtype) });
+  }
+
+  void set_throughput (benchmark::State             &state,
+                       std::vector <int64_t> const &shape,
+                       ScortchDType                 dtype)
+  {
+    state.SetItemsProcessed (state.iterations () * n_elements (shape));
+    state.SetBytesProcessed (state.iterations () * n_elements (shape) * dtype_size (dtype));
+    state.SetLabel (describe (shape, dtype));
+  }
+}
+
+static void
+BM_LocalTensorSetData (benchmark::State &state)
+{
+  auto const &shape = shapes[state.range (0)];
+  ScortchDType dtype = dtypes[state.range (1)];
+  g_autoptr(ScortchLocalTensor) source = pattern_tensor (shape, dtype);
+  g_autoptr(GVariant) data = scortch_local_tensor_get_data (source, nullptr);
+  g_autoptr(ScortchLocalTensor) tensor = scortch_local_tensor_new ();
+
+  scortch_local_tensor_set_dtype (tensor, dtype);
+
+  for (auto _ : state)
+    {
+      g_autoptr(GError) error = nullptr;
+
+      if (!scortch_local_tensor_set_data (tensor, data, &error))
+        {
+          state.SkipWithError (error->message);
+          break;
+        }
+    }
+
+  set_throughput (state, shape, dtype);
+}
+BENCHMARK (BM_LocalTensorSetData)->Apply (apply_conversion_arguments);
+
+static void
+BM_LocalTensorGetData (benchmark::State &state)
+{
+  auto const &shape = shapes[state.range (0)];
+  ScortchDType dtype = dtypes[state.range (1)];
+  g_autoptr(ScortchLocalTensor) tensor = pattern_tensor (shape, dtype);
+
+  for (auto _ : state)
+    {
+      g_autoptr(GError) error = nullptr;
+      g_autoptr(GVariant) data = scortch_local_tensor_get_data (tensor, &error);
+
+      if (data == nullptr)
+        {
+          state.SkipWithError (error->message);
+          break;
+        }
+
+      benchmark::DoNotOptimize (data);
+    }
+
+  set_throughput (state, shape, dtype);
+}
+BENCHMARK (BM_LocalTensorGetData)->Apply (apply_conversion_arguments);
+
+static void
+BM_LocalTensorNewFinalize (benchmark::State &state)
+{
+  for (auto _ : state)
+    {
+      ScortchLocalTensor *tensor = scortch_local_tensor_new ();
+
+      benchmark::DoNotOptimize (tensor);
+      g_object_unref (tensor);
+    }
+}
+BENCHMARK (BM_LocalTensorNewFinalize);
+
+static void
+BM_LocalTensorNewWithPropertiesFinalize (benchmark::State &state)
+{
+  std::vector <int64_t> const shape = { 16, 16 };
+
+  for (auto _ : state)
+    {
+      gpointer tensor = g_object_new (SCORTCH_TYPE_LOCAL_TENSOR,
+                                      "dimensions", dimensions_variant (shape),
+                                      "dtype", SCORTCH_DTYPE_FLOAT32,
+                                      NULL);
+
+      benchmark::DoNotOptimize (tensor);
+      g_object_unref (tensor);
+    }
+}
+BENCHMARK (BM_LocalTensorNewWithPropertiesFinalize);
+
+static void
+BM_LocalTensorGetDTypeProperty (benchmark::State &state)
+{
+  g_autoptr(ScortchLocalTensor) tensor = scortch_local_tensor_new ();
+
+  for (auto _ : state)
+    {
+      ScortchDType dtype;
+
+      g_object_get (tensor, "dtype", &dtype, NULL);
+      benchmark::DoNotOptimize (dtype);
+    }
+}
+BENCHMARK (BM_LocalTensorGetDTypeProperty);
+
+static void
+BM_LocalTensorSetDTypeProperty (benchmark::State &state)
+{
+  g_autoptr(ScortchLocalTensor) tensor = scortch_local_tensor_new ();
+  int64_t i = 0;
+
+  for (auto _ : state)
+    g_object_set (tensor,
+                  "dtype", (i++ % 2) ? SCORTCH_DTYPE_FLOAT64 : SCORTCH_DTYPE_FLOAT32,
+                  NULL);
+}
+BENCHMARK (BM_LocalTensorSetDTypeProperty);
+
+static void
+BM_LocalTensorGetDimensionsProperty (benchmark::State &state)
+{
+  g_autoptr(ScortchLocalTensor) tensor = pattern_tensor ({ 16, 16 }, SCORTCH_DTYPE_FLOAT64);
+
+  for (auto _ : state)
+    {
+      g_autoptr(GVariant) dimensions = nullptr;
+
+      g_object_get (tensor, "dimensions", &dimensions, NULL);
+      benchmark::DoNotOptimize (dimensions);
+    }
+}
+BENCHMARK (BM_LocalTensorGetDimensionsProperty);
+
+static void
+BM_LocalTensorSetDimensionsProperty (benchmark::State &state)
+{
+  g_autoptr(ScortchLocalTensor) tensor = scortch_local_tensor_new ();
+  g_autoptr(GVariant) dimensions = g_variant_ref_sink (dimensions_variant ({ 16, 16 }));
+
+  for (auto _ : state)
+    g_object_set (tensor, "dimensions", dimensions, NULL);
+}
+BENCHMARK (BM_LocalTensorSetDimensionsProperty);
+
+BENCHMARK_MAIN ();
@@ -0,0 +1,142 @@
+#include <benchmark/benchmark.h>
+
+#include <torch/torch.h>
+
+#include <algorithm>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <tuple>
+
+#include "cbow-language-modeller.h"
+#include "vocabulary.h"
+
+namespace {
+  constexpr int64_t vocabulary_size = 1000;
+  constexpr int64_t corpus_size = 100000;
+  constexpr size_t context_size = 2;
+  constexpr size_t embedding_dim = 10;
+  constexpr size_t fully_connected_layer_dim = 128;
+  constexpr int64_t steps_per_iteration = 64;
+
+  // Discards everything written to it, so that formatting the
+  // predictions is measured without any I/O.
+  class NullBuffer: public std::streambuf {
+  protected:
+    int overflow(int c) override {
+      return traits_type::not_eof(c);
+    }
+
+    std::streamsize xsputn(char const *, std::streamsize n) override {
+      return n;
+    }
+  };
+
+  // A synthetic corpus of uniformly distributed words, which is
+  // enough to give the model realistically shaped work.
+  struct Corpus {
+    Corpus() {
+      torch::manual_seed(0);
+
+      for (int64_t i = 1; i < vocabulary_size; ++i) {
+        vocabulary.intern("w" + std::to_string(i));
+      }
+
+      vocabulary.freeze();
+
+      auto token_ids = torch::randint(vocabulary_size, {corpus_size}, torch::kInt64);
+      std::tie(context_indices, targets) = cbow::make_training_tensors(token_ids, context_size);
+    }
+
+    corpus::Vocabulary vocabulary;
+    torch::Tensor context_indices;
+    torch::Tensor targets;
+  };
+
+  Corpus const &corpus() {
+    static Corpus const instance;
+    return instance;
+  }
+}
+
+// One iteration is an epoch of steps_per_iteration optimizer
+// steps of the given batch size, on the given number of threads.
+static void BM_CBOWTrainSteps(benchmark::State &state) {
+  auto batch_size = state.range(0);
+  auto n_threads = state.range(1);
+  auto const &data = corpus();
+  auto n_contexts = std::min(batch_size * steps_per_iteration * n_threads,
+                             data.context_indices.size(0));
+  auto context_indices = data.context_indices.slice(0, 0, n_contexts);
+  auto targets = data.targets.slice(0, 0, n_contexts);
+  cbow::CBOWLanguageModeller model(vocabulary_size,
+                                   embedding_dim,
+                                   fully_connected_layer_dim,
+                                   context_size);
+
+  auto intra_op_threads = torch::get_num_threads();
+
+  // As in predict-words, Hogwild threads each run with a single
+  // intra-op thread.
+  if (n_threads > 1) {
+    torch::set_num_threads(1);
+  }
+
+  for (auto _ : state) {
+    cbow::train_cbow_language_modeller(model,
+                                       context_indices,
+                                       targets,
+                                       1,
+                                       batch_size,
+                                       n_threads,
+                                       0.1,
+                                       false);
+  }
+
+  torch::set_num_threads(intra_op_threads);
+
+  auto n_steps = (n_contexts + batch_size - 1) / batch_size;
+
+  state.counters["steps_per_second"] = benchmark::Counter(n_steps,
+                                                          benchmark::Counter::kIsIterationInvariantRate);
+  state.counters["contexts_per_second"] = benchmark::Counter(n_contexts,
+                                                             benchmark::Counter::kIsIterationInvariantRate);
+}
+BENCHMARK(BM_CBOWTrainSteps)
+  ->ArgNames({"batch_size", "threads"})
+  ->Args({1, 1})
+  ->Args({32, 1})
+  ->Args({256, 1})
+  ->Args({256, 4})
+  ->Unit(benchmark::kMillisecond)
+  ->UseRealTime();
+
+// One iteration predicts the top k words for every context in
+// the corpus, chunk_size contexts per forward pass.
+static void BM_CBOWPredictContexts(benchmark::State &state) {
+  auto k = state.range(0);
+  auto chunk_size = state.range(1);
+  auto const &data = corpus();
+  cbow::CBOWLanguageModeller model(vocabulary_size,
+                                   embedding_dim,
+                                   fully_connected_layer_dim,
+                                   context_size);
+  NullBuffer buffer;
+  std::ostream out(&buffer);
+
+  for (auto _ : state) {
+    cbow::predict_top_k_words(model, data.vocabulary, data.context_indices, k, chunk_size, out);
+  }
+
+  state.counters["contexts_per_second"] = benchmark::Counter(data.context_indices.size(0),
+                                                             benchmark::Counter::kIsIterationInvariantRate);
+}
+BENCHMARK(BM_CBOWPredictContexts)
+  ->ArgNames({"k", "chunk_size"})
+  ->Args({1, 256})
+  ->Args({1, 4096})
+  ->Args({5, 4096})
+  ->Unit(benchmark::kMillisecond)
+  ->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,210 @@
+#include "cbow-language-modeller.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace cbow {
+  CBOWLanguageModeller::CBOWLanguageModeller(size_t vocab_size,
+                                             size_t embedding_dim,
+                                             size_t fully_connected_layer_dim,
+                                             size_t context_size) :
+    vocab_size(vocab_size),
+    embedding_dim(embedding_dim),
+    fully_connected_layer_dim(fully_connected_layer_dim),
+    context_size(context_size),
+    embedding(register_module("embedding",
+                              torch::nn::Embedding(vocab_size, embedding_dim))),
+    fc1(register_module("fc1", torch::nn::Linear(embedding_dim * context_size * 2,
+                                                 fully_connected_layer_dim))),
+    fc2(register_module("fc2", torch::nn::Linear(fully_connected_layer_dim, vocab_size)))
+  {
+  }
+
+  torch::Tensor CBOWLanguageModeller::forward(torch::Tensor x) {
+    if (x.dim() == 1) {
+      x = x.unsqueeze(0);
+    }
+
+    x = torch::relu(fc1->forward(embedding->forward(x).view({x.size(0), -1})));
+    return torch::log_softmax(fc2->forward(x), 1);
+  }
+
+  std::unique_ptr<CBOWLanguageModeller> CBOWLanguageModeller::make_shared_replica() {
+    auto replica = std::make_unique<CBOWLanguageModeller>(vocab_size,
+                                                          embedding_dim,
+                                                          fully_connected_layer_dim,
+                                                          context_size);
+    auto parameters = this->parameters();
+    auto replica_parameters = replica->parameters();
+
+    for (size_t i = 0; i < parameters.size(); ++i) {
+      replica_parameters[i].set_data(parameters[i]);
+    }
+
+    return replica;
+  }
+
+  // The windows are gathered with unfold rather than one token
+  // at a time.
+  std::tuple<torch::Tensor, torch::Tensor>
+  make_training_tensors(torch::Tensor const &token_ids, size_t context_size) {
+    auto n = static_cast<int64_t>(context_size);
+
+    if (token_ids.size(0) < 2 * n + 1) {
+      return std::make_tuple(torch::empty({0, 2 * n}, torch::kInt64),
+                             torch::empty({0}, torch::kInt64));
+    }
+
+    auto windows = token_ids.unfold(0, 2 * n + 1, 1);
+    auto targets = windows.select(1, n).clone();
+    auto context_indices = torch::cat({windows.slice(1, 0, n).flip({1}),
+                                       windows.slice(1, n + 1, 2 * n + 1)},
+                                      1);
+
+    return std::make_tuple(context_indices, targets);
+  }
+
+  namespace {
+    // Run one optimizer step per mini-batch of batch_size contexts
+    // from shard, so that the forward and backward passes are a few
+    // large matrix multiplications instead of many tiny ones. Returns
+    // the sum of the batch losses and the number of batches.
+    std::tuple<double, int64_t>
+    train_shard(CBOWLanguageModeller &model,
+                torch::optim::SGD &optimizer,
+                torch::Tensor const &context_indices,
+                torch::Tensor const &targets,
+                torch::Tensor const &shard,
+                int64_t batch_size) {
+      auto n_contexts = shard.size(0);
+      double total_loss = 0.0;
+      int64_t n_batches = 0;
+
+      for (int64_t start = 0; start < n_contexts; start += batch_size) {
+        auto batch = shard.slice(0, start, std::min(start + batch_size, n_contexts));
+        auto batch_contexts = context_indices.index_select(0, batch);
+        auto batch_targets = targets.index_select(0, batch);
+
+        optimizer.zero_grad();
+        auto prediction = model.forward(batch_contexts);
+        auto loss = torch::nll_loss(prediction, batch_targets);
+        loss.backward();
+        optimizer.step();
+
+        total_loss += loss.template item<float>();
+        ++n_batches;
+      }
+
+      return std::make_tuple(total_loss, n_batches);
+    }
+  }
+
+  double train_cbow_language_modeller(CBOWLanguageModeller &model,
+                                      torch::Tensor const &context_indices,
+                                      torch::Tensor const &targets,
+                                      size_t epochs,
+                                      size_t batch_size,
+                                      size_t n_threads,
+                                      float learning_rate,
+                                      bool verbose) {
+    std::vector<std::unique_ptr<CBOWLanguageModeller>> replicas;
+    std::vector<CBOWLanguageModeller *> models;
+    std::vector<std::unique_ptr<torch::optim::SGD>> optimizers;
+
+    n_threads = std::max<size_t>(n_threads, 1);
+
+    if (n_threads == 1) {
+      models.push_back(&model);
+    } else {
+      for (size_t i = 0; i < n_threads; ++i) {
+        replicas.push_back(model.make_shared_replica());
+        models.push_back(replicas.back().get());
+      }
+    }
+
+    for (auto replica : models) {
+      optimizers.push_back(std::make_unique<torch::optim::SGD>(replica->parameters(),
+                                                               torch::optim::SGDOptions(learning_rate)));
+    }
+
+    auto n_contexts = context_indices.size(0);
+    auto step = static_cast<int64_t>(std::max<size_t>(batch_size, 1));
+    auto start_time = std::chrono::steady_clock::now();
+
+    for (size_t epoch = 0; epoch < epochs; ++epoch) {
+      auto shards = torch::randperm(n_contexts, torch::kInt64).chunk(n_threads);
+      std::vector<std::tuple<double, int64_t>> losses(shards.size());
+      std::vector<std::thread> threads;
+
+      for (size_t i = 1; i < shards.size(); ++i) {
+        threads.emplace_back([&, i]() {
+          losses[i] = train_shard(*models[i], *optimizers[i], context_indices, targets, shards[i], step);
+        });
+      }
+
+      if (!shards.empty()) {
+        losses[0] = train_shard(*models[0], *optimizers[0], context_indices, targets, shards[0], step);
+      }
+
+      for (auto &thread : threads) {
+        thread.join();
+      }
+
+      double total_loss = 0.0;
+      int64_t n_batches = 0;
+
+      for (auto const &loss : losses) {
+        total_loss += std::get<0>(loss);
+        n_batches += std::get<1>(loss);
+      }
+
+      if (verbose) {
+        std::cout << "Epoch: " << epoch << " loss: " << total_loss / std::max<int64_t>(n_batches, 1) << std::endl;
+      }
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
+
+    return n_contexts * epochs / std::max(elapsed.count(), 1e-9);
+  }
+
+  // Only a [chunk_size, vocab] block of scores is alive at once.
+  // topk runs on the log-probabilities directly, since exp is
+  // monotonic, so only the k winners are exponentiated.
+  void
+  predict_top_k_words(CBOWLanguageModeller &model,
+                      corpus::Vocabulary const &vocabulary,
+                      torch::Tensor const &context_indices,
+                      int64_t k,
+                      int64_t chunk_size,
+                      std::ostream &out) {
+    torch::NoGradGuard guard{};
+    auto n_contexts = context_indices.size(0);
+
+    k = std::min<int64_t>(k, vocabulary.size());
+
+    for (int64_t start = 0; start < n_contexts; start += chunk_size) {
+      auto chunk = context_indices.slice(0, start, std::min(start + chunk_size, n_contexts));
+      torch::Tensor log_probabilities, indices;
+
+      std::tie(log_probabilities, indices) = model.forward(chunk).topk(k, 1);
+
+      auto probabilities = log_probabilities.exp();
+      auto probabilities_accessor = probabilities.accessor<float, 2>();
+      auto indices_accessor = indices.accessor<int64_t, 2>();
+
+      for (int64_t row = 0; row < probabilities.size(0); ++row) {
+        for (int64_t column = 0; column < k; ++column) {
+          out << (column == 0 ? "" : "|")
+              << vocabulary.word(indices_accessor[row][column])
+              << " (" << probabilities_accessor[row][column] << ")";
+        }
+
+        out << " ";
+      }
+    }
+  }
+}
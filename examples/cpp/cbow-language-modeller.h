@@ -0,0 +1,71 @@
+#pragma once
+
+#include <torch/torch.h>
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <tuple>
+
+#include "vocabulary.h"
+
+namespace cbow {
+  // Continuous bag-of-words language model: predicts a word from
+  // the embeddings of the context_size words on either side of it.
+  struct CBOWLanguageModeller: torch::nn::Module {
+    CBOWLanguageModeller(size_t vocab_size,
+                         size_t embedding_dim,
+                         size_t fully_connected_layer_dim,
+                         size_t context_size);
+
+    // Implement the Net's algorithm. x is either a single context
+    // of shape [2 * context] or a batch of shape [B, 2 * context].
+    torch::Tensor forward(torch::Tensor x);
+
+    // Create a model of the same shape whose parameters share
+    // storage with this one, so that optimizer steps on the
+    // replica update this model in place.
+    std::unique_ptr<CBOWLanguageModeller> make_shared_replica();
+
+    size_t const vocab_size;
+    size_t const embedding_dim;
+    size_t const fully_connected_layer_dim;
+    size_t const context_size;
+
+    torch::nn::Embedding embedding{nullptr};
+    torch::nn::Linear fc1{nullptr};
+    torch::nn::Linear fc2{nullptr};
+  };
+
+  // Build the context of every token that has context_size tokens
+  // on either side, as a [N, 2 * context_size] tensor of the
+  // preceding tokens nearest first followed by the following tokens,
+  // along with a [N] tensor of the tokens themselves.
+  std::tuple<torch::Tensor, torch::Tensor>
+  make_training_tensors(torch::Tensor const &token_ids, size_t context_size);
+
+  // Train on shuffled mini-batches and return the throughput in
+  // contexts per second. With more than one thread, training is
+  // Hogwild-style: each thread trains a replica sharing the
+  // parameters of model on its own shard of every epoch, and
+  // applies its updates without any locking.
+  double train_cbow_language_modeller(CBOWLanguageModeller &model,
+                                      torch::Tensor const &context_indices,
+                                      torch::Tensor const &targets,
+                                      size_t epochs,
+                                      size_t batch_size,
+                                      size_t n_threads,
+                                      float learning_rate,
+                                      bool verbose);
+
+  // Predict the k most likely words for every row of
+  // context_indices, running the model over chunk_size contexts at
+  // a time. Each context's predictions are written to out as
+  // "word (probability)", joined by '|' when k > 1.
+  void predict_top_k_words(CBOWLanguageModeller &model,
+                           corpus::Vocabulary const &vocabulary,
+                           torch::Tensor const &context_indices,
+                           int64_t k,
+                           int64_t chunk_size,
+                           std::ostream &out);
+}
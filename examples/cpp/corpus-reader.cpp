@@ -0,0 +1,144 @@
+#include "corpus-reader.h"
+
+#include <glib.h>
+#include <sys/mman.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <stdexcept>
+
+namespace corpus {
+  namespace {
+    inline bool is_token_byte(unsigned char c) {
+      return (c >= '0' && c <= '9') ||
+             (c >= 'A' && c <= 'Z') ||
+             (c >= 'a' && c <= 'z') ||
+             c >= 0x80;
+    }
+
+#if defined(__SSE2__)
+    // Bit i of the result is set if data[i] is a token byte. The
+    // range compares are signed, which is fine since all of the
+    // ranges are below 0x80, and bytes from 0x80 up are picked out
+    // by their sign bit.
+    inline uint32_t token_byte_mask(char const *data) {
+      __m128i const bytes = _mm_loadu_si128(reinterpret_cast<__m128i const *>(data));
+      auto in_range = [&bytes](char low, char high) {
+        return _mm_and_si128(_mm_cmpgt_epi8(bytes, _mm_set1_epi8(low - 1)),
+                             _mm_cmplt_epi8(bytes, _mm_set1_epi8(high + 1)));
+      };
+      __m128i const alphanumeric = _mm_or_si128(in_range('0', '9'),
+                                                _mm_or_si128(in_range('A', 'Z'),
+                                                             in_range('a', 'z')));
+
+      return static_cast<uint32_t>(_mm_movemask_epi8(alphanumeric) |
+                                   _mm_movemask_epi8(bytes));
+    }
+#endif
+  }
+
+  void
+  for_each_token(char const *data,
+                 size_t size,
+                 void (*on_token)(char const *, size_t, void *),
+                 void *user_data) {
+    size_t i = 0;
+    size_t token_start = 0;
+    bool in_token = false;
+
+#if defined(__SSE2__)
+    // Classify 16 bytes at a time, then jump between token
+    // boundaries within the block with count-trailing-zeros
+    // rather than testing every byte.
+    for (; i + 16 <= size; i += 16) {
+      uint32_t const token_bytes = token_byte_mask(data + i);
+      uint32_t const separator_bytes = ~token_bytes & 0xffff;
+      unsigned int position = 0;
+
+      while (position < 16) {
+        uint32_t const remaining = (in_token ? separator_bytes : token_bytes) >> position;
+
+        if (remaining == 0) {
+          break;
+        }
+
+        position += __builtin_ctz(remaining);
+
+        if (in_token) {
+          on_token(data + token_start, i + position - token_start, user_data);
+        } else {
+          token_start = i + position;
+        }
+
+        in_token = !in_token;
+      }
+    }
+#endif
+
+    for (; i < size; ++i) {
+      bool const token_byte = is_token_byte(static_cast<unsigned char>(data[i]));
+
+      if (token_byte && !in_token) {
+        token_start = i;
+      } else if (!token_byte && in_token) {
+        on_token(data + token_start, i - token_start, user_data);
+      }
+
+      in_token = token_byte;
+    }
+
+    if (in_token) {
+      on_token(data + token_start, size - token_start, user_data);
+    }
+  }
+
+  CorpusReader::CorpusReader(Vocabulary &vocabulary) :
+    vocabulary(vocabulary)
+  {
+  }
+
+  void
+  CorpusReader::read_file(std::string const &path) {
+    GError *error = nullptr;
+    GMappedFile *mapped_file = g_mapped_file_new(path.c_str(), FALSE, &error);
+
+    if (mapped_file == nullptr) {
+      std::string message(error->message);
+      g_error_free(error);
+      throw std::runtime_error(message);
+    }
+
+    char const *contents = g_mapped_file_get_contents(mapped_file);
+    size_t length = g_mapped_file_get_length(mapped_file);
+
+    // Empty files have no mapping at all
+    if (contents != nullptr) {
+      // The file is read front to back exactly once, so let the
+      // kernel read ahead aggressively and drop pages behind us.
+      madvise(const_cast<char *>(contents), length, MADV_SEQUENTIAL);
+
+      read_buffer(contents, length);
+    }
+
+    g_mapped_file_unref(mapped_file);
+  }
+
+  void
+  CorpusReader::read_buffer(char const *data, size_t size) {
+    for_each_token(data, size, CorpusReader::append_token, this);
+  }
+
+  std::vector<int64_t> const &
+  CorpusReader::token_ids() const {
+    return ids;
+  }
+
+  void
+  CorpusReader::append_token(char const *begin, size_t length, void *user_data) {
+    auto reader = static_cast<CorpusReader *>(user_data);
+
+    reader->ids.push_back(reader->vocabulary.intern(std::string_view(begin, length)));
+  }
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "vocabulary.h"
+
+namespace corpus {
+  // Call on_token(begin, length) for every run of ASCII letters,
+  // digits and non-ASCII bytes in data. ASCII whitespace, control
+  // characters and punctuation separate tokens and are dropped.
+  void for_each_token(char const *data,
+                      size_t size,
+                      void (*on_token)(char const *, size_t, void *),
+                      void *user_data);
+
+  // Memory-maps corpus files one at a time and tokenizes them
+  // straight into a contiguous buffer of token ids. The vocabulary
+  // copies each distinct word, so a file is unmapped as soon as it
+  // has been read.
+  class CorpusReader {
+  public:
+    explicit CorpusReader(Vocabulary &vocabulary);
+
+    // Throws std::runtime_error if path cannot be mapped.
+    void read_file(std::string const &path);
+
+    void read_buffer(char const *data, size_t size);
+
+    std::vector<int64_t> const & token_ids() const;
+
+  private:
+    static void append_token(char const *begin, size_t length, void *user_data);
+
+    Vocabulary &vocabulary;
+    std::vector<int64_t> ids;
+  };
+}
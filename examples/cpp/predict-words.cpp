@@ -3,12 +3,14 @@
 #include <torch/torch.h>
 
 #include <algorithm>
-#include <array>
-#include <iterator>
-#include <sstream>
+#include <iostream>
+#include <stdexcept>
 #include <string>
 #include <tuple>
-#include <unordered_map>
+#include <vector>
+
+#include "cbow-language-modeller.h"
+#include "corpus-reader.h"
 
 static char const *test_sentence = \
   "At this point, we have seen various feed-forward networks.\n"
@@ -28,185 +30,7 @@ static char const *test_sentence = \
   "the hidden state to predict words in a language model, part-of-speech tags,\n"
   "and a myriad of other things.";
 
-namespace {
-  const std::vector<std::string>
-  split_string(std::string const &str, char delimiter) {
-    std::vector<std::string> words;
-    std::string item;
-    std::stringstream ss(str);
-
-    while (std::getline(ss, item, delimiter)) {
-      words.push_back(item);
-    }
-
-    return words;
-  }
-
-  const std::vector<std::tuple<std::string, std::vector<std::string>>>
-  make_context_vector(std::vector <std::string> const &words, size_t n) {
-    std::vector <std::tuple<std::string, std::vector<std::string>>> contexts;
-
-    for (size_t i = n; i < words.size() - n; ++i) {
-      std::vector<std::string> context;
-      context.reserve(n * 2);
-
-      for (size_t j = 1; j < n + 1; ++j) {
-        context.emplace_back(words[i - j]);
-      }
-
-      for (size_t j = 1; j < n + 1; ++j) {
-        context.emplace_back(words[i + j]);
-      }
-
-      contexts.emplace_back(std::make_tuple(words[i], std::move(context)));
-    }
-
-    return contexts;
-  }
-
-  const std::unordered_map<std::string, int64_t>
-  make_dictionary(std::vector<std::string> const &words) {
-    std::unordered_map<std::string, int64_t> dictionary;
-    int64_t count = 0;
-
-    for (size_t i = 0; i < words.size(); ++i) {
-      if (dictionary.find(words[i]) == dictionary.end()) {
-        dictionary[words[i]] = count++;
-      }
-    }
-
-    return dictionary;
-  }
-
-  struct CBOWLanguageModeller: torch::nn::Module {
-    CBOWLanguageModeller(size_t vocab_size,
-                         size_t embedding_dim,
-                         size_t fully_connected_layer_dim,
-                         size_t context_size) :
-      embedding(register_module("embedding",
-                                torch::nn::Embedding(vocab_size, embedding_dim))),
-      fc1(register_module("fc1", torch::nn::Linear(embedding_dim * context_size * 2,
-                                                   fully_connected_layer_dim))),
-      fc2(register_module("fc2", torch::nn::Linear(fully_connected_layer_dim, vocab_size)))
-    {
-    }
-
-    // Implement the Net's algorithm.
-    torch::Tensor forward(torch::Tensor x) {
-      x = torch::relu(fc1->forward(embedding->forward(x).view({1, -1})));
-      return torch::log_softmax(fc2->forward(x), 1);
-    }
-
-    torch::nn::Embedding embedding{nullptr};
-    torch::nn::Linear fc1{nullptr};
-    torch::nn::Linear fc2{nullptr};
-  };
-
-  std::vector<int64_t>
-  words_to_indices(std::unordered_map<std::string, int64_t> const &vocab,
-                   std::vector<std::string>  const &words) {
-    std::vector<int64_t> indices;
-    indices.reserve(words.size());
-
-    for (auto const &word : words) {
-      indices.push_back(vocab.find(word)->second);
-    }
-
-    return indices;
-  }
-
-  template<typename T>
-  torch::Tensor
-  make_tensor_from_vector(std::vector<T> const &vec) {
-    auto tensor = torch::full({static_cast<int64_t>(vec.size())}, 0, torch::kInt64);
-
-    for (size_t i = 0; i < vec.size(); ++i) {
-      tensor[i] = torch::Scalar(vec[i]);
-    }
-
-    return tensor;
-  }
-
-  template<typename T>
-  std::vector<T>
-  scalar_to_vector(T const &t) {
-    std::vector<T> v;
-    v.emplace_back(t);
-    return v;
-  }
-
-  void train_cbow_language_modeller(CBOWLanguageModeller &model,
-                                    std::unordered_map<std::string, int64_t> const &vocab,
-                                    std::vector<std::tuple<std::string, std::vector<std::string>>> const &context,
-                                    size_t epochs,
-                                    float learning_rate) {
-    torch::optim::SGD optimizer(model.parameters(), torch::optim::SGDOptions(learning_rate));
-
-    for (size_t epoch = 0; epoch < epochs; ++epoch) {
-      for (auto const &tuple : context) {
-        auto word(make_tensor_from_vector(scalar_to_vector(vocab.find(std::get<0>(tuple))->second)));
-        auto context_indices(make_tensor_from_vector(words_to_indices(vocab, std::get<1>(tuple))));
-
-        optimizer.zero_grad();
-        auto prediction = model.forward(context_indices);
-        auto loss = torch::nll_loss(prediction, word);
-        loss.backward();
-        optimizer.step();
-
-        std::cout << "Epoch: " << epoch << " loss: " << *loss.template data<float>() << std::endl;
-      }
-    }
-  }
-
-  template <typename Map>
-  std::unordered_map<typename Map::mapped_type, typename Map::key_type>
-  reverse_map(Map const &m) {
-    std::unordered_map<typename Map::mapped_type, typename Map::key_type> reversed;
-
-    for (auto pair : m) {
-      reversed[pair.second] = pair.first;
-    }
-
-    return reversed;
-  }
-
-  std::tuple<std::string, float>
-  predict_word(CBOWLanguageModeller &model,
-               std::unordered_map<std::string, int64_t> const &in_vocab,
-               std::unordered_map<int64_t, std::string> const &out_vocab,
-               std::vector<std::string> const &context) {
-    torch::NoGradGuard guard{};
-    auto context_indices(make_tensor_from_vector(words_to_indices(in_vocab,
-                                                                  context)));
-    auto prediction = model.forward(context_indices);
-    torch::Tensor value, index;
-
-    std::tie(value, index) = torch::max(torch::exp(prediction), 1);
-
-    return std::make_tuple(out_vocab.find(*(index.template data<int64_t>()))->second,
-                           *value.template data<float>());
-  }
-
-  std::string
-  format_word_prediction_for(CBOWLanguageModeller &model,
-                             std::unordered_map<std::string, int64_t> const &in_vocab,
-                             std::unordered_map<int64_t, std::string> const &out_vocab,
-                             std::vector<std::string> const &context)
-  {
-    std::stringstream ss;
-    std::string word;
-    float probability;
-
-    std::tie(word, probability) = predict_word(model,
-                                               in_vocab,
-                                               out_vocab,
-                                               context);
-
-    ss << word << " (" << probability << ")";
-
-    return ss.str();
-  }
-}
+using cbow::CBOWLanguageModeller;
 
 int main(int argc, char **argv) {
   // Parse arguments
@@ -217,46 +41,127 @@ int main(int argc, char **argv) {
      cxxopts::value<unsigned int>()->default_value("2"))
     ("e,epochs", "Number of epochs to run for",
      cxxopts::value<unsigned int>()->default_value("50"))
+    ("b,batch-size", "Number of contexts per training step",
+     cxxopts::value<unsigned int>()->default_value("1"))
+    ("t,threads", "Number of threads to train with",
+     cxxopts::value<unsigned int>()->default_value("1"))
+    ("k,top-k", "Number of most likely words to predict for each context",
+     cxxopts::value<unsigned int>()->default_value("1"))
+    ("prediction-batch-size", "Number of contexts to predict words for in one forward pass",
+     cxxopts::value<unsigned int>()->default_value("4096"))
     ("l,learning-rate", "Learning rate",
      cxxopts::value<float>()->default_value("0.1"))
     ("s,sentence", "Training sentence",
      cxxopts::value<std::string>()->default_value(std::string(test_sentence)))
+    ("corpus", "Comma-separated training corpus files, used instead of --sentence",
+     cxxopts::value<std::vector<std::string>>())
+    ("m,min-count", "Treat words seen fewer times than this as unknown",
+     cxxopts::value<unsigned int>()->default_value("1"))
     ("d,embedding-dimensions", "Embedding dimensions",
      cxxopts::value<unsigned int>()->default_value("10"))
     ("f,fully-connected-layer-dimensions", "Fully connected layer dimensions",
      cxxopts::value<unsigned int>()->default_value("128"));
   auto result = options.parse(argc, argv);
 
-  // Construct vocabulary
+  // Tokenize the corpus straight into token ids, constructing
+  // the vocabulary as we go.
   auto context_window = result["context-window"].as<unsigned int>();
-  auto words = split_string(result["sentence"].as<std::string>(), ' ');
-  auto context = make_context_vector(words,
-                                     context_window);
-  auto vocab = make_dictionary(words);
-  auto indices_to_words = reverse_map(vocab);
+  auto sentence = result["sentence"].as<std::string>();
+  corpus::Vocabulary vocabulary;
+  corpus::CorpusReader reader(vocabulary);
+
+  try {
+    if (result.count("corpus")) {
+      for (auto const &path : result["corpus"].as<std::vector<std::string>>()) {
+        reader.read_file(path);
+      }
+    } else {
+      reader.read_buffer(sentence.data(), sentence.size());
+    }
+  } catch (std::runtime_error const &error) {
+    std::cerr << "Could not read corpus: " << error.what() << std::endl;
+    return 1;
+  }
+
+  auto const &token_ids = reader.token_ids();
+  auto token_ids_tensor = torch::from_blob(const_cast<int64_t *>(token_ids.data()),
+                                           {static_cast<int64_t>(token_ids.size())},
+                                           torch::kInt64);
+
+  // Rare words are folded into the unknown word, renumbering
+  // the token ids we already have in a single gather.
+  auto min_count = result["min-count"].as<unsigned int>();
+
+  if (min_count > 1) {
+    auto remap = vocabulary.prune(min_count);
+    auto remap_tensor = torch::from_blob(remap.data(),
+                                         {static_cast<int64_t>(remap.size())},
+                                         torch::kInt64);
+
+    token_ids_tensor = remap_tensor.index_select(0, token_ids_tensor);
+  }
+
+  vocabulary.freeze();
+  torch::Tensor context_indices, targets;
+
+  std::tie(context_indices, targets) = cbow::make_training_tensors(token_ids_tensor, context_window);
 
   // Create a new Net.
-  CBOWLanguageModeller model(vocab.size(),
+  CBOWLanguageModeller model(vocabulary.size(),
                              result["embedding-dimensions"].as<unsigned int>(),
                              result["fully-connected-layer-dimensions"].as<unsigned int>(),
                              context_window);
 
-  // Instantiate an SGD optimization algorithm to update our Net's parameters.
-  torch::optim::SGD optimizer(model.parameters(), torch::optim::SGDOptions(0.1));
+  auto n_threads = result["threads"].as<unsigned int>();
+  auto batch_size = result["batch-size"].as<unsigned int>();
+  auto learning_rate = result["learning-rate"].as<float>();
 
-  train_cbow_language_modeller(model,
-                               vocab,
-                               context,
-                               result["epochs"].as<unsigned int>(),
-                               result["learning-rate"].as<float>());
+  // Training threads each run their own operators, so intra-op
+  // parallelism would only oversubscribe the cores.
+  if (n_threads > 1) {
+    torch::set_num_threads(1);
+  }
 
-  for (size_t i = context_window; i < words.size() - context_window; ++i) {
-    std::cout << format_word_prediction_for(model,
-                                            vocab,
-                                            indices_to_words,
-                                            std::get<1>(context[i - context_window])) << " ";
+  auto contexts_per_second = cbow::train_cbow_language_modeller(model,
+                                                                context_indices,
+                                                                targets,
+                                                                result["epochs"].as<unsigned int>(),
+                                                                batch_size,
+                                                                n_threads,
+                                                                learning_rate,
+                                                                true);
+
+  std::cout << "Trained on " << contexts_per_second << " contexts/s with "
+            << n_threads << " thread(s)" << std::endl;
+
+  // Measure a single-threaded epoch on a throwaway model, so
+  // that the scaling can be reported without retraining.
+  if (n_threads > 1) {
+    CBOWLanguageModeller baseline(vocabulary.size(),
+                                  result["embedding-dimensions"].as<unsigned int>(),
+                                  result["fully-connected-layer-dimensions"].as<unsigned int>(),
+                                  context_window);
+    auto baseline_contexts_per_second = cbow::train_cbow_language_modeller(baseline,
+                                                                           context_indices,
+                                                                           targets,
+                                                                           1,
+                                                                           batch_size,
+                                                                           1,
+                                                                           learning_rate,
+                                                                           false);
+
+    std::cout << "Single-threaded baseline: " << baseline_contexts_per_second
+              << " contexts/s, speedup " << contexts_per_second / baseline_contexts_per_second
+              << "x" << std::endl;
   }
 
+  cbow::predict_top_k_words(model,
+                            vocabulary,
+                            context_indices,
+                            std::max(result["top-k"].as<unsigned int>(), 1u),
+                            std::max(result["prediction-batch-size"].as<unsigned int>(), 1u),
+                            std::cout);
+
   std::cout << "\n";
 
   return 0;
@@ -0,0 +1,156 @@
+#include "vocabulary.h"
+
+#include <cstring>
+
+namespace corpus {
+  namespace {
+    constexpr int32_t empty_slot = -1;
+    constexpr char const *unknown_word = "<unk>";
+
+    // FNV-1a, truncated to 32 bits. Only the low bits pick the
+    // slot, and the full value is compared before the bytes are.
+    inline uint32_t hash_word(std::string_view word) {
+      uint64_t hash = 14695981039346656037ull;
+
+      for (unsigned char c : word) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+      }
+
+      return static_cast<uint32_t>(hash ^ (hash >> 32));
+    }
+  }
+
+  Vocabulary::Vocabulary() :
+    offsets(1, 0),
+    slots(16, empty_slot),
+    is_frozen(false)
+  {
+    add(unknown_word, hash_word(unknown_word));
+  }
+
+  // Linear probing. Returns the slot holding word, or the
+  // empty slot where it would be inserted.
+  uint64_t
+  Vocabulary::find_slot(std::string_view word, uint32_t hash) const {
+    uint64_t const mask = slots.size() - 1;
+
+    for (uint64_t slot = hash & mask;; slot = (slot + 1) & mask) {
+      int32_t id = slots[slot];
+
+      if (id == empty_slot) {
+        return slot;
+      }
+
+      if (hashes[id] == hash &&
+          offsets[id + 1] - offsets[id] == word.size() &&
+          std::memcmp(arena.data() + offsets[id], word.data(), word.size()) == 0) {
+        return slot;
+      }
+    }
+  }
+
+  int64_t
+  Vocabulary::add(std::string_view word, uint32_t hash) {
+    // Keep the table at most half full so probe sequences stay short
+    if ((size() + 1) * 2 > slots.size()) {
+      rehash(slots.size() * 2);
+    }
+
+    int32_t id = static_cast<int32_t>(size());
+
+    arena.insert(arena.end(), word.begin(), word.end());
+    offsets.push_back(arena.size());
+    hashes.push_back(hash);
+    counts.push_back(0);
+    slots[find_slot(word, hash)] = id;
+
+    return id;
+  }
+
+  void
+  Vocabulary::rehash(size_t n_slots) {
+    uint64_t const mask = n_slots - 1;
+
+    slots.assign(n_slots, empty_slot);
+
+    for (size_t id = 0; id < size(); ++id) {
+      uint64_t slot = hashes[id] & mask;
+
+      while (slots[slot] != empty_slot) {
+        slot = (slot + 1) & mask;
+      }
+
+      slots[slot] = static_cast<int32_t>(id);
+    }
+  }
+
+  int64_t
+  Vocabulary::intern(std::string_view word) {
+    uint32_t hash = hash_word(word);
+    int32_t id = slots[find_slot(word, hash)];
+
+    if (id == empty_slot) {
+      id = is_frozen ? unknown_id : add(word, hash);
+    }
+
+    ++counts[id];
+
+    return id;
+  }
+
+  int64_t
+  Vocabulary::lookup(std::string_view word) const {
+    int32_t id = slots[find_slot(word, hash_word(word))];
+
+    return id == empty_slot ? unknown_id : id;
+  }
+
+  std::string_view
+  Vocabulary::word(int64_t id) const {
+    return std::string_view(arena.data() + offsets.at(id),
+                            offsets.at(id + 1) - offsets.at(id));
+  }
+
+  int64_t
+  Vocabulary::count(int64_t id) const {
+    return counts.at(id);
+  }
+
+  size_t
+  Vocabulary::size() const {
+    return offsets.size() - 1;
+  }
+
+  void
+  Vocabulary::freeze() {
+    is_frozen = true;
+  }
+
+  bool
+  Vocabulary::frozen() const {
+    return is_frozen;
+  }
+
+  std::vector<int64_t>
+  Vocabulary::prune(int64_t min_count) {
+    Vocabulary pruned;
+    std::vector<int64_t> remap(size(), unknown_id);
+
+    pruned.counts[unknown_id] = counts[unknown_id];
+
+    for (size_t id = 1; id < size(); ++id) {
+      if (counts[id] >= min_count) {
+        remap[id] = pruned.add(word(id), hashes[id]);
+        pruned.counts[remap[id]] = counts[id];
+      } else {
+        pruned.counts[unknown_id] += counts[id];
+      }
+    }
+
+    pruned.is_frozen = is_frozen;
+    *this = std::move(pruned);
+
+    return remap;
+  }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace corpus {
+  // Maps each distinct word to a dense id, in order of first
+  // appearance. The bytes of every word are copied into a single
+  // arena, with a flat table of offsets into it for looking up the
+  // word for an id and an open-addressing table of ids for looking
+  // up the id for a word. Id 0 is reserved for unknown words.
+  class Vocabulary {
+  public:
+    static constexpr int64_t unknown_id = 0;
+
+    Vocabulary();
+
+    // Return the id of word, adding it if it is new and counting
+    // the occurrence. Once frozen, new words map to unknown_id.
+    int64_t intern(std::string_view word);
+
+    // Return the id of word, or unknown_id if it is not present.
+    int64_t lookup(std::string_view word) const;
+
+    std::string_view word(int64_t id) const;
+    int64_t count(int64_t id) const;
+    size_t size() const;
+
+    // Stop adding words, so that intern behaves like lookup.
+    void freeze();
+    bool frozen() const;
+
+    // Drop words seen fewer than min_count times, folding their
+    // counts into the unknown word, and renumber the remaining
+    // words densely in their original order. Returns a table
+    // mapping every old id to its new id.
+    std::vector<int64_t> prune(int64_t min_count);
+
+  private:
+    uint64_t find_slot(std::string_view word, uint32_t hash) const;
+    int64_t add(std::string_view word, uint32_t hash);
+    void rehash(size_t n_slots);
+
+    std::vector<char> arena;
+    std::vector<uint64_t> offsets;
+    std::vector<uint32_t> hashes;
+    std::vector<int64_t> counts;
+    std::vector<int32_t> slots;
+    bool is_frozen;
+  };
+}
@@ -0,0 +1,719 @@
+/*
+ * /scortch/batching-engine.cpp
+ *
+ * Inference engine that merges single-sample requests into
+ * batches before running them through a ScortchModule. C++ source file.
+ *
+ * Copyright (C) 2018 Sam Spilsbury.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <atomic>
+#include <deque>
+#include <vector>
+
+#include <gio/gio.h>
+#include <glib-object.h>
+#include <glib.h>
+
+#include <torch/script.h>
+#include <torch/torch.h>
+
+#include <scortch/batching-engine.h>
+#include <scortch/local-tensor.h>
+#include <scortch/local-tensor-internal.h>
+#include <scortch/module.h>
+#include <scortch/module-internal.h>
+#include <scortch/scortch-errors.h>
+#include <scortch/scortch-tracing-internal.h>
+
+struct _ScortchBatchingEngine
+{
+  GObject parent_instance;
+};
+
+namespace
+{
+  template <typename T>
+  void safe_delete (T *t)
+  {
+    delete t;
+  }
+
+  gboolean unref_task_cb (gpointer data)
+  {
+    g_object_unref (data);
+    return G_SOURCE_REMOVE;
+  }
+
+  /* Every task holds a reference on the engine as its source
+   * object, so dropping the last task reference on the batching
+   * thread could finalize the engine there, which would then join
+   * the thread it is running on. The reference is released from an
+   * idle on the task's context instead. g_main_context_invoke is not
+   * used, since it may run the function on the calling thread if it
+   * can acquire the context. */
+  void unref_task_in_context (GTask *task)
+  {
+    GSource *source = g_idle_source_new ();
+
+    g_source_set_callback (source, unref_task_cb, task, nullptr);
+    g_source_attach (source, g_task_get_context (task));
+    g_source_unref (source);
+  }
+
+  /* Requests are queued by the calling thread and batched on a
+   * dedicated thread, which runs one forward pass at a time. While
+   * a batch is running, new requests accumulate in the queue, so
+   * the batch size grows with the load. */
+  class BatchQueue
+  {
+    public:
+      BatchQueue (torch::jit::Module const &module,
+                  guint                     max_batch_size,
+                  guint64                   max_wait_microseconds);
+      ~BatchQueue ();
+
+      void push (GTask *task, torch::Tensor const &input);
+
+      void set_limits (guint max_batch_size, guint64 max_wait_microseconds);
+
+      guint queue_depth ();
+      guint last_batch_size () const;
+      double mean_batch_size () const;
+
+    private:
+      struct Request
+      {
+        GTask         *task;
+        torch::Tensor  input;
+        gint64         enqueue_time;
+      };
+
+      static gpointer thread_func (gpointer data);
+      void run ();
+      gint64 deadline_unlocked () const;
+      std::vector <Request> take_batch_unlocked ();
+      void run_batch (std::vector <Request> &batch);
+
+      torch::jit::Module module;
+
+      GMutex mutex;
+      GCond cond;
+      std::deque <Request> queue;
+      guint max_batch_size;
+      guint64 max_wait_microseconds;
+      bool stopping;
+      GThread *thread;
+
+      std::atomic <guint> last_batch_size_;
+      std::atomic <guint64> n_batches;
+      std::atomic <guint64> n_batched_requests;
+  };
+
+  BatchQueue::BatchQueue (torch::jit::Module const &module,
+                          guint                     max_batch_size,
+                          guint64                   max_wait_microseconds) :
+    /* Copying a jit::Module only copies a handle to the same object,
+     * so clone it to keep later eval or freeze calls from changing the
+     * module under the batching thread. Parameters are still shared. */
+    module (module.clone (true)),
+    max_batch_size (max_batch_size),
+    max_wait_microseconds (max_wait_microseconds),
+    stopping (false),
+    last_batch_size_ (0),
+    n_batches (0),
+    n_batched_requests (0)
+  {
+    g_mutex_init (&mutex);
+    g_cond_init (&cond);
+
+    thread = g_thread_new ("scortch-batcher", BatchQueue::thread_func, this);
+  }
+
+  BatchQueue::~BatchQueue ()
+  {
+    g_mutex_lock (&mutex);
+    stopping = true;
+    g_cond_signal (&cond);
+    g_mutex_unlock (&mutex);
+
+    g_thread_join (thread);
+
+    g_cond_clear (&cond);
+    g_mutex_clear (&mutex);
+  }
+
+  void BatchQueue::push (GTask *task, torch::Tensor const &input)
+  {
+    g_mutex_lock (&mutex);
+    queue.push_back (Request {
+      G_TASK (g_object_ref (task)),
+      input,
+      g_get_monotonic_time ()
+    });
+    g_cond_signal (&cond);
+    g_mutex_unlock (&mutex);
+  }
+
+  void BatchQueue::set_limits (guint max_batch_size, guint64 max_wait_microseconds)
+  {
+    g_mutex_lock (&mutex);
+    this->max_batch_size = max_batch_size;
+    this->max_wait_microseconds = max_wait_microseconds;
+    g_cond_signal (&cond);
+    g_mutex_unlock (&mutex);
+  }
+
+  guint BatchQueue::queue_depth ()
+  {
+    g_mutex_lock (&mutex);
+    guint depth = queue.size ();
+    g_mutex_unlock (&mutex);
+
+    return depth;
+  }
+
+  guint BatchQueue::last_batch_size () const
+  {
+    return last_batch_size_;
+  }
+
+  double BatchQueue::mean_batch_size () const
+  {
+    guint64 batches = n_batches;
+
+    return batches == 0 ? 0.0 : static_cast <double> (n_batched_requests) / batches;
+  }
+
+  gpointer BatchQueue::thread_func (gpointer data)
+  {
+    static_cast <BatchQueue *> (data)->run ();
+    return nullptr;
+  }
+
+  void BatchQueue::run ()
+  {
+    g_mutex_lock (&mutex);
+
+    while (true)
+      {
+        while (!stopping && queue.empty ())
+          g_cond_wait (&cond, &mutex);
+
+        if (queue.empty ())
+          break;
+
+        /* Wait until the batch is full or the oldest request has
+         * waited long enough. The limits may change while waiting. */
+        while (!stopping &&
+               queue.size () < max_batch_size &&
+               g_get_monotonic_time () < deadline_unlocked ())
+          g_cond_wait_until (&cond, &mutex, deadline_unlocked ());
+
+        std::vector <Request> batch (take_batch_unlocked ());
+
+        g_mutex_unlock (&mutex);
+        run_batch (batch);
+        g_mutex_lock (&mutex);
+      }
+
+    g_mutex_unlock (&mutex);
+  }
+
+  gint64 BatchQueue::deadline_unlocked () const
+  {
+    gint64 const enqueue_time = queue.front ().enqueue_time;
+
+    return enqueue_time + static_cast <gint64> (MIN (max_wait_microseconds,
+                                                     static_cast <guint64> (G_MAXINT64 - enqueue_time)));
+  }
+
+  /* Requests can only be stacked if their inputs have the same
+   * shape, so take up to max_batch_size requests matching the
+   * oldest one and leave the rest queued for the next batch. */
+  std::vector <BatchQueue::Request> BatchQueue::take_batch_unlocked ()
+  {
+    std::vector <Request> batch;
+    std::deque <Request> remaining;
+    std::vector <int64_t> const shape (queue.front ().input.sizes ().vec ());
+
+    for (Request &request : queue)
+      {
+        if (batch.size () < max_batch_size && request.input.sizes () == shape)
+          batch.push_back (std::move (request));
+        else
+          remaining.push_back (std::move (request));
+      }
+
+    queue.swap (remaining);
+
+    return batch;
+  }
+
+  void BatchQueue::run_batch (std::vector <Request> &batch)
+  {
+    std::vector <torch::Tensor> inputs;
+    std::vector <GTask *> tasks;
+
+    for (Request &request : batch)
+      {
+        if (g_task_return_error_if_cancelled (request.task))
+          {
+            unref_task_in_context (request.task);
+            continue;
+          }
+
+        inputs.push_back (request.input);
+        tasks.push_back (request.task);
+      }
+
+    if (tasks.empty ())
+      return;
+
+    ScortchTraceScope trace ("batch-forward");
+    g_autoptr(GError) error = nullptr;
+    torch::Tensor output;
+
+    if (scortch_call_torch ([&]() {
+          torch::NoGradGuard no_grad;
+          output = module.forward ({ torch::stack (inputs) }).toTensor ();
+        }, &error) &&
+        (output.dim () == 0 || output.size (0) != static_cast <int64_t> (tasks.size ())))
+      g_set_error (&error,
+                   SCORTCH_ERROR,
+                   SCORTCH_ERROR_INVALID_OPERATION,
+                   "Module returned a tensor without one row per request in the batch");
+
+    for (size_t i = 0; i < tasks.size (); ++i)
+      {
+        if (error != nullptr)
+          g_task_return_error (tasks[i], g_error_copy (error));
+        else
+          g_task_return_pointer (tasks[i],
+                                 new torch::Tensor (output[i]),
+                                 (GDestroyNotify) safe_delete <torch::Tensor>);
+      }
+
+    last_batch_size_ = tasks.size ();
+    n_batches += 1;
+    n_batched_requests += tasks.size ();
+
+    for (GTask *task : tasks)
+      unref_task_in_context (task);
+  }
+}
+
+typedef struct _ScortchBatchingEnginePrivate {
+  ScortchModule *module;
+  guint max_batch_size;
+  guint64 max_wait_microseconds;
+
+  BatchQueue *queue;
+} ScortchBatchingEnginePrivate;
+
+enum {
+  PROP_0,
+  PROP_MODULE,
+  PROP_MAX_BATCH_SIZE,
+  PROP_MAX_WAIT_MICROSECONDS,
+  PROP_N
+};
+
+G_DEFINE_TYPE_WITH_PRIVATE (ScortchBatchingEngine, scortch_batching_engine, G_TYPE_OBJECT);
+
+/**
+ * scortch_batching_engine_submit_async:
+ * @engine: A #ScortchBatchingEngine
+ * @input: A #ScortchLocalTensor with a single sample, without
+ *         a batch dimension.
+ * @cancellable: (nullable): A #GCancellable
+ * @callback: A #GAsyncReadyCallback to call when the output is ready.
+ * @user_data: Data to pass to @callback.
+ *
+ * Queue @input to be run through the module of @engine. Queued
+ * inputs of the same shape are stacked along a new first dimension
+ * and run in a single forward pass, once either
+ * #ScortchBatchingEngine:max-batch-size inputs are queued or the
+ * oldest has waited #ScortchBatchingEngine:max-wait-microseconds.
+ *
+ * @input should not be modified in place until @callback is called.
+ * Cancelling @cancellable drops the request from the next batch.
+ */
+void
+scortch_batching_engine_submit_async (ScortchBatchingEngine *engine,
+                                      ScortchLocalTensor    *input,
+                                      GCancellable          *cancellable,
+                                      GAsyncReadyCallback    callback,
+                                      gpointer               user_data)
+{
+  ScortchBatchingEnginePrivate *priv =
+    static_cast <ScortchBatchingEnginePrivate *> (scortch_batching_engine_get_instance_private (engine));
+  g_autoptr(GTask) task = g_task_new (engine, cancellable, callback, user_data);
+
+  g_task_set_source_tag (task, (gpointer) scortch_batching_engine_submit_async);
+
+  priv->queue->push (task, scortch_local_tensor_get_tensor (input));
+}
+
+/**
+ * scortch_batching_engine_submit_finish:
+ * @engine: A #ScortchBatchingEngine
+ * @result: A #GAsyncResult
+ * @error: A #GError
+ *
+ * Complete a call to %scortch_batching_engine_submit_async.
+ *
+ * Returns: (transfer full): A new #ScortchLocalTensor with the row
+ *          of the batched output corresponding to the submitted
+ *          input, or %NULL with @error set if the forward pass
+ *          failed or the request was cancelled.
+ */
+ScortchLocalTensor *
+scortch_batching_engine_submit_finish (ScortchBatchingEngine  *engine,
+                                       GAsyncResult           *result,
+                                       GError                **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, engine), nullptr);
+
+  torch::Tensor *output = static_cast <torch::Tensor *> (g_task_propagate_pointer (G_TASK (result), error));
+
+  if (output == nullptr)
+    return nullptr;
+
+  ScortchLocalTensor *local_output = scortch_local_tensor_new_from_tensor (*output);
+  delete output;
+
+  return local_output;
+}
+
+/**
+ * scortch_batching_engine_get_max_batch_size:
+ * @engine: A #ScortchBatchingEngine
+ *
+ * Get the maximum number of requests run in a single forward pass.
+ *
+ * Returns: The maximum batch size.
+ */
+guint
+scortch_batching_engine_get_max_batch_size (ScortchBatchingEngine *engine)
+{
+  ScortchBatchingEnginePrivate *priv =
+    static_cast <ScortchBatchingEnginePrivate *> (scortch_batching_engine_get_instance_private (engine));
+
+  return priv->max_batch_size;
+}
+
+/**
+ * scortch_batching_engine_set_max_batch_size:
+ * @engine: A #ScortchBatchingEngine
+ * @max_batch_size: The maximum number of requests to run in a
+ *                  single forward pass, at least 1.
+ *
+ * Set the maximum number of requests run in a single forward pass.
+ * A batch is run as soon as this many requests are queued.
+ */
+void
+scortch_batching_engine_set_max_batch_size (ScortchBatchingEngine *engine,
+                                            guint                  max_batch_size)
+{
+  ScortchBatchingEnginePrivate *priv =
+    static_cast <ScortchBatchingEnginePrivate *> (scortch_batching_engine_get_instance_private (engine));
+
+  /* An empty batch would never drain the queue */
+  g_return_if_fail (max_batch_size > 0);
+
+  priv->max_batch_size = max_batch_size;
+
+  if (priv->queue != nullptr)
+    priv->queue->set_limits (priv->max_batch_size, priv->max_wait_microseconds);
+}
+
+/**
+ * scortch_batching_engine_get_max_wait_microseconds:
+ * @engine: A #ScortchBatchingEngine
+ *
+ * Get the longest time a request waits for a batch to fill up.
+ *
+ * Returns: The maximum wait in microseconds.
+ */
+guint64
+scortch_batching_engine_get_max_wait_microseconds (ScortchBatchingEngine *engine)
+{
+  ScortchBatchingEnginePrivate *priv =
+    static_cast <ScortchBatchingEnginePrivate *> (scortch_batching_engine_get_instance_private (engine));
+
+  return priv->max_wait_microseconds;
+}
+
+/**
+ * scortch_batching_engine_set_max_wait_microseconds:
+ * @engine: A #ScortchBatchingEngine
+ * @max_wait_microseconds: The longest time a request waits for
+ *                         a batch to fill up.
+ *
+ * Set the longest time a request waits for a batch to fill up
+ * before a smaller batch is run. This bounds the latency added
+ * by batching.
+ */
+void
+scortch_batching_engine_set_max_wait_microseconds (ScortchBatchingEngine *engine,
+                                                   guint64                max_wait_microseconds)
+{
+  ScortchBatchingEnginePrivate *priv =
+    static_cast <ScortchBatchingEnginePrivate *> (scortch_batching_engine_get_instance_private (engine));
+
+  priv->max_wait_microseconds = max_wait_microseconds;
+
+  if (priv->queue != nullptr)
+    priv->queue->set_limits (priv->max_batch_size, priv->max_wait_microseconds);
+}
+
+/**
+ * scortch_batching_engine_get_queue_depth:
+ * @engine: A #ScortchBatchingEngine
+ *
+ * Get the number of requests waiting to be batched, not
+ * including those in a forward pass that is already running.
+ *
+ * Returns: The number of queued requests.
+ */
+guint
+scortch_batching_engine_get_queue_depth (ScortchBatchingEngine *engine)
+{
+  ScortchBatchingEnginePrivate *priv =
+    static_cast <ScortchBatchingEnginePrivate *> (scortch_batching_engine_get_instance_private (engine));
+
+  return priv->queue->queue_depth ();
+}
+
+/**
+ * scortch_batching_engine_get_last_batch_size:
+ * @engine: A #ScortchBatchingEngine
+ *
+ * Get the number of requests in the most recent forward pass.
+ *
+ * Returns: The size of the last batch, or 0 if none has run yet.
+ */
+guint
+scortch_batching_engine_get_last_batch_size (ScortchBatchingEngine *engine)
+{
+  ScortchBatchingEnginePrivate *priv =
+    static_cast <ScortchBatchingEnginePrivate *> (scortch_batching_engine_get_instance_private (engine));
+
+  return priv->queue->last_batch_size ();
+}
+
+/**
+ * scortch_batching_engine_get_mean_batch_size:
+ * @engine: A #ScortchBatchingEngine
+ *
+ * Get the mean number of requests per forward pass since @engine
+ * was created. Cancelled requests are not counted.
+ *
+ * Returns: The mean batch size, or 0 if no batch has run yet.
+ */
+double
+scortch_batching_engine_get_mean_batch_size (ScortchBatchingEngine *engine)
+{
+  ScortchBatchingEnginePrivate *priv =
+    static_cast <ScortchBatchingEnginePrivate *> (scortch_batching_engine_get_instance_private (engine));
+
+  return priv->queue->mean_batch_size ();
+}
+
+static void
+scortch_batching_engine_get_property (GObject    *object,
+                                      guint       prop_id,
+                                      GValue     *value,
+                                      GParamSpec *pspec)
+{
+  ScortchBatchingEngine *engine = SCORTCH_BATCHING_ENGINE (object);
+  ScortchBatchingEnginePrivate *priv =
+    static_cast <ScortchBatchingEnginePrivate *> (scortch_batching_engine_get_instance_private (engine));
+
+  switch (prop_id)
+    {
+      case PROP_MODULE:
+        g_value_set_object (value, priv->module);
+        break;
+      case PROP_MAX_BATCH_SIZE:
+        g_value_set_uint (value, scortch_batching_engine_get_max_batch_size (engine));
+        break;
+      case PROP_MAX_WAIT_MICROSECONDS:
+        g_value_set_uint64 (value, scortch_batching_engine_get_max_wait_microseconds (engine));
+        break;
+      default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+        break;
+    }
+}
+
+static void
+scortch_batching_engine_set_property (GObject      *object,
+                                      guint         prop_id,
+                                      const GValue *value,
+                                      GParamSpec   *pspec)
+{
+  ScortchBatchingEngine *engine = SCORTCH_BATCHING_ENGINE (object);
+  ScortchBatchingEnginePrivate *priv =
+    static_cast <ScortchBatchingEnginePrivate *> (scortch_batching_engine_get_instance_private (engine));
+
+  switch (prop_id)
+    {
+      case PROP_MODULE:
+        priv->module = SCORTCH_MODULE (g_value_dup_object (value));
+        break;
+      case PROP_MAX_BATCH_SIZE:
+        scortch_batching_engine_set_max_batch_size (engine, g_value_get_uint (value));
+        break;
+      case PROP_MAX_WAIT_MICROSECONDS:
+        scortch_batching_engine_set_max_wait_microseconds (engine, g_value_get_uint64 (value));
+        break;
+      default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+        break;
+    }
+}
+
+static void
+scortch_batching_engine_constructed (GObject *object)
+{
+  ScortchBatchingEngine *engine = SCORTCH_BATCHING_ENGINE (object);
+  ScortchBatchingEnginePrivate *priv =
+    static_cast <ScortchBatchingEnginePrivate *> (scortch_batching_engine_get_instance_private (engine));
+
+  G_OBJECT_CLASS (scortch_batching_engine_parent_class)->constructed (object);
+
+  g_assert (priv->module != nullptr);
+
+  /* The batching thread runs a clone of the module, so the module
+   * should be put into evaluation mode or frozen beforehand. */
+  priv->queue = new BatchQueue (scortch_module_get_module (priv->module),
+                                priv->max_batch_size,
+                                priv->max_wait_microseconds);
+}
+
+static void
+scortch_batching_engine_finalize (GObject *object)
+{
+  ScortchBatchingEngine *engine = SCORTCH_BATCHING_ENGINE (object);
+  ScortchBatchingEnginePrivate *priv =
+    static_cast <ScortchBatchingEnginePrivate *> (scortch_batching_engine_get_instance_private (engine));
+
+  /* Every queued request holds a reference on the engine, so
+   * the queue is empty by the time it is stopped. */
+  g_clear_pointer (&priv->queue, (GDestroyNotify) safe_delete <BatchQueue>);
+  g_clear_object (&priv->module);
+
+  G_OBJECT_CLASS (scortch_batching_engine_parent_class)->finalize (object);
+}
+
+static void
+scortch_batching_engine_class_init (ScortchBatchingEngineClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->constructed = scortch_batching_engine_constructed;
+  object_class->get_property = scortch_batching_engine_get_property;
+  object_class->set_property = scortch_batching_engine_set_property;
+  object_class->finalize = scortch_batching_engine_finalize;
+
+  /**
+   * ScortchBatchingEngine:module:
+   *
+   * The #ScortchModule that batches are run through. Its forward
+   * method must take a single tensor with a leading batch dimension
+   * and return a tensor with one row per sample.
+   *
+   * The engine takes a copy of the module when it is constructed,
+   * so calling %scortch_module_eval or %scortch_module_freeze on the
+   * module afterwards does not affect the engine.
+   */
+  g_object_class_install_property (object_class,
+                                   PROP_MODULE,
+                                   g_param_spec_object ("module",
+                                                        "Module",
+                                                        "Module to run batches through",
+                                                        SCORTCH_TYPE_MODULE,
+                                                        static_cast <GParamFlags> (G_PARAM_READWRITE |
+                                                                                   G_PARAM_CONSTRUCT_ONLY)));
+
+  /**
+   * ScortchBatchingEngine:max-batch-size:
+   *
+   * The maximum number of requests run in a single forward pass.
+   */
+  g_object_class_install_property (object_class,
+                                   PROP_MAX_BATCH_SIZE,
+                                   g_param_spec_uint ("max-batch-size",
+                                                      "Max Batch Size",
+                                                      "Maximum number of requests in a batch",
+                                                      1,
+                                                      G_MAXUINT,
+                                                      32,
+                                                      static_cast <GParamFlags> (G_PARAM_READWRITE |
+                                                                                 G_PARAM_CONSTRUCT)));
+
+  /**
+   * ScortchBatchingEngine:max-wait-microseconds:
+   *
+   * The longest time a request waits for a batch to fill up.
+   */
+  g_object_class_install_property (object_class,
+                                   PROP_MAX_WAIT_MICROSECONDS,
+                                   g_param_spec_uint64 ("max-wait-microseconds",
+                                                        "Max Wait Microseconds",
+                                                        "Longest time a request waits for a batch to fill up",
+                                                        0,
+                                                        G_MAXINT64,
+                                                        1000,
+                                                        static_cast <GParamFlags> (G_PARAM_READWRITE |
+                                                                                   G_PARAM_CONSTRUCT)));
+}
+
+static void
+scortch_batching_engine_init (ScortchBatchingEngine *engine)
+{
+}
+
+/**
+ * scortch_batching_engine_new:
+ * @module: The #ScortchModule to run batches through.
+ * @max_batch_size: The maximum number of requests in a batch,
+ *                  at least 1.
+ * @max_wait_microseconds: The longest time a request waits
+ *                         for a batch to fill up.
+ *
+ * Create a new #ScortchBatchingEngine for @module. The engine
+ * runs a copy of @module taken now, so @module should be put
+ * into evaluation mode with %scortch_module_eval or frozen with
+ * %scortch_module_freeze beforehand. Later changes to @module
+ * do not reach the engine.
+ *
+ * Returns: (transfer full): A new #ScortchBatchingEngine.
+ */
+ScortchBatchingEngine *
+scortch_batching_engine_new (ScortchModule *module,
+                             guint          max_batch_size,
+                             guint64        max_wait_microseconds)
+{
+  return static_cast <ScortchBatchingEngine *> (g_object_new (SCORTCH_TYPE_BATCHING_ENGINE,
+                                                              "module", module,
+                                                              "max-batch-size", max_batch_size,
+                                                              "max-wait-microseconds", max_wait_microseconds,
+                                                              NULL));
+}
@@ -0,0 +1,62 @@
+/*
+ * /scortch/batching-engine.h
+ *
+ * Inference engine that merges single-sample requests into
+ * batches before running them through a ScortchModule.
+ *
+ * Copyright (C) 2018 Sam Spilsbury.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+#include <glib.h>
+#include <glib-object.h>
+
+#include <scortch/local-tensor.h>
+#include <scortch/module.h>
+
+G_BEGIN_DECLS
+
+#define SCORTCH_TYPE_BATCHING_ENGINE scortch_batching_engine_get_type ()
+G_DECLARE_FINAL_TYPE (ScortchBatchingEngine, scortch_batching_engine, SCORTCH, BATCHING_ENGINE, GObject)
+
+ScortchBatchingEngine * scortch_batching_engine_new (ScortchModule *module,
+                                                     guint          max_batch_size,
+                                                     guint64        max_wait_microseconds);
+
+void scortch_batching_engine_submit_async (ScortchBatchingEngine *engine,
+                                           ScortchLocalTensor    *input,
+                                           GCancellable          *cancellable,
+                                           GAsyncReadyCallback    callback,
+                                           gpointer               user_data);
+ScortchLocalTensor * scortch_batching_engine_submit_finish (ScortchBatchingEngine  *engine,
+                                                            GAsyncResult           *result,
+                                                            GError                **error);
+
+guint scortch_batching_engine_get_max_batch_size (ScortchBatchingEngine *engine);
+void scortch_batching_engine_set_max_batch_size (ScortchBatchingEngine *engine,
+                                                 guint                  max_batch_size);
+guint64 scortch_batching_engine_get_max_wait_microseconds (ScortchBatchingEngine *engine);
+void scortch_batching_engine_set_max_wait_microseconds (ScortchBatchingEngine *engine,
+                                                        guint64                max_wait_microseconds);
+
+guint scortch_batching_engine_get_queue_depth (ScortchBatchingEngine *engine);
+guint scortch_batching_engine_get_last_batch_size (ScortchBatchingEngine *engine);
+double scortch_batching_engine_get_mean_batch_size (ScortchBatchingEngine *engine);
+
+G_END_DECLS
@@ -0,0 +1,120 @@
+/*
+ * /scortch/local-tensor-internal.h
+ *
+ * Private C++ interface to the GObject Binding to the Tensor
+ * Object, for use by other parts of libscortch. Not installed.
+ *
+ * Copyright (C) 2018 Sam Spilsbury.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include <torch/torch.h>
+
+#include <scortch/local-tensor.h>
+#include <scortch/scortch-errors.h>
+#include <scortch/scortch-tracing-internal.h>
+
+/* Wrap an existing tensor in a new ScortchLocalTensor. The
+ * tensor is not copied, so the new object shares its storage. */
+ScortchLocalTensor * scortch_local_tensor_new_from_tensor (torch::Tensor const &tensor);
+
+/* Borrow the tensor wrapped by a ScortchLocalTensor. */
+torch::Tensor & scortch_local_tensor_get_tensor (ScortchLocalTensor *local_tensor);
+
+/* Replace the tensor wrapped by a ScortchLocalTensor, releasing
+ * any rows reserved for appending. The new tensor must have the
+ * same element type. */
+void scortch_local_tensor_replace_tensor (ScortchLocalTensor  *local_tensor,
+                                          torch::Tensor const &tensor);
+
+/* Create a tensor over memory owned by someone else without
+ * copying it. release is called with release_data once the
+ * tensor storage is no longer referenced. If read_only is set,
+ * scortch_tensor_check_writable fails for the tensor and any
+ * view of it. */
+torch::Tensor scortch_tensor_new_from_foreign_buffer (gpointer            data,
+                                                      torch::IntArrayRef  dimensions,
+                                                      at::ScalarType      scalar_type,
+                                                      bool                read_only,
+                                                      GDestroyNotify      release,
+                                                      gpointer            release_data);
+
+/* Returns false with SCORTCH_ERROR_INVALID_OPERATION set if the
+ * storage of tensor is read-only memory, such as an immutable
+ * GBytes or a read-only file mapping. Anything that writes into
+ * existing storage has to check this first. */
+bool scortch_tensor_check_writable (torch::Tensor const  &tensor,
+                                    GError              **error);
+
+/* Read an "ax" GVariant of dimensions into a vector. */
+std::vector <int64_t> scortch_dimensions_from_g_variant (GVariant *dimensions);
+
+/* Run func, translating errors raised by PyTorch, for instance
+ * because of mismatched shapes, into SCORTCH_ERROR_INVALID_OPERATION.
+ * Other exceptions, such as those raised by TorchScript code or
+ * allocation failures, are translated the same way, so nothing
+ * escapes into C callers. Returns false if an error was raised. Calls are traced as
+ * "torch-compute", so every entry point into PyTorch kernels
+ * should go through here. */
+template <typename Func>
+bool
+scortch_call_torch (Func &&func, GError **error)
+{
+  ScortchTraceScope trace ("torch-compute");
+
+  try
+    {
+      func ();
+      return true;
+    }
+  catch (c10::Error const &e)
+    {
+      g_set_error (error,
+                   SCORTCH_ERROR,
+                   SCORTCH_ERROR_INVALID_OPERATION,
+                   "%s",
+                   e.what_without_backtrace ());
+      return false;
+    }
+  catch (std::exception const &e)
+    {
+      g_set_error (error,
+                   SCORTCH_ERROR,
+                   SCORTCH_ERROR_INVALID_OPERATION,
+                   "%s",
+                   e.what ());
+      return false;
+    }
+}
+
+/* Run func, which returns a torch::Tensor, and wrap the result
+ * in a new ScortchLocalTensor, or return nullptr with error set
+ * if PyTorch raised an error. */
+template <typename Func>
+ScortchLocalTensor *
+scortch_local_tensor_new_from_operation (Func &&func, GError **error)
+{
+  torch::Tensor result;
+
+  if (!scortch_call_torch ([&]() { result = func (); }, error))
+    return nullptr;
+
+  return scortch_local_tensor_new_from_tensor (result);
+}
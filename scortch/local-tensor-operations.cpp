@@ -0,0 +1,1302 @@
+/*
+ * /scortch/local-tensor-operations.cpp
+ *
+ * Tensor operations on ScortchLocalTensor, computed by
+ * PyTorch without copying data through GVariant. C++ source file.
+ *
+ * Copyright (C) 2018 Sam Spilsbury.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <gio/gio.h>
+#include <glib-object.h>
+#include <glib.h>
+
+#include <torch/torch.h>
+#include <ATen/ExpandUtils.h>
+
+#include <scortch/local-tensor.h>
+#include <scortch/local-tensor-internal.h>
+#include <scortch/local-tensor-operations.h>
+#include <scortch/scortch-errors.h>
+#include <scortch/scortch-worker-pool-internal.h>
+
+namespace
+{
+  std::string format_dimensions (torch::IntArrayRef dimensions)
+  {
+    std::stringstream ss;
+
+    ss << "[";
+    for (size_t i = 0; i < dimensions.size (); ++i)
+      ss << (i == 0 ? "" : ", ") << dimensions[i];
+    ss << "]";
+
+    return ss.str ();
+  }
+
+  /* Compute the shape of the result of torch::matmul, following
+   * its rules for vectors, matrices and batches of matrices. */
+  bool matmul_result_dimensions (torch::Tensor const    &left,
+                                 torch::Tensor const    &right,
+                                 std::vector <int64_t>  &result_dimensions,
+                                 GError                **error)
+  {
+    if (left.dim () == 0 || right.dim () == 0)
+      {
+        g_set_error (error,
+                     SCORTCH_ERROR,
+                     SCORTCH_ERROR_INVALID_OPERATION,
+                     "matmul needs operands with at least one dimension");
+        return false;
+      }
+
+    std::vector <int64_t> left_dimensions (left.sizes ().vec ());
+    std::vector <int64_t> right_dimensions (right.sizes ().vec ());
+    bool const left_is_vector = left_dimensions.size () == 1;
+    bool const right_is_vector = right_dimensions.size () == 1;
+
+    if (left_is_vector)
+      left_dimensions.insert (left_dimensions.begin (), 1);
+    if (right_is_vector)
+      right_dimensions.push_back (1);
+
+    size_t const n_left = left_dimensions.size ();
+    size_t const n_right = right_dimensions.size ();
+
+    if (left_dimensions[n_left - 1] != right_dimensions[n_right - 2])
+      {
+        g_set_error (error,
+                     SCORTCH_ERROR,
+                     SCORTCH_ERROR_INVALID_OPERATION,
+                     "Size mismatch, cannot multiply %s by %s",
+                     format_dimensions (left.sizes ()).c_str (),
+                     format_dimensions (right.sizes ()).c_str ());
+        return false;
+      }
+
+    if (!scortch_call_torch ([&]() {
+          result_dimensions = at::infer_size (torch::IntArrayRef (left_dimensions.data (), n_left - 2),
+                                              torch::IntArrayRef (right_dimensions.data (), n_right - 2));
+        }, error))
+      return false;
+
+    if (!left_is_vector)
+      result_dimensions.push_back (left_dimensions[n_left - 2]);
+    if (!right_is_vector)
+      result_dimensions.push_back (right_dimensions[n_right - 1]);
+
+    return true;
+  }
+
+  /* ATen's out= overloads silently resize and may cast into the
+   * destination, which would defeat the point of preallocating it,
+   * so check that it already has the shape and type of the result. */
+  bool check_destination (torch::Tensor const  &destination,
+                          torch::IntArrayRef    expected_dimensions,
+                          at::ScalarType        expected_scalar_type,
+                          GError              **error)
+  {
+    if (destination.sizes () != expected_dimensions)
+      {
+        g_set_error (error,
+                     SCORTCH_ERROR,
+                     SCORTCH_ERROR_INVALID_DIMENSIONS,
+                     "Destination has dimensions %s, but the result has dimensions %s",
+                     format_dimensions (destination.sizes ()).c_str (),
+                     format_dimensions (expected_dimensions).c_str ());
+        return false;
+      }
+
+    if (destination.scalar_type () != expected_scalar_type)
+      {
+        g_set_error (error,
+                     SCORTCH_ERROR,
+                     SCORTCH_ERROR_INVALID_DATA_TYPE,
+                     "Destination has element type %s, but the result has element type %s",
+                     c10::toString (destination.scalar_type ()),
+                     c10::toString (expected_scalar_type));
+        return false;
+      }
+
+    return true;
+  }
+
+  typedef at::ScalarType (*ResultScalarType) (torch::Tensor const &, torch::Tensor const &);
+
+  at::ScalarType promoted_scalar_type (torch::Tensor const &left,
+                                       torch::Tensor const &right)
+  {
+    return c10::promoteTypes (left.scalar_type (), right.scalar_type ());
+  }
+
+  /* torch::div is true division, so integer operands give a
+   * result of the default floating point type. */
+  at::ScalarType true_division_scalar_type (torch::Tensor const &left,
+                                            torch::Tensor const &right)
+  {
+    at::ScalarType scalar_type = promoted_scalar_type (left, right);
+
+    if (!c10::isFloatingType (scalar_type))
+      return c10::typeMetaToScalarType (c10::get_default_dtype ());
+
+    return scalar_type;
+  }
+
+  template <typename Func>
+  gboolean elementwise_out (ScortchLocalTensor  *local_tensor,
+                            ScortchLocalTensor  *other,
+                            ScortchLocalTensor  *destination,
+                            ResultScalarType     result_scalar_type,
+                            Func               &&func,
+                            GError             **error)
+  {
+    torch::Tensor &left = scortch_local_tensor_get_tensor (local_tensor);
+    torch::Tensor &right = scortch_local_tensor_get_tensor (other);
+    torch::Tensor &out = scortch_local_tensor_get_tensor (destination);
+    std::vector <int64_t> result_dimensions;
+
+    if (!scortch_call_torch ([&]() {
+          result_dimensions = at::infer_size (left.sizes (), right.sizes ());
+        }, error))
+      return FALSE;
+
+    if (!check_destination (out, result_dimensions, result_scalar_type (left, right), error))
+      return FALSE;
+
+    if (!scortch_tensor_check_writable (out, error))
+      return FALSE;
+
+    return scortch_call_torch ([&]() { func (out, left, right); }, error);
+  }
+
+  typedef torch::Tensor (*BinaryOperation) (torch::Tensor const &, torch::Tensor const &);
+
+  /* The operands are shallow copies, so the worker does not
+   * touch the ScortchLocalTensor objects themselves. */
+  struct BinaryOperationTaskData
+  {
+    torch::Tensor   left;
+    torch::Tensor   right;
+    BinaryOperation operation;
+  };
+
+  void delete_binary_operation_task_data (gpointer data)
+  {
+    delete static_cast <BinaryOperationTaskData *> (data);
+  }
+
+  void delete_tensor (gpointer data)
+  {
+    delete static_cast <torch::Tensor *> (data);
+  }
+
+  void binary_operation_in_worker (GTask        *task,
+                                   gpointer      source_object G_GNUC_UNUSED,
+                                   gpointer      task_data,
+                                   GCancellable *cancellable G_GNUC_UNUSED)
+  {
+    BinaryOperationTaskData *data = static_cast <BinaryOperationTaskData *> (task_data);
+    g_autoptr(GError) error = nullptr;
+    torch::Tensor result;
+
+    if (!scortch_call_torch ([&]() { result = data->operation (data->left, data->right); }, &error))
+      {
+        g_task_return_error (task, static_cast <GError *> (g_steal_pointer (&error)));
+        return;
+      }
+
+    g_task_return_pointer (task, new torch::Tensor (result), delete_tensor);
+  }
+
+  void binary_operation_async (ScortchLocalTensor  *local_tensor,
+                               ScortchLocalTensor  *other,
+                               BinaryOperation      operation,
+                               gpointer             source_tag,
+                               GCancellable        *cancellable,
+                               GAsyncReadyCallback  callback,
+                               gpointer             user_data)
+  {
+    g_autoptr(GTask) task = g_task_new (local_tensor, cancellable, callback, user_data);
+
+    g_task_set_source_tag (task, source_tag);
+    g_task_set_task_data (task,
+                          new BinaryOperationTaskData {
+                            scortch_local_tensor_get_tensor (local_tensor),
+                            scortch_local_tensor_get_tensor (other),
+                            operation
+                          },
+                          delete_binary_operation_task_data);
+
+    scortch_worker_pool_run_task (task, binary_operation_in_worker);
+  }
+
+  /* The result is wrapped on the calling thread, so that the
+   * new GObject is never seen by the worker pool. */
+  ScortchLocalTensor * binary_operation_finish (ScortchLocalTensor  *local_tensor,
+                                                GAsyncResult        *result,
+                                                gpointer             source_tag,
+                                                GError             **error)
+  {
+    g_return_val_if_fail (g_task_is_valid (result, local_tensor), nullptr);
+    g_return_val_if_fail (g_task_get_source_tag (G_TASK (result)) == source_tag, nullptr);
+
+    torch::Tensor *tensor = static_cast <torch::Tensor *> (g_task_propagate_pointer (G_TASK (result), error));
+
+    if (tensor == nullptr)
+      return nullptr;
+
+    ScortchLocalTensor *local_result = scortch_local_tensor_new_from_tensor (*tensor);
+    delete tensor;
+
+    return local_result;
+  }
+}
+
+/**
+ * scortch_local_tensor_add:
+ * @local_tensor: A #ScortchLocalTensor
+ * @other: A #ScortchLocalTensor to add to @local_tensor
+ * @error: A #GError
+ *
+ * Add @other to @local_tensor elementwise, broadcasting
+ * the operands against each other if their shapes differ.
+ *
+ * Returns: (transfer full): A new #ScortchLocalTensor with the
+ *          result, or %NULL with @error set if the shapes of the
+ *          operands are incompatible.
+ */
+ScortchLocalTensor *
+scortch_local_tensor_add (ScortchLocalTensor  *local_tensor,
+                          ScortchLocalTensor  *other,
+                          GError             **error)
+{
+  return scortch_local_tensor_new_from_operation ([&]() {
+    return torch::add (scortch_local_tensor_get_tensor (local_tensor),
+                       scortch_local_tensor_get_tensor (other));
+  }, error);
+}
+
+/**
+ * scortch_local_tensor_sub:
+ * @local_tensor: A #ScortchLocalTensor
+ * @other: A #ScortchLocalTensor to subtract from @local_tensor
+ * @error: A #GError
+ *
+ * Subtract @other from @local_tensor elementwise, broadcasting
+ * the operands against each other if their shapes differ.
+ *
+ * Returns: (transfer full): A new #ScortchLocalTensor with the
+ *          result, or %NULL with @error set if the shapes of the
+ *          operands are incompatible.
+ */
+ScortchLocalTensor *
+scortch_local_tensor_sub (ScortchLocalTensor  *local_tensor,
+                          ScortchLocalTensor  *other,
+                          GError             **error)
+{
+  return scortch_local_tensor_new_from_operation ([&]() {
+    return torch::sub (scortch_local_tensor_get_tensor (local_tensor),
+                       scortch_local_tensor_get_tensor (other));
+  }, error);
+}
+
+/**
+ * scortch_local_tensor_mul:
+ * @local_tensor: A #ScortchLocalTensor
+ * @other: A #ScortchLocalTensor to multiply @local_tensor by
+ * @error: A #GError
+ *
+ * Multiply @local_tensor by @other elementwise, broadcasting
+ * the operands against each other if their shapes differ.
+ *
+ * Returns: (transfer full): A new #ScortchLocalTensor with the
+ *          result, or %NULL with @error set if the shapes of the
+ *          operands are incompatible.
+ */
+ScortchLocalTensor *
+scortch_local_tensor_mul (ScortchLocalTensor  *local_tensor,
+                          ScortchLocalTensor  *other,
+                          GError             **error)
+{
+  return scortch_local_tensor_new_from_operation ([&]() {
+    return torch::mul (scortch_local_tensor_get_tensor (local_tensor),
+                       scortch_local_tensor_get_tensor (other));
+  }, error);
+}
+
+/**
+ * scortch_local_tensor_div:
+ * @local_tensor: A #ScortchLocalTensor
+ * @other: A #ScortchLocalTensor to divide @local_tensor by
+ * @error: A #GError
+ *
+ * Divide @local_tensor by @other elementwise, broadcasting
+ * the operands against each other if their shapes differ.
+ *
+ * Returns: (transfer full): A new #ScortchLocalTensor with the
+ *          result, or %NULL with @error set if the shapes of the
+ *          operands are incompatible.
+ */
+ScortchLocalTensor *
+scortch_local_tensor_div (ScortchLocalTensor  *local_tensor,
+                          ScortchLocalTensor  *other,
+                          GError             **error)
+{
+  return scortch_local_tensor_new_from_operation ([&]() {
+    return torch::div (scortch_local_tensor_get_tensor (local_tensor),
+                       scortch_local_tensor_get_tensor (other));
+  }, error);
+}
+
+/**
+ * scortch_local_tensor_matmul:
+ * @local_tensor: A #ScortchLocalTensor
+ * @other: A #ScortchLocalTensor to multiply @local_tensor by
+ * @error: A #GError
+ *
+ * Compute the matrix product of @local_tensor and @other. If either
+ * operand has more than two dimensions, the leading dimensions are
+ * treated as a batch of matrices and broadcast against each other.
+ *
+ * Returns: (transfer full): A new #ScortchLocalTensor with the
+ *          result, or %NULL with @error set if the inner dimensions
+ *          of the operands do not match.
+ */
+ScortchLocalTensor *
+scortch_local_tensor_matmul (ScortchLocalTensor  *local_tensor,
+                             ScortchLocalTensor  *other,
+                             GError             **error)
+{
+  return scortch_local_tensor_new_from_operation ([&]() {
+    return torch::matmul (scortch_local_tensor_get_tensor (local_tensor),
+                          scortch_local_tensor_get_tensor (other));
+  }, error);
+}
+
+/**
+ * scortch_local_tensor_sum:
+ * @local_tensor: A #ScortchLocalTensor
+ * @dimension: The dimension to reduce, negative values count from the end.
+ * @keep_dimension: Whether to keep the reduced dimension with size 1.
+ * @error: A #GError
+ *
+ * Sum the elements of @local_tensor along @dimension.
+ *
+ * Returns: (transfer full): A new #ScortchLocalTensor with the
+ *          result, or %NULL with @error set if @dimension is
+ *          out of range.
+ */
+ScortchLocalTensor *
+scortch_local_tensor_sum (ScortchLocalTensor  *local_tensor,
+                          gint64               dimension,
+                          gboolean             keep_dimension,
+                          GError             **error)
+{
+  return scortch_local_tensor_new_from_operation ([&]() {
+    return torch::sum (scortch_local_tensor_get_tensor (local_tensor),
+                       torch::IntArrayRef (dimension),
+                       keep_dimension != FALSE);
+  }, error);
+}
+
+/**
+ * scortch_local_tensor_mean:
+ * @local_tensor: A #ScortchLocalTensor
+ * @dimension: The dimension to reduce, negative values count from the end.
+ * @keep_dimension: Whether to keep the reduced dimension with size 1.
+ * @error: A #GError
+ *
+ * Compute the mean of the elements of @local_tensor along @dimension.
+ * The tensor must have a floating point #ScortchDType.
+ *
+ * Returns: (transfer full): A new #ScortchLocalTensor with the
+ *          result, or %NULL with @error set if @dimension is
+ *          out of range or the tensor is not floating point.
+ */
+ScortchLocalTensor *
+scortch_local_tensor_mean (ScortchLocalTensor  *local_tensor,
+                           gint64               dimension,
+                           gboolean             keep_dimension,
+                           GError             **error)
+{
+  return scortch_local_tensor_new_from_operation ([&]() {
+    return torch::mean (scortch_local_tensor_get_tensor (local_tensor),
+                        torch::IntArrayRef (dimension),
+                        keep_dimension != FALSE);
+  }, error);
+}
+
+/**
+ * scortch_local_tensor_max:
+ * @local_tensor: A #ScortchLocalTensor
+ * @dimension: The dimension to reduce, negative values count from the end.
+ * @keep_dimension: Whether to keep the reduced dimension with size 1.
+ * @out_indices: (out) (optional) (transfer full): Return location for
+ *               a #ScortchLocalTensor of the indices of the maximum
+ *               values along @dimension.
+ * @error: A #GError
+ *
+ * Find the maximum of the elements of @local_tensor along @dimension.
+ *
+ * Returns: (transfer full): A new #ScortchLocalTensor with the
+ *          maximum values, or %NULL with @error set if @dimension
+ *          is out of range.
+ */
+ScortchLocalTensor *
+scortch_local_tensor_max (ScortchLocalTensor  *local_tensor,
+                          gint64               dimension,
+                          gboolean             keep_dimension,
+                          ScortchLocalTensor **out_indices,
+                          GError             **error)
+{
+  torch::Tensor values, indices;
+
+  if (!scortch_call_torch ([&]() {
+        std::tie (values, indices) = torch::max (scortch_local_tensor_get_tensor (local_tensor),
+                                                 dimension,
+                                                 keep_dimension != FALSE);
+      }, error))
+    return nullptr;
+
+  if (out_indices != nullptr)
+    *out_indices = scortch_local_tensor_new_from_tensor (indices);
+
+  return scortch_local_tensor_new_from_tensor (values);
+}
+
+/**
+ * scortch_local_tensor_softmax:
+ * @local_tensor: A #ScortchLocalTensor
+ * @dimension: The dimension to normalize, negative values count from the end.
+ * @error: A #GError
+ *
+ * Compute the softmax of @local_tensor along @dimension.
+ *
+ * Returns: (transfer full): A new #ScortchLocalTensor with the
+ *          result, or %NULL with @error set if @dimension is
+ *          out of range.
+ */
+ScortchLocalTensor *
+scortch_local_tensor_softmax (ScortchLocalTensor  *local_tensor,
+                              gint64               dimension,
+                              GError             **error)
+{
+  return scortch_local_tensor_new_from_operation ([&]() {
+    return torch::softmax (scortch_local_tensor_get_tensor (local_tensor), dimension);
+  }, error);
+}
+
+/**
+ * scortch_local_tensor_log_softmax:
+ * @local_tensor: A #ScortchLocalTensor
+ * @dimension: The dimension to normalize, negative values count from the end.
+ * @error: A #GError
+ *
+ * Compute the logarithm of the softmax of @local_tensor along
+ * @dimension. This is more numerically stable than taking the
+ * logarithm of %scortch_local_tensor_softmax.
+ *
+ * Returns: (transfer full): A new #ScortchLocalTensor with the
+ *          result, or %NULL with @error set if @dimension is
+ *          out of range.
+ */
+ScortchLocalTensor *
+scortch_local_tensor_log_softmax (ScortchLocalTensor  *local_tensor,
+                                  gint64               dimension,
+                                  GError             **error)
+{
+  return scortch_local_tensor_new_from_operation ([&]() {
+    return torch::log_softmax (scortch_local_tensor_get_tensor (local_tensor), dimension);
+  }, error);
+}
+
+/**
+ * scortch_local_tensor_reshape:
+ * @local_tensor: A #ScortchLocalTensor
+ * @dimensions: A #GVariant of type "ax" with the new dimensions. One
+ *              dimension may be -1, in which case it is inferred.
+ * @error: A #GError
+ *
+ * Reshape @local_tensor to @dimensions. The returned tensor shares
+ * storage with @local_tensor where the layout allows it, otherwise
+ * the data is copied.
+ *
+ * Returns: (transfer full): A new #ScortchLocalTensor with the
+ *          result, or %NULL with @error set if @dimensions do not
+ *          have the same number of elements as @local_tensor.
+ */
+ScortchLocalTensor *
+scortch_local_tensor_reshape (ScortchLocalTensor  *local_tensor,
+                              GVariant            *dimensions,
+                              GError             **error)
+{
+  g_autoptr(GVariant) dimensions_ref = g_variant_ref_sink (dimensions);
+  std::vector <int64_t> dimensions_vec (scortch_dimensions_from_g_variant (dimensions_ref));
+
+  return scortch_local_tensor_new_from_operation ([&]() {
+    return scortch_local_tensor_get_tensor (local_tensor).reshape (torch::IntArrayRef (dimensions_vec));
+  }, error);
+}
+
+/**
+ * scortch_local_tensor_transpose:
+ * @local_tensor: A #ScortchLocalTensor
+ * @first_dimension: The first dimension to swap.
+ * @second_dimension: The second dimension to swap.
+ * @error: A #GError
+ *
+ * Swap @first_dimension and @second_dimension of @local_tensor.
+ * The returned tensor shares storage with @local_tensor.
+ *
+ * Returns: (transfer full): A new #ScortchLocalTensor with the
+ *          result, or %NULL with @error set if either dimension
+ *          is out of range.
+ */
+ScortchLocalTensor *
+scortch_local_tensor_transpose (ScortchLocalTensor  *local_tensor,
+                                gint64               first_dimension,
+                                gint64               second_dimension,
+                                GError             **error)
+{
+  return scortch_local_tensor_new_from_operation ([&]() {
+    return scortch_local_tensor_get_tensor (local_tensor).transpose (first_dimension,
+                                                                     second_dimension);
+  }, error);
+}
+
+/**
+ * scortch_local_tensor_slice:
+ * @local_tensor: A #ScortchLocalTensor
+ * @dimension: The dimension to slice.
+ * @start: The index of the first element to keep. Negative
+ *         indices count from the end of @dimension.
+ * @end: The index one past the last element to keep, which is
+ *       clamped to the size of @dimension, so %G_MAXINT64 slices
+ *       to the end. Negative indices count from the end.
+ * @step: The distance between kept elements, which must be positive.
+ * @error: A #GError
+ *
+ * Take every @step th element from @start up to @end along
+ * @dimension of @local_tensor, like a Python slice. The returned
+ * tensor is a view sharing storage with @local_tensor, so nothing
+ * is copied and in-place changes to either are visible through
+ * both. The shared storage stays alive for as long as either
+ * tensor does.
+ *
+ * Returns: (transfer full): A new #ScortchLocalTensor with the
+ *          result, or %NULL with @error set if @dimension is out
+ *          of range or @step is not positive.
+ */
+ScortchLocalTensor *
+scortch_local_tensor_slice (ScortchLocalTensor  *local_tensor,
+                            gint64               dimension,
+                            gint64               start,
+                            gint64               end,
+                            gint64               step,
+                            GError             **error)
+{
+  return scortch_local_tensor_new_from_operation ([&]() {
+    return scortch_local_tensor_get_tensor (local_tensor).slice (dimension, start, end, step);
+  }, error);
+}
+
+/**
+ * scortch_local_tensor_narrow:
+ * @local_tensor: A #ScortchLocalTensor
+ * @dimension: The dimension to narrow.
+ * @start: The index of the first element to keep. Negative
+ *         indices count from the end of @dimension.
+ * @length: The number of elements to keep.
+ * @error: A #GError
+ *
+ * Take @length consecutive elements starting at @start along
+ * @dimension of @local_tensor. Unlike %scortch_local_tensor_slice,
+ * the range must lie entirely within @dimension. The returned
+ * tensor is a view sharing storage with @local_tensor.
+ *
+ * Returns: (transfer full): A new #ScortchLocalTensor with the
+ *          result, or %NULL with @error set if @dimension is out
+ *          of range or the elements do not fit in it.
+ */
+ScortchLocalTensor *
+scortch_local_tensor_narrow (ScortchLocalTensor  *local_tensor,
+                             gint64               dimension,
+                             gint64               start,
+                             gint64               length,
+                             GError             **error)
+{
+  return scortch_local_tensor_new_from_operation ([&]() {
+    return scortch_local_tensor_get_tensor (local_tensor).narrow (dimension, start, length);
+  }, error);
+}
+
+/**
+ * scortch_local_tensor_select:
+ * @local_tensor: A #ScortchLocalTensor
+ * @dimension: The dimension to select from.
+ * @index: The index to select. Negative indices count from the
+ *         end of @dimension.
+ * @error: A #GError
+ *
+ * Select the elements at @index along @dimension of
+ * @local_tensor, removing @dimension. For instance, selecting
+ * index 1 of dimension 0 of a matrix gives its second row. The
+ * returned tensor is a view sharing storage with @local_tensor.
+ *
+ * Returns: (transfer full): A new #ScortchLocalTensor with the
+ *          result, or %NULL with @error set if @dimension or
+ *          @index is out of range.
+ */
+ScortchLocalTensor *
+scortch_local_tensor_select (ScortchLocalTensor  *local_tensor,
+                             gint64               dimension,
+                             gint64               index,
+                             GError             **error)
+{
+  return scortch_local_tensor_new_from_operation ([&]() {
+    return scortch_local_tensor_get_tensor (local_tensor).select (dimension, index);
+  }, error);
+}
+
+/**
+ * scortch_local_tensor_view:
+ * @local_tensor: A #ScortchLocalTensor
+ * @dimensions: A #GVariant of type "ax" with the new dimensions. One
+ *              dimension may be -1, in which case it is inferred.
+ * @error: A #GError
+ *
+ * View @local_tensor with different dimensions. Unlike
+ * %scortch_local_tensor_reshape, which copies when it has to,
+ * the returned tensor always shares storage with @local_tensor.
+ *
+ * Returns: (transfer full): A new #ScortchLocalTensor with the
+ *          result, or %NULL with @error set if @dimensions do not
+ *          have the same number of elements as @local_tensor, or
+ *          the layout of @local_tensor, for instance after a
+ *          transpose, cannot be viewed with @dimensions.
+ */
+ScortchLocalTensor *
+scortch_local_tensor_view (ScortchLocalTensor  *local_tensor,
+                           GVariant            *dimensions,
+                           GError             **error)
+{
+  g_autoptr(GVariant) dimensions_ref = g_variant_ref_sink (dimensions);
+  std::vector <int64_t> dimensions_vec (scortch_dimensions_from_g_variant (dimensions_ref));
+
+  return scortch_local_tensor_new_from_operation ([&]() {
+    return scortch_local_tensor_get_tensor (local_tensor).view (torch::IntArrayRef (dimensions_vec));
+  }, error);
+}
+
+/**
+ * scortch_local_tensor_clone:
+ * @local_tensor: A #ScortchLocalTensor
+ * @error: A #GError
+ *
+ * Copy the elements of @local_tensor into new, contiguous storage.
+ * This gives a tensor that can be modified in place from one that
+ * is backed by read-only memory, such as a tensor created with
+ * %scortch_local_tensor_new_from_bytes.
+ *
+ * Returns: (transfer full): A new #ScortchLocalTensor with a copy
+ *          of the elements of @local_tensor, or %NULL with @error set.
+ */
+ScortchLocalTensor *
+scortch_local_tensor_clone (ScortchLocalTensor  *local_tensor,
+                            GError             **error)
+{
+  return scortch_local_tensor_new_from_operation ([&]() {
+    torch::Tensor const &tensor = scortch_local_tensor_get_tensor (local_tensor);
+
+    /* contiguous () already copies tensors that are not */
+    return tensor.is_contiguous () ? tensor.clone () : tensor.contiguous ();
+  }, error);
+}
+
+/**
+ * scortch_local_tensor_cat:
+ * @tensors: (array length=n_tensors): The #ScortchLocalTensor objects
+ *           to concatenate.
+ * @n_tensors: The number of tensors in @tensors.
+ * @dimension: The dimension to concatenate along.
+ * @error: A #GError
+ *
+ * Concatenate @tensors along @dimension. All of the tensors
+ * must have the same shape apart from @dimension.
+ *
+ * Returns: (transfer full): A new #ScortchLocalTensor with the
+ *          result, or %NULL with @error set if the shapes of the
+ *          tensors are incompatible.
+ */
+ScortchLocalTensor *
+scortch_local_tensor_cat (ScortchLocalTensor **tensors,
+                          gsize                n_tensors,
+                          gint64               dimension,
+                          GError             **error)
+{
+  std::vector <torch::Tensor> tensor_list;
+  tensor_list.reserve (n_tensors);
+
+  for (gsize i = 0; i < n_tensors; ++i)
+    tensor_list.push_back (scortch_local_tensor_get_tensor (tensors[i]));
+
+  return scortch_local_tensor_new_from_operation ([&]() {
+    return torch::cat (tensor_list, dimension);
+  }, error);
+}
+
+/**
+ * scortch_local_tensor_add_in_place:
+ * @local_tensor: A #ScortchLocalTensor
+ * @other: A #ScortchLocalTensor to add to @local_tensor
+ * @error: A #GError
+ *
+ * Add @other to @local_tensor elementwise, overwriting the contents
+ * of @local_tensor. @other must broadcast to the shape of @local_tensor.
+ *
+ * Returns: %TRUE on success, %FALSE with @error set if @other does
+ *          not broadcast to @local_tensor, the result cannot be
+ *          stored in its element type or @local_tensor is backed
+ *          by read-only memory.
+ */
+gboolean
+scortch_local_tensor_add_in_place (ScortchLocalTensor  *local_tensor,
+                                   ScortchLocalTensor  *other,
+                                   GError             **error)
+{
+  if (!scortch_tensor_check_writable (scortch_local_tensor_get_tensor (local_tensor), error))
+    return FALSE;
+
+  return scortch_call_torch ([&]() {
+    scortch_local_tensor_get_tensor (local_tensor).add_ (scortch_local_tensor_get_tensor (other));
+  }, error);
+}
+
+/**
+ * scortch_local_tensor_mul_in_place:
+ * @local_tensor: A #ScortchLocalTensor
+ * @other: A #ScortchLocalTensor to multiply @local_tensor by
+ * @error: A #GError
+ *
+ * Multiply @local_tensor by @other elementwise, overwriting the contents
+ * of @local_tensor. @other must broadcast to the shape of @local_tensor.
+ *
+ * Returns: %TRUE on success, %FALSE with @error set if @other does
+ *          not broadcast to @local_tensor, the result cannot be
+ *          stored in its element type or @local_tensor is backed
+ *          by read-only memory.
+ */
+gboolean
+scortch_local_tensor_mul_in_place (ScortchLocalTensor  *local_tensor,
+                                   ScortchLocalTensor  *other,
+                                   GError             **error)
+{
+  if (!scortch_tensor_check_writable (scortch_local_tensor_get_tensor (local_tensor), error))
+    return FALSE;
+
+  return scortch_call_torch ([&]() {
+    scortch_local_tensor_get_tensor (local_tensor).mul_ (scortch_local_tensor_get_tensor (other));
+  }, error);
+}
+
+/**
+ * scortch_local_tensor_clamp_in_place:
+ * @local_tensor: A #ScortchLocalTensor
+ * @minimum: The lower bound for each element.
+ * @maximum: The upper bound for each element.
+ * @error: A #GError
+ *
+ * Clamp each element of @local_tensor to the range [@minimum, @maximum],
+ * overwriting the contents of @local_tensor.
+ *
+ * Returns: %TRUE on success, %FALSE with @error set if the
+ *          element type of @local_tensor cannot be clamped or
+ *          @local_tensor is backed by read-only memory.
+ */
+gboolean
+scortch_local_tensor_clamp_in_place (ScortchLocalTensor  *local_tensor,
+                                     double               minimum,
+                                     double               maximum,
+                                     GError             **error)
+{
+  if (!scortch_tensor_check_writable (scortch_local_tensor_get_tensor (local_tensor), error))
+    return FALSE;
+
+  return scortch_call_torch ([&]() {
+    scortch_local_tensor_get_tensor (local_tensor).clamp_ (minimum, maximum);
+  }, error);
+}
+
+/**
+ * scortch_local_tensor_fill:
+ * @local_tensor: A #ScortchLocalTensor
+ * @value: The value to fill @local_tensor with.
+ * @error: A #GError
+ *
+ * Set every element of @local_tensor to @value, converted
+ * to the element type of @local_tensor.
+ *
+ * Returns: %TRUE on success, %FALSE with @error set if
+ *          @local_tensor is backed by read-only memory.
+ */
+gboolean
+scortch_local_tensor_fill (ScortchLocalTensor  *local_tensor,
+                           double               value,
+                           GError             **error)
+{
+  if (!scortch_tensor_check_writable (scortch_local_tensor_get_tensor (local_tensor), error))
+    return FALSE;
+
+  return scortch_call_torch ([&]() {
+    scortch_local_tensor_get_tensor (local_tensor).fill_ (value);
+  }, error);
+}
+
+/**
+ * scortch_local_tensor_add_out:
+ * @local_tensor: A #ScortchLocalTensor
+ * @other: A #ScortchLocalTensor to add to @local_tensor
+ * @destination: A #ScortchLocalTensor to write the result into
+ * @error: A #GError
+ *
+ * Like scortch_local_tensor_add(), but write the result into
+ * @destination instead of allocating a new tensor. @destination
+ * must already have the shape and dtype of the result.
+ *
+ * Returns: %TRUE on success, %FALSE with @error set if the operands
+ *          are incompatible, @destination does not match the result
+ *          or @destination is backed by read-only memory.
+ */
+gboolean
+scortch_local_tensor_add_out (ScortchLocalTensor  *local_tensor,
+                              ScortchLocalTensor  *other,
+                              ScortchLocalTensor  *destination,
+                              GError             **error)
+{
+  return elementwise_out (local_tensor, other, destination,
+                          promoted_scalar_type,
+                          [](torch::Tensor &out, torch::Tensor const &left, torch::Tensor const &right) {
+                            torch::add_out (out, left, right);
+                          },
+                          error);
+}
+
+/**
+ * scortch_local_tensor_sub_out:
+ * @local_tensor: A #ScortchLocalTensor
+ * @other: A #ScortchLocalTensor to subtract from @local_tensor
+ * @destination: A #ScortchLocalTensor to write the result into
+ * @error: A #GError
+ *
+ * Like scortch_local_tensor_sub(), but write the result into
+ * @destination instead of allocating a new tensor. @destination
+ * must already have the shape and dtype of the result.
+ *
+ * Returns: %TRUE on success, %FALSE with @error set if the operands
+ *          are incompatible, @destination does not match the result
+ *          or @destination is backed by read-only memory.
+ */
+gboolean
+scortch_local_tensor_sub_out (ScortchLocalTensor  *local_tensor,
+                              ScortchLocalTensor  *other,
+                              ScortchLocalTensor  *destination,
+                              GError             **error)
+{
+  return elementwise_out (local_tensor, other, destination,
+                          promoted_scalar_type,
+                          [](torch::Tensor &out, torch::Tensor const &left, torch::Tensor const &right) {
+                            torch::sub_out (out, left, right);
+                          },
+                          error);
+}
+
+/**
+ * scortch_local_tensor_mul_out:
+ * @local_tensor: A #ScortchLocalTensor
+ * @other: A #ScortchLocalTensor to multiply @local_tensor by
+ * @destination: A #ScortchLocalTensor to write the result into
+ * @error: A #GError
+ *
+ * Like scortch_local_tensor_mul(), but write the result into
+ * @destination instead of allocating a new tensor. @destination
+ * must already have the shape and dtype of the result.
+ *
+ * Returns: %TRUE on success, %FALSE with @error set if the operands
+ *          are incompatible, @destination does not match the result
+ *          or @destination is backed by read-only memory.
+ */
+gboolean
+scortch_local_tensor_mul_out (ScortchLocalTensor  *local_tensor,
+                              ScortchLocalTensor  *other,
+                              ScortchLocalTensor  *destination,
+                              GError             **error)
+{
+  return elementwise_out (local_tensor, other, destination,
+                          promoted_scalar_type,
+                          [](torch::Tensor &out, torch::Tensor const &left, torch::Tensor const &right) {
+                            torch::mul_out (out, left, right);
+                          },
+                          error);
+}
+
+/**
+ * scortch_local_tensor_div_out:
+ * @local_tensor: A #ScortchLocalTensor
+ * @other: A #ScortchLocalTensor to divide @local_tensor by
+ * @destination: A #ScortchLocalTensor to write the result into
+ * @error: A #GError
+ *
+ * Like scortch_local_tensor_div(), but write the result into
+ * @destination instead of allocating a new tensor. @destination
+ * must already have the shape and dtype of the result. Division
+ * is true division, so the result of dividing integers has the
+ * default floating point type, normally %SCORTCH_DTYPE_FLOAT32.
+ *
+ * Returns: %TRUE on success, %FALSE with @error set if the operands
+ *          are incompatible, @destination does not match the result
+ *          or @destination is backed by read-only memory.
+ */
+gboolean
+scortch_local_tensor_div_out (ScortchLocalTensor  *local_tensor,
+                              ScortchLocalTensor  *other,
+                              ScortchLocalTensor  *destination,
+                              GError             **error)
+{
+  return elementwise_out (local_tensor, other, destination,
+                          true_division_scalar_type,
+                          [](torch::Tensor &out, torch::Tensor const &left, torch::Tensor const &right) {
+                            torch::div_out (out, left, right);
+                          },
+                          error);
+}
+
+/**
+ * scortch_local_tensor_matmul_out:
+ * @local_tensor: A #ScortchLocalTensor
+ * @other: A #ScortchLocalTensor to multiply @local_tensor by
+ * @destination: A #ScortchLocalTensor to write the result into
+ * @error: A #GError
+ *
+ * Like scortch_local_tensor_matmul(), but write the result into
+ * @destination instead of allocating a new tensor. @destination
+ * must already have the shape and dtype of the result.
+ *
+ * Returns: %TRUE on success, %FALSE with @error set if the operands
+ *          are incompatible, @destination does not match the result
+ *          or @destination is backed by read-only memory.
+ */
+gboolean
+scortch_local_tensor_matmul_out (ScortchLocalTensor  *local_tensor,
+                                 ScortchLocalTensor  *other,
+                                 ScortchLocalTensor  *destination,
+                                 GError             **error)
+{
+  torch::Tensor &left = scortch_local_tensor_get_tensor (local_tensor);
+  torch::Tensor &right = scortch_local_tensor_get_tensor (other);
+  torch::Tensor &out = scortch_local_tensor_get_tensor (destination);
+  std::vector <int64_t> result_dimensions;
+
+  if (!matmul_result_dimensions (left, right, result_dimensions, error))
+    return FALSE;
+
+  if (!check_destination (out, result_dimensions, promoted_scalar_type (left, right), error))
+    return FALSE;
+
+  if (!scortch_tensor_check_writable (out, error))
+    return FALSE;
+
+  return scortch_call_torch ([&]() { torch::matmul_out (out, left, right); }, error);
+}
+
+/**
+ * scortch_local_tensor_add_async:
+ * @local_tensor: A #ScortchLocalTensor
+ * @other: A #ScortchLocalTensor
+ * @cancellable: (nullable): A #GCancellable
+ * @callback: A #GAsyncReadyCallback to call when the result is ready.
+ * @user_data: Data to pass to @callback.
+ *
+ * Asynchronous version of %scortch_local_tensor_add, computed on the
+ * scortch worker pool. Neither operand should be modified in
+ * place until @callback is called.
+ *
+ * Cancelling @cancellable only has an effect before the
+ * operation starts, since a running kernel is not interrupted.
+ */
+void
+scortch_local_tensor_add_async (ScortchLocalTensor  *local_tensor,
+                                ScortchLocalTensor  *other,
+                                GCancellable        *cancellable,
+                                GAsyncReadyCallback  callback,
+                                gpointer             user_data)
+{
+  binary_operation_async (local_tensor,
+                          other,
+                          [](torch::Tensor const &left, torch::Tensor const &right) {
+                            return torch::add (left, right);
+                          },
+                          (gpointer) scortch_local_tensor_add_async,
+                          cancellable,
+                          callback,
+                          user_data);
+}
+
+/**
+ * scortch_local_tensor_add_finish:
+ * @local_tensor: A #ScortchLocalTensor
+ * @result: A #GAsyncResult
+ * @error: A #GError
+ *
+ * Complete a call to %scortch_local_tensor_add_async.
+ *
+ * Returns: (transfer full): A new #ScortchLocalTensor with the
+ *          result, or %NULL with @error set.
+ */
+ScortchLocalTensor *
+scortch_local_tensor_add_finish (ScortchLocalTensor  *local_tensor,
+                                 GAsyncResult        *result,
+                                 GError             **error)
+{
+  return binary_operation_finish (local_tensor,
+                                  result,
+                                  (gpointer) scortch_local_tensor_add_async,
+                                  error);
+}
+
+/**
+ * scortch_local_tensor_sub_async:
+ * @local_tensor: A #ScortchLocalTensor
+ * @other: A #ScortchLocalTensor
+ * @cancellable: (nullable): A #GCancellable
+ * @callback: A #GAsyncReadyCallback to call when the result is ready.
+ * @user_data: Data to pass to @callback.
+ *
+ * Asynchronous version of %scortch_local_tensor_sub, computed on the
+ * scortch worker pool. Neither operand should be modified in
+ * place until @callback is called.
+ *
+ * Cancelling @cancellable only has an effect before the
+ * operation starts, since a running kernel is not interrupted.
+ */
+void
+scortch_local_tensor_sub_async (ScortchLocalTensor  *local_tensor,
+                                ScortchLocalTensor  *other,
+                                GCancellable        *cancellable,
+                                GAsyncReadyCallback  callback,
+                                gpointer             user_data)
+{
+  binary_operation_async (local_tensor,
+                          other,
+                          [](torch::Tensor const &left, torch::Tensor const &right) {
+                            return torch::sub (left, right);
+                          },
+                          (gpointer) scortch_local_tensor_sub_async,
+                          cancellable,
+                          callback,
+                          user_data);
+}
+
+/**
+ * scortch_local_tensor_sub_finish:
+ * @local_tensor: A #ScortchLocalTensor
+ * @result: A #GAsyncResult
+ * @error: A #GError
+ *
+ * Complete a call to %scortch_local_tensor_sub_async.
+ *
+ * Returns: (transfer full): A new #ScortchLocalTensor with the
+ *          result, or %NULL with @error set.
+ */
+ScortchLocalTensor *
+scortch_local_tensor_sub_finish (ScortchLocalTensor  *local_tensor,
+                                 GAsyncResult        *result,
+                                 GError             **error)
+{
+  return binary_operation_finish (local_tensor,
+                                  result,
+                                  (gpointer) scortch_local_tensor_sub_async,
+                                  error);
+}
+
+/**
+ * scortch_local_tensor_mul_async:
+ * @local_tensor: A #ScortchLocalTensor
+ * @other: A #ScortchLocalTensor
+ * @cancellable: (nullable): A #GCancellable
+ * @callback: A #GAsyncReadyCallback to call when the result is ready.
+ * @user_data: Data to pass to @callback.
+ *
+ * Asynchronous version of %scortch_local_tensor_mul, computed on the
+ * scortch worker pool. Neither operand should be modified in
+ * place until @callback is called.
+ *
+ * Cancelling @cancellable only has an effect before the
+ * operation starts, since a running kernel is not interrupted.
+ */
+void
+scortch_local_tensor_mul_async (ScortchLocalTensor  *local_tensor,
+                                ScortchLocalTensor  *other,
+                                GCancellable        *cancellable,
+                                GAsyncReadyCallback  callback,
+                                gpointer             user_data)
+{
+  binary_operation_async (local_tensor,
+                          other,
+                          [](torch::Tensor const &left, torch::Tensor const &right) {
+                            return torch::mul (left, right);
+                          },
+                          (gpointer) scortch_local_tensor_mul_async,
+                          cancellable,
+                          callback,
+                          user_data);
+}
+
+/**
+ * scortch_local_tensor_mul_finish:
+ * @local_tensor: A #ScortchLocalTensor
+ * @result: A #GAsyncResult
+ * @error: A #GError
+ *
+ * Complete a call to %scortch_local_tensor_mul_async.
+ *
+ * Returns: (transfer full): A new #ScortchLocalTensor with the
+ *          result, or %NULL with @error set.
+ */
+ScortchLocalTensor *
+scortch_local_tensor_mul_finish (ScortchLocalTensor  *local_tensor,
+                                 GAsyncResult        *result,
+                                 GError             **error)
+{
+  return binary_operation_finish (local_tensor,
+                                  result,
+                                  (gpointer) scortch_local_tensor_mul_async,
+                                  error);
+}
+
+/**
+ * scortch_local_tensor_div_async:
+ * @local_tensor: A #ScortchLocalTensor
+ * @other: A #ScortchLocalTensor
+ * @cancellable: (nullable): A #GCancellable
+ * @callback: A #GAsyncReadyCallback to call when the result is ready.
+ * @user_data: Data to pass to @callback.
+ *
+ * Asynchronous version of %scortch_local_tensor_div, computed on the
+ * scortch worker pool. Neither operand should be modified in
+ * place until @callback is called.
+ *
+ * Cancelling @cancellable only has an effect before the
+ * operation starts, since a running kernel is not interrupted.
+ */
+void
+scortch_local_tensor_div_async (ScortchLocalTensor  *local_tensor,
+                                ScortchLocalTensor  *other,
+                                GCancellable        *cancellable,
+                                GAsyncReadyCallback  callback,
+                                gpointer             user_data)
+{
+  binary_operation_async (local_tensor,
+                          other,
+                          [](torch::Tensor const &left, torch::Tensor const &right) {
+                            return torch::div (left, right);
+                          },
+                          (gpointer) scortch_local_tensor_div_async,
+                          cancellable,
+                          callback,
+                          user_data);
+}
+
+/**
+ * scortch_local_tensor_div_finish:
+ * @local_tensor: A #ScortchLocalTensor
+ * @result: A #GAsyncResult
+ * @error: A #GError
+ *
+ * Complete a call to %scortch_local_tensor_div_async.
+ *
+ * Returns: (transfer full): A new #ScortchLocalTensor with the
+ *          result, or %NULL with @error set.
+ */
+ScortchLocalTensor *
+scortch_local_tensor_div_finish (ScortchLocalTensor  *local_tensor,
+                                 GAsyncResult        *result,
+                                 GError             **error)
+{
+  return binary_operation_finish (local_tensor,
+                                  result,
+                                  (gpointer) scortch_local_tensor_div_async,
+                                  error);
+}
+
+/**
+ * scortch_local_tensor_matmul_async:
+ * @local_tensor: A #ScortchLocalTensor
+ * @other: A #ScortchLocalTensor
+ * @cancellable: (nullable): A #GCancellable
+ * @callback: A #GAsyncReadyCallback to call when the result is ready.
+ * @user_data: Data to pass to @callback.
+ *
+ * Asynchronous version of %scortch_local_tensor_matmul, computed on the
+ * scortch worker pool. Neither operand should be modified in
+ * place until @callback is called.
+ *
+ * Cancelling @cancellable only has an effect before the
+ * operation starts, since a running kernel is not interrupted.
+ */
+void
+scortch_local_tensor_matmul_async (ScortchLocalTensor  *local_tensor,
+                                   ScortchLocalTensor  *other,
+                                   GCancellable        *cancellable,
+                                   GAsyncReadyCallback  callback,
+                                   gpointer             user_data)
+{
+  binary_operation_async (local_tensor,
+                          other,
+                          [](torch::Tensor const &left, torch::Tensor const &right) {
+                            return torch::matmul (left, right);
+                          },
+                          (gpointer) scortch_local_tensor_matmul_async,
+                          cancellable,
+                          callback,
+                          user_data);
+}
+
+/**
+ * scortch_local_tensor_matmul_finish:
+ * @local_tensor: A #ScortchLocalTensor
+ * @result: A #GAsyncResult
+ * @error: A #GError
+ *
+ * Complete a call to %scortch_local_tensor_matmul_async.
+ *
+ * Returns: (transfer full): A new #ScortchLocalTensor with the
+ *          result, or %NULL with @error set.
+ */
+ScortchLocalTensor *
+scortch_local_tensor_matmul_finish (ScortchLocalTensor  *local_tensor,
+                                    GAsyncResult        *result,
+                                    GError             **error)
+{
+  return binary_operation_finish (local_tensor,
+                                  result,
+                                  (gpointer) scortch_local_tensor_matmul_async,
+                                  error);
+}
@@ -0,0 +1,179 @@
+/*
+ * /scortch/local-tensor-operations.h
+ *
+ * Tensor operations on ScortchLocalTensor, computed by
+ * PyTorch without copying data through GVariant. C header file.
+ *
+ * Copyright (C) 2018 Sam Spilsbury.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+#include <glib.h>
+#include <glib-object.h>
+
+#include <scortch/local-tensor.h>
+
+G_BEGIN_DECLS
+
+ScortchLocalTensor * scortch_local_tensor_add (ScortchLocalTensor  *local_tensor,
+                                               ScortchLocalTensor  *other,
+                                               GError             **error);
+ScortchLocalTensor * scortch_local_tensor_sub (ScortchLocalTensor  *local_tensor,
+                                               ScortchLocalTensor  *other,
+                                               GError             **error);
+ScortchLocalTensor * scortch_local_tensor_mul (ScortchLocalTensor  *local_tensor,
+                                               ScortchLocalTensor  *other,
+                                               GError             **error);
+ScortchLocalTensor * scortch_local_tensor_div (ScortchLocalTensor  *local_tensor,
+                                               ScortchLocalTensor  *other,
+                                               GError             **error);
+ScortchLocalTensor * scortch_local_tensor_matmul (ScortchLocalTensor  *local_tensor,
+                                                  ScortchLocalTensor  *other,
+                                                  GError             **error);
+
+ScortchLocalTensor * scortch_local_tensor_sum (ScortchLocalTensor  *local_tensor,
+                                               gint64               dimension,
+                                               gboolean             keep_dimension,
+                                               GError             **error);
+ScortchLocalTensor * scortch_local_tensor_mean (ScortchLocalTensor  *local_tensor,
+                                                gint64               dimension,
+                                                gboolean             keep_dimension,
+                                                GError             **error);
+ScortchLocalTensor * scortch_local_tensor_max (ScortchLocalTensor  *local_tensor,
+                                               gint64               dimension,
+                                               gboolean             keep_dimension,
+                                               ScortchLocalTensor **out_indices,
+                                               GError             **error);
+
+ScortchLocalTensor * scortch_local_tensor_softmax (ScortchLocalTensor  *local_tensor,
+                                                   gint64               dimension,
+                                                   GError             **error);
+ScortchLocalTensor * scortch_local_tensor_log_softmax (ScortchLocalTensor  *local_tensor,
+                                                       gint64               dimension,
+                                                       GError             **error);
+
+ScortchLocalTensor * scortch_local_tensor_reshape (ScortchLocalTensor  *local_tensor,
+                                                   GVariant            *dimensions,
+                                                   GError             **error);
+ScortchLocalTensor * scortch_local_tensor_transpose (ScortchLocalTensor  *local_tensor,
+                                                     gint64               first_dimension,
+                                                     gint64               second_dimension,
+                                                     GError             **error);
+ScortchLocalTensor * scortch_local_tensor_slice (ScortchLocalTensor  *local_tensor,
+                                                 gint64               dimension,
+                                                 gint64               start,
+                                                 gint64               end,
+                                                 gint64               step,
+                                                 GError             **error);
+ScortchLocalTensor * scortch_local_tensor_narrow (ScortchLocalTensor  *local_tensor,
+                                                  gint64               dimension,
+                                                  gint64               start,
+                                                  gint64               length,
+                                                  GError             **error);
+ScortchLocalTensor * scortch_local_tensor_select (ScortchLocalTensor  *local_tensor,
+                                                  gint64               dimension,
+                                                  gint64               index,
+                                                  GError             **error);
+ScortchLocalTensor * scortch_local_tensor_view (ScortchLocalTensor  *local_tensor,
+                                                GVariant            *dimensions,
+                                                GError             **error);
+ScortchLocalTensor * scortch_local_tensor_clone (ScortchLocalTensor  *local_tensor,
+                                                 GError             **error);
+ScortchLocalTensor * scortch_local_tensor_cat (ScortchLocalTensor **tensors,
+                                               gsize                n_tensors,
+                                               gint64               dimension,
+                                               GError             **error);
+
+gboolean scortch_local_tensor_add_in_place (ScortchLocalTensor  *local_tensor,
+                                            ScortchLocalTensor  *other,
+                                            GError             **error);
+gboolean scortch_local_tensor_mul_in_place (ScortchLocalTensor  *local_tensor,
+                                            ScortchLocalTensor  *other,
+                                            GError             **error);
+gboolean scortch_local_tensor_clamp_in_place (ScortchLocalTensor  *local_tensor,
+                                              double               minimum,
+                                              double               maximum,
+                                              GError             **error);
+gboolean scortch_local_tensor_fill (ScortchLocalTensor  *local_tensor,
+                                    double               value,
+                                    GError             **error);
+
+gboolean scortch_local_tensor_add_out (ScortchLocalTensor  *local_tensor,
+                                       ScortchLocalTensor  *other,
+                                       ScortchLocalTensor  *destination,
+                                       GError             **error);
+gboolean scortch_local_tensor_sub_out (ScortchLocalTensor  *local_tensor,
+                                       ScortchLocalTensor  *other,
+                                       ScortchLocalTensor  *destination,
+                                       GError             **error);
+gboolean scortch_local_tensor_mul_out (ScortchLocalTensor  *local_tensor,
+                                       ScortchLocalTensor  *other,
+                                       ScortchLocalTensor  *destination,
+                                       GError             **error);
+gboolean scortch_local_tensor_div_out (ScortchLocalTensor  *local_tensor,
+                                       ScortchLocalTensor  *other,
+                                       ScortchLocalTensor  *destination,
+                                       GError             **error);
+gboolean scortch_local_tensor_matmul_out (ScortchLocalTensor  *local_tensor,
+                                          ScortchLocalTensor  *other,
+                                          ScortchLocalTensor  *destination,
+                                          GError             **error);
+
+void scortch_local_tensor_add_async (ScortchLocalTensor  *local_tensor,
+                                     ScortchLocalTensor  *other,
+                                     GCancellable        *cancellable,
+                                     GAsyncReadyCallback  callback,
+                                     gpointer             user_data);
+ScortchLocalTensor * scortch_local_tensor_add_finish (ScortchLocalTensor  *local_tensor,
+                                                      GAsyncResult        *result,
+                                                      GError             **error);
+void scortch_local_tensor_sub_async (ScortchLocalTensor  *local_tensor,
+                                     ScortchLocalTensor  *other,
+                                     GCancellable        *cancellable,
+                                     GAsyncReadyCallback  callback,
+                                     gpointer             user_data);
+ScortchLocalTensor * scortch_local_tensor_sub_finish (ScortchLocalTensor  *local_tensor,
+                                                      GAsyncResult        *result,
+                                                      GError             **error);
+void scortch_local_tensor_mul_async (ScortchLocalTensor  *local_tensor,
+                                     ScortchLocalTensor  *other,
+                                     GCancellable        *cancellable,
+                                     GAsyncReadyCallback  callback,
+                                     gpointer             user_data);
+ScortchLocalTensor * scortch_local_tensor_mul_finish (ScortchLocalTensor  *local_tensor,
+                                                      GAsyncResult        *result,
+                                                      GError             **error);
+void scortch_local_tensor_div_async (ScortchLocalTensor  *local_tensor,
+                                     ScortchLocalTensor  *other,
+                                     GCancellable        *cancellable,
+                                     GAsyncReadyCallback  callback,
+                                     gpointer             user_data);
+ScortchLocalTensor * scortch_local_tensor_div_finish (ScortchLocalTensor  *local_tensor,
+                                                      GAsyncResult        *result,
+                                                      GError             **error);
+void scortch_local_tensor_matmul_async (ScortchLocalTensor  *local_tensor,
+                                        ScortchLocalTensor  *other,
+                                        GCancellable        *cancellable,
+                                        GAsyncReadyCallback  callback,
+                                        gpointer             user_data);
+ScortchLocalTensor * scortch_local_tensor_matmul_finish (ScortchLocalTensor  *local_tensor,
+                                                         GAsyncResult        *result,
+                                                         GError             **error);
+
+G_END_DECLS
@@ -0,0 +1,480 @@
+/*
+ * /scortch/local-tensor-shared.cpp
+ *
+ * Tensors in POSIX shared memory that cooperating or forked
+ * processes can attach to by handle.
+ *
+ * Copyright (C) 2018 Sam Spilsbury.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <gio/gio.h>
+#include <glib.h>
+
+#include <torch/torch.h>
+
+#include <scortch/local-tensor.h>
+#include <scortch/local-tensor-internal.h>
+#include <scortch/local-tensor-shared.h>
+#include <scortch/scortch-dtype-internal.h>
+#include <scortch/scortch-errors.h>
+#include <scortch/scortch-tracing-internal.h>
+
+namespace
+{
+  struct SharedSegment
+  {
+    std::string name;
+    size_t      size;
+
+    /* Only the process that created the segment unlinks it, so
+     * that forked workers dropping their tensors do not take it
+     * away from processes that have yet to attach. */
+    pid_t       owner;
+  };
+
+  /* Segments mapped by this process, by mapping address */
+  GMutex segments_mutex;
+  std::map <void const *, SharedSegment> segments;
+
+  bool set_error_from_errno (char const  *what,
+                             char const  *name,
+                             GError     **error)
+  {
+    int saved_errno = errno;
+
+    g_set_error (error,
+                 G_IO_ERROR,
+                 g_io_error_from_errno (saved_errno),
+                 "%s '%s': %s",
+                 what,
+                 name,
+                 g_strerror (saved_errno));
+    return false;
+  }
+
+  /* Shared memory cannot be mapped with a length of zero, so
+   * empty tensors still get a segment of one byte. Returns false
+   * if a dimension is negative or the size does not fit in a
+   * size_t, since dimensions may come from another process. */
+  bool segment_size_for (torch::IntArrayRef  dimensions,
+                         at::ScalarType      scalar_type,
+                         size_t             &size)
+  {
+    size_t n_elements = 1;
+
+    for (int64_t dimension : dimensions)
+      {
+        if (dimension < 0 ||
+            __builtin_mul_overflow (n_elements, static_cast <size_t> (dimension), &n_elements))
+          return false;
+      }
+
+    if (__builtin_mul_overflow (n_elements, c10::elementSize (scalar_type), &size))
+      return false;
+
+    size = std::max <size_t> (size, 1);
+    return true;
+  }
+
+  bool set_segment_size_error (GError **error)
+  {
+    g_set_error (error,
+                 SCORTCH_ERROR,
+                 SCORTCH_ERROR_INVALID_DIMENSIONS,
+                 "Tensor dimensions are negative or too large to allocate");
+    return false;
+  }
+
+  void release_segment (void *data)
+  {
+    g_mutex_lock (&segments_mutex);
+
+    auto it = segments.find (data);
+
+    if (it != segments.end ())
+      {
+        munmap (data, it->second.size);
+
+        if (it->second.owner == getpid ())
+          shm_unlink (it->second.name.c_str ());
+
+        segments.erase (it);
+      }
+
+    g_mutex_unlock (&segments_mutex);
+  }
+
+  /* Map a contiguous tensor over the shared memory object open
+   * as fd and remember its segment. Takes ownership of fd. */
+  bool map_segment (int                      fd,
+                    std::string const       &name,
+                    size_t                   size,
+                    pid_t                    owner,
+                    torch::IntArrayRef       dimensions,
+                    at::ScalarType           scalar_type,
+                    torch::Tensor           &tensor,
+                    GError                 **error)
+  {
+    void *mapping = mmap (nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close (fd);
+
+    if (mapping == MAP_FAILED)
+      return set_error_from_errno ("Could not map shared memory", name.c_str (), error);
+
+    g_mutex_lock (&segments_mutex);
+    segments[mapping] = SharedSegment { name, size, owner };
+    g_mutex_unlock (&segments_mutex);
+
+    tensor = torch::from_blob (mapping,
+                               dimensions,
+                               release_segment,
+                               torch::TensorOptions ().dtype (scalar_type));
+    return true;
+  }
+
+  /* Create a new shared memory segment and map a tensor of
+   * zeros over it. */
+  bool new_shared_tensor (torch::IntArrayRef   dimensions,
+                          at::ScalarType       scalar_type,
+                          torch::Tensor       &tensor,
+                          GError             **error)
+  {
+    static gint segment_counter = 0;
+    size_t size;
+    g_autofree char *name = nullptr;
+    int fd = -1;
+
+    if (!segment_size_for (dimensions, scalar_type, size))
+      return set_segment_size_error (error);
+
+    /* The name is only a rendezvous point, so retry with a new
+     * one in the unlikely case that another process took it. */
+    do
+      {
+        g_free (name);
+        name = g_strdup_printf ("/scortch-%d-%d-%08x",
+                                static_cast <int> (getpid ()),
+                                g_atomic_int_add (&segment_counter, 1),
+                                g_random_int ());
+        fd = shm_open (name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+      }
+    while (fd == -1 && errno == EEXIST);
+
+    if (fd == -1)
+      return set_error_from_errno ("Could not create shared memory", name, error);
+
+    /* New shared memory objects are zero-filled by the kernel */
+    if (ftruncate (fd, size) == -1)
+      {
+        set_error_from_errno ("Could not size shared memory", name, error);
+        close (fd);
+        shm_unlink (name);
+        return false;
+      }
+
+    if (!map_segment (fd, name, size, getpid (), dimensions, scalar_type, tensor, error))
+      {
+        shm_unlink (name);
+        return false;
+      }
+
+    return true;
+  }
+
+  /* Look up the segment tensor was mapped over, if it spans the
+   * whole of it in the layout its handle describes. */
+  bool lookup_segment (torch::Tensor const &tensor,
+                       SharedSegment       &segment)
+  {
+    bool found = false;
+    size_t size;
+
+    if (!tensor.is_contiguous () ||
+        tensor.storage_offset () != 0 ||
+        !segment_size_for (tensor.sizes (), tensor.scalar_type (), size))
+      return false;
+
+    g_mutex_lock (&segments_mutex);
+
+    /* The storage rather than the data pointer, which is null
+     * for empty tensors. */
+    auto it = segments.find (tensor.storage ().data ());
+
+    if (it != segments.end () && it->second.size == size)
+      {
+        segment = it->second;
+        found = true;
+      }
+
+    g_mutex_unlock (&segments_mutex);
+
+    return found;
+  }
+}
+
+/**
+ * scortch_local_tensor_new_shared:
+ * @dimensions: A #GVariant of type "ax" with the dimensions of the new tensor.
+ * @dtype: The #ScortchDType of the new tensor.
+ * @error: A #GError.
+ *
+ * Create a new #ScortchLocalTensor filled with zeros, with its
+ * storage in a new POSIX shared memory segment. Other processes
+ * can attach to the same storage with the handle returned by
+ * %scortch_local_tensor_get_shared_handle, and processes forked
+ * after this call share it already. Writes made through any of
+ * them are seen by all of the others.
+ *
+ * The segment is unlinked once the storage of the tensor in this
+ * process is no longer referenced. Processes that have attached
+ * by then keep their mapping.
+ *
+ * Returns: (transfer full): A new #ScortchLocalTensor, or %NULL
+ *          with @error set if the segment could not be created.
+ */
+ScortchLocalTensor *
+scortch_local_tensor_new_shared (GVariant      *dimensions,
+                                 ScortchDType   dtype,
+                                 GError       **error)
+{
+  g_autoptr(GVariant) dimensions_ref = g_variant_ref_sink (dimensions);
+
+  if (!scortch_dtype_check (dtype, error))
+    return nullptr;
+
+  std::vector <int64_t> dimensions_vector (scortch_dimensions_from_g_variant (dimensions_ref));
+  torch::Tensor tensor;
+
+  if (!new_shared_tensor (torch::IntArrayRef (dimensions_vector),
+                          scortch_dtype_to_scalar_type (dtype),
+                          tensor,
+                          error))
+    return nullptr;
+
+  return scortch_local_tensor_new_from_tensor (tensor);
+}
+
+/**
+ * scortch_local_tensor_share_memory:
+ * @local_tensor: A #ScortchLocalTensor
+ * @error: A #GError.
+ *
+ * Move the storage of @local_tensor into a new POSIX shared
+ * memory segment, as %scortch_local_tensor_new_shared would have
+ * allocated it, copying the elements once. Tensors that already
+ * span a whole shared segment are left as they are. Other tensors
+ * that shared storage with @local_tensor, for instance views of
+ * it, keep the old storage.
+ *
+ * Returns: %TRUE if @local_tensor is now shared, %FALSE with
+ *          @error set if the segment could not be created.
+ */
+gboolean
+scortch_local_tensor_share_memory (ScortchLocalTensor  *local_tensor,
+                                   GError             **error)
+{
+  torch::Tensor const &tensor = scortch_local_tensor_get_tensor (local_tensor);
+  SharedSegment segment;
+
+  if (lookup_segment (tensor, segment))
+    return TRUE;
+
+  ScortchTraceScope trace ("share-memory");
+  torch::Tensor shared;
+
+  if (!new_shared_tensor (tensor.sizes (), tensor.scalar_type (), shared, error))
+    return FALSE;
+
+  shared.copy_ (tensor);
+  trace.add_bytes (tensor.numel () * tensor.dtype ().itemsize ());
+  scortch_local_tensor_replace_tensor (local_tensor, shared);
+
+  return TRUE;
+}
+
+/**
+ * scortch_local_tensor_is_shared:
+ * @local_tensor: A #ScortchLocalTensor
+ *
+ * Check whether @local_tensor spans a whole shared memory
+ * segment, so that %scortch_local_tensor_get_shared_handle
+ * can describe it. Views of part of a shared tensor are not
+ * considered shared.
+ *
+ * Returns: %TRUE if @local_tensor is shared.
+ */
+gboolean
+scortch_local_tensor_is_shared (ScortchLocalTensor *local_tensor)
+{
+  SharedSegment segment;
+
+  return lookup_segment (scortch_local_tensor_get_tensor (local_tensor), segment);
+}
+
+/**
+ * scortch_local_tensor_get_shared_handle:
+ * @local_tensor: A #ScortchLocalTensor
+ *
+ * Get a handle that other processes can pass to
+ * %scortch_local_tensor_new_from_shared_handle to attach to the
+ * storage of @local_tensor. The handle is of type "(saxs)": the
+ * name of the shared memory segment, the dimensions and the
+ * #ScortchDType nickname. It is only valid for as long as the
+ * process that created the segment keeps it referenced.
+ *
+ * Returns: (transfer full) (nullable): A floating reference to a
+ *          new #GVariant handle, or %NULL if @local_tensor is
+ *          not shared.
+ */
+GVariant *
+scortch_local_tensor_get_shared_handle (ScortchLocalTensor *local_tensor)
+{
+  torch::Tensor const &tensor = scortch_local_tensor_get_tensor (local_tensor);
+  SharedSegment segment;
+
+  if (!lookup_segment (tensor, segment))
+    return nullptr;
+
+  return g_variant_new ("(s@axs)",
+                        segment.name.c_str (),
+                        g_variant_new_fixed_array (G_VARIANT_TYPE_INT64,
+                                                   tensor.sizes ().data (),
+                                                   tensor.dim (),
+                                                   sizeof (int64_t)),
+                        scortch_dtype_to_nick (scortch_local_tensor_get_dtype (local_tensor)));
+}
+
+/**
+ * scortch_local_tensor_new_from_shared_handle:
+ * @handle: A #GVariant handle of type "(saxs)", as returned by
+ *          %scortch_local_tensor_get_shared_handle.
+ * @error: A #GError.
+ *
+ * Create a new #ScortchLocalTensor over the shared memory segment
+ * described by @handle, without copying its elements. Writes to
+ * the new tensor are seen by every process attached to the
+ * segment. The segment stays mapped until the storage of the new
+ * tensor is no longer referenced.
+ *
+ * Returns: (transfer full): A new #ScortchLocalTensor, or %NULL
+ *          with @error set if @handle is malformed or the segment
+ *          does not exist or is too small.
+ */
+ScortchLocalTensor *
+scortch_local_tensor_new_from_shared_handle (GVariant  *handle,
+                                             GError   **error)
+{
+  g_autoptr(GVariant) handle_ref = g_variant_ref_sink (handle);
+
+  if (!g_variant_is_of_type (handle_ref, G_VARIANT_TYPE ("(saxs)")))
+    {
+      g_set_error (error,
+                   SCORTCH_ERROR,
+                   SCORTCH_ERROR_MALFORMED_DATA,
+                   "Expected a shared tensor handle of type (saxs), got %s",
+                   g_variant_get_type_string (handle_ref));
+      return nullptr;
+    }
+
+  g_autoptr(GVariant) dimensions_variant = nullptr;
+  char const *name = nullptr;
+  char const *nick = nullptr;
+
+  g_variant_get (handle_ref, "(&s@ax&s)", &name, &dimensions_variant, &nick);
+
+  std::vector <int64_t> dimensions (scortch_dimensions_from_g_variant (dimensions_variant));
+  ScortchDType dtype;
+
+  if (!scortch_dtype_from_nick (nick, &dtype))
+    {
+      g_set_error (error,
+                   SCORTCH_ERROR,
+                   SCORTCH_ERROR_INVALID_DATA_TYPE,
+                   "Unknown tensor dtype '%s'",
+                   nick);
+      return nullptr;
+    }
+
+  if (std::any_of (dimensions.begin (), dimensions.end (), [](int64_t d) { return d < 0; }))
+    {
+      g_set_error (error,
+                   SCORTCH_ERROR,
+                   SCORTCH_ERROR_INVALID_DIMENSIONS,
+                   "Shared tensor handle has negative dimensions");
+      return nullptr;
+    }
+
+  at::ScalarType scalar_type = scortch_dtype_to_scalar_type (dtype);
+  size_t size;
+
+  if (!segment_size_for (torch::IntArrayRef (dimensions), scalar_type, size))
+    {
+      set_segment_size_error (error);
+      return nullptr;
+    }
+
+  int fd = shm_open (name, O_RDWR | O_CLOEXEC, 0);
+
+  if (fd == -1)
+    {
+      set_error_from_errno ("Could not open shared memory", name, error);
+      return nullptr;
+    }
+
+  struct stat file_stat;
+
+  if (fstat (fd, &file_stat) == -1)
+    {
+      set_error_from_errno ("Could not stat shared memory", name, error);
+      close (fd);
+      return nullptr;
+    }
+
+  if (static_cast <size_t> (file_stat.st_size) != size)
+    {
+      g_set_error (error,
+                   SCORTCH_ERROR,
+                   SCORTCH_ERROR_INVALID_DIMENSIONS,
+                   "Expected %" G_GSIZE_FORMAT " bytes of tensor data in '%s', "
+                   "but it holds %" G_GOFFSET_FORMAT " bytes",
+                   size,
+                   name,
+                   static_cast <goffset> (file_stat.st_size));
+      close (fd);
+      return nullptr;
+    }
+
+  /* Attached segments are never unlinked from this process,
+   * whichever process created them. */
+  torch::Tensor tensor;
+
+  if (!map_segment (fd, name, size, 0, torch::IntArrayRef (dimensions), scalar_type, tensor, error))
+    return nullptr;
+
+  return scortch_local_tensor_new_from_tensor (tensor);
+}
@@ -0,0 +1,44 @@
+/*
+ * /scortch/local-tensor-shared.h
+ *
+ * Tensors in POSIX shared memory that cooperating or forked
+ * processes can attach to by handle.
+ *
+ * Copyright (C) 2018 Sam Spilsbury.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <glib-object.h>
+
+#include <scortch/local-tensor.h>
+#include <scortch/scortch-dtype.h>
+
+G_BEGIN_DECLS
+
+ScortchLocalTensor * scortch_local_tensor_new_shared (GVariant      *dimensions,
+                                                      ScortchDType   dtype,
+                                                      GError       **error);
+ScortchLocalTensor * scortch_local_tensor_new_from_shared_handle (GVariant  *handle,
+                                                                  GError   **error);
+
+gboolean scortch_local_tensor_share_memory (ScortchLocalTensor  *local_tensor,
+                                            GError             **error);
+gboolean scortch_local_tensor_is_shared (ScortchLocalTensor *local_tensor);
+GVariant * scortch_local_tensor_get_shared_handle (ScortchLocalTensor *local_tensor);
+
+G_END_DECLS
@@ -0,0 +1,406 @@
+/*
+ * /scortch/local-tensor-stream.cpp
+ *
+ * Streaming the elements of a ScortchLocalTensor in bounded
+ * chunks through GIO streams.
+ *
+ * Copyright (C) 2018 Sam Spilsbury.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include <gio/gio.h>
+#include <glib-object.h>
+#include <glib.h>
+
+#include <torch/torch.h>
+
+#include <scortch/local-tensor.h>
+#include <scortch/local-tensor-internal.h>
+#include <scortch/local-tensor-stream.h>
+#include <scortch/scortch-tracing-internal.h>
+
+namespace
+{
+  /* Upper bound on the size of a block of rows, which is the
+   * most that a stream ever copies at once. A single row larger
+   * than this is still streamed as one block. */
+  constexpr size_t block_size_bytes = 1024 * 1024;
+
+  template <typename T>
+  void safe_delete (T *t)
+  {
+    delete t;
+  }
+
+  /* Walks the rows of a tensor in blocks, in row-major order.
+   * Blocks of contiguous tensors are views of their storage. Other
+   * tensors have each block copied out, and copied back by flush
+   * if the blocks are written to. */
+  class TensorBlocks
+  {
+    public:
+      /* The alias keeps the stream on the storage the tensor had
+       * when it was opened, even if its data is replaced later. */
+      TensorBlocks (torch::Tensor const &tensor,
+                    bool                 write_back_blocks) :
+        rows (tensor.dim () == 0 ? tensor.reshape ({ 1 }) : tensor.alias ()),
+        write_back (write_back_blocks),
+        next_row (0),
+        offset (0),
+        n_bytes (rows.numel () * rows.dtype ().itemsize ()),
+        n_transferred (0)
+      {
+        size_t row_bytes = rows.size (0) > 0 ? n_bytes / rows.size (0) : 0;
+
+        rows_per_block = std::max <int64_t> (block_size_bytes / std::max <size_t> (row_bytes, 1), 1);
+      }
+
+      /* Pointer to the next byte in the current block and the
+       * number of bytes left in it, loading the next block if
+       * the current one is used up. Returns false once every
+       * block has been used. */
+      bool next_span (char   **data,
+                      size_t  *n_available)
+      {
+        while (remaining () == 0)
+          {
+            flush ();
+
+            if (next_row >= rows.size (0))
+              return false;
+
+            int64_t n_rows = std::min (rows_per_block, rows.size (0) - next_row);
+
+            target = rows.narrow (0, next_row, n_rows);
+            block = target.contiguous ();
+            next_row += n_rows;
+            offset = 0;
+          }
+
+        *data = static_cast <char *> (block.data_ptr ()) + offset;
+        *n_available = remaining ();
+        return true;
+      }
+
+      void advance (size_t n)
+      {
+        offset += n;
+        n_transferred += n;
+      }
+
+      /* Write a copied block back to the tensor */
+      void flush ()
+      {
+        if (write_back && block.defined () && !block.is_same (target))
+          target.copy_ (block);
+      }
+
+      size_t total_bytes () const
+      {
+        return n_bytes;
+      }
+
+      size_t transferred_bytes () const
+      {
+        return n_transferred;
+      }
+
+    private:
+      size_t remaining () const
+      {
+        return block.defined () ? block.numel () * block.dtype ().itemsize () - offset : 0;
+      }
+
+      torch::Tensor rows;
+      torch::Tensor target;
+      torch::Tensor block;
+      bool          write_back;
+      int64_t       rows_per_block;
+      int64_t       next_row;
+      size_t        offset;
+      size_t        n_bytes;
+      size_t        n_transferred;
+  };
+}
+
+#define SCORTCH_TYPE_TENSOR_INPUT_STREAM scortch_tensor_input_stream_get_type ()
+G_DECLARE_FINAL_TYPE (ScortchTensorInputStream, scortch_tensor_input_stream, SCORTCH, TENSOR_INPUT_STREAM, GInputStream)
+
+#define SCORTCH_TYPE_TENSOR_OUTPUT_STREAM scortch_tensor_output_stream_get_type ()
+G_DECLARE_FINAL_TYPE (ScortchTensorOutputStream, scortch_tensor_output_stream, SCORTCH, TENSOR_OUTPUT_STREAM, GOutputStream)
+
+struct _ScortchTensorInputStream
+{
+  GInputStream parent_instance;
+};
+
+typedef struct _ScortchTensorInputStreamPrivate {
+  TensorBlocks *blocks;
+} ScortchTensorInputStreamPrivate;
+
+struct _ScortchTensorOutputStream
+{
+  GOutputStream parent_instance;
+};
+
+typedef struct _ScortchTensorOutputStreamPrivate {
+  TensorBlocks *blocks;
+  gboolean read_only;
+} ScortchTensorOutputStreamPrivate;
+
+G_DEFINE_TYPE_WITH_PRIVATE (ScortchTensorInputStream, scortch_tensor_input_stream, G_TYPE_INPUT_STREAM);
+G_DEFINE_TYPE_WITH_PRIVATE (ScortchTensorOutputStream, scortch_tensor_output_stream, G_TYPE_OUTPUT_STREAM);
+
+static gssize
+scortch_tensor_input_stream_read (GInputStream  *stream,
+                                  void          *buffer,
+                                  gsize          count,
+                                  GCancellable  *cancellable,
+                                  GError       **error)
+{
+  ScortchTensorInputStreamPrivate *priv =
+    static_cast <ScortchTensorInputStreamPrivate *> (scortch_tensor_input_stream_get_instance_private (SCORTCH_TENSOR_INPUT_STREAM (stream)));
+  ScortchTraceScope trace ("read-stream");
+  char *data;
+  size_t n_available;
+
+  if (g_cancellable_set_error_if_cancelled (cancellable, error))
+    return -1;
+
+  /* End of stream */
+  if (!priv->blocks->next_span (&data, &n_available))
+    return 0;
+
+  size_t n_read = std::min (n_available, count);
+
+  memcpy (buffer, data, n_read);
+  priv->blocks->advance (n_read);
+  trace.add_bytes (n_read);
+
+  return n_read;
+}
+
+static void
+scortch_tensor_input_stream_finalize (GObject *object)
+{
+  ScortchTensorInputStreamPrivate *priv =
+    static_cast <ScortchTensorInputStreamPrivate *> (scortch_tensor_input_stream_get_instance_private (SCORTCH_TENSOR_INPUT_STREAM (object)));
+
+  g_clear_pointer (&priv->blocks, (GDestroyNotify) safe_delete <TensorBlocks>);
+
+  G_OBJECT_CLASS (scortch_tensor_input_stream_parent_class)->finalize (object);
+}
+
+static void
+scortch_tensor_input_stream_class_init (ScortchTensorInputStreamClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+  GInputStreamClass *stream_class = G_INPUT_STREAM_CLASS (klass);
+
+  object_class->finalize = scortch_tensor_input_stream_finalize;
+  stream_class->read_fn = scortch_tensor_input_stream_read;
+}
+
+static void
+scortch_tensor_input_stream_init (ScortchTensorInputStream *stream G_GNUC_UNUSED)
+{
+}
+
+static gssize
+scortch_tensor_output_stream_write (GOutputStream  *stream,
+                                    void const     *buffer,
+                                    gsize           count,
+                                    GCancellable   *cancellable,
+                                    GError        **error)
+{
+  ScortchTensorOutputStreamPrivate *priv =
+    static_cast <ScortchTensorOutputStreamPrivate *> (scortch_tensor_output_stream_get_instance_private (SCORTCH_TENSOR_OUTPUT_STREAM (stream)));
+  ScortchTraceScope trace ("write-stream");
+  char *data;
+  size_t n_available;
+
+  if (g_cancellable_set_error_if_cancelled (cancellable, error))
+    return -1;
+
+  if (priv->read_only)
+    {
+      g_set_error (error,
+                   G_IO_ERROR,
+                   G_IO_ERROR_READ_ONLY,
+                   "Tensor is backed by read-only memory and cannot be written to");
+      return -1;
+    }
+
+  if (!priv->blocks->next_span (&data, &n_available))
+    {
+      g_set_error (error,
+                   G_IO_ERROR,
+                   G_IO_ERROR_NO_SPACE,
+                   "Tensor only holds %" G_GSIZE_FORMAT " bytes",
+                   priv->blocks->total_bytes ());
+      return -1;
+    }
+
+  size_t n_written = std::min (n_available, count);
+
+  memcpy (data, buffer, n_written);
+  priv->blocks->advance (n_written);
+  trace.add_bytes (n_written);
+
+  return n_written;
+}
+
+static gboolean
+scortch_tensor_output_stream_flush (GOutputStream  *stream,
+                                    GCancellable   *cancellable G_GNUC_UNUSED,
+                                    GError        **error G_GNUC_UNUSED)
+{
+  ScortchTensorOutputStreamPrivate *priv =
+    static_cast <ScortchTensorOutputStreamPrivate *> (scortch_tensor_output_stream_get_instance_private (SCORTCH_TENSOR_OUTPUT_STREAM (stream)));
+
+  priv->blocks->flush ();
+
+  return TRUE;
+}
+
+static gboolean
+scortch_tensor_output_stream_close (GOutputStream  *stream,
+                                    GCancellable   *cancellable G_GNUC_UNUSED,
+                                    GError        **error)
+{
+  ScortchTensorOutputStreamPrivate *priv =
+    static_cast <ScortchTensorOutputStreamPrivate *> (scortch_tensor_output_stream_get_instance_private (SCORTCH_TENSOR_OUTPUT_STREAM (stream)));
+
+  priv->blocks->flush ();
+
+  /* A short write usually means that the source was truncated */
+  if (priv->blocks->transferred_bytes () != priv->blocks->total_bytes ())
+    {
+      g_set_error (error,
+                   G_IO_ERROR,
+                   G_IO_ERROR_PARTIAL_INPUT,
+                   "Expected %" G_GSIZE_FORMAT " bytes of tensor data, "
+                   "but only %" G_GSIZE_FORMAT " were written",
+                   priv->blocks->total_bytes (),
+                   priv->blocks->transferred_bytes ());
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+static void
+scortch_tensor_output_stream_finalize (GObject *object)
+{
+  ScortchTensorOutputStreamPrivate *priv =
+    static_cast <ScortchTensorOutputStreamPrivate *> (scortch_tensor_output_stream_get_instance_private (SCORTCH_TENSOR_OUTPUT_STREAM (object)));
+
+  g_clear_pointer (&priv->blocks, (GDestroyNotify) safe_delete <TensorBlocks>);
+
+  G_OBJECT_CLASS (scortch_tensor_output_stream_parent_class)->finalize (object);
+}
+
+static void
+scortch_tensor_output_stream_class_init (ScortchTensorOutputStreamClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+  GOutputStreamClass *stream_class = G_OUTPUT_STREAM_CLASS (klass);
+
+  object_class->finalize = scortch_tensor_output_stream_finalize;
+  stream_class->write_fn = scortch_tensor_output_stream_write;
+  stream_class->flush = scortch_tensor_output_stream_flush;
+  stream_class->close_fn = scortch_tensor_output_stream_close;
+}
+
+static void
+scortch_tensor_output_stream_init (ScortchTensorOutputStream *stream G_GNUC_UNUSED)
+{
+}
+
+/**
+ * scortch_local_tensor_open_read_stream:
+ * @local_tensor: A #ScortchLocalTensor
+ *
+ * Open a #GInputStream yielding the raw elements of @local_tensor
+ * in row-major order, in the layout that
+ * %scortch_local_tensor_get_bytes would return. Unlike
+ * %scortch_local_tensor_get_data, the elements are never all
+ * copied at once: each read copies from a block of at most about
+ * a megabyte of rows, so the stream can be spliced to a file,
+ * socket or compressor with a constant memory overhead. Blocks of
+ * contiguous tensors are read straight from their storage.
+ *
+ * The default asynchronous implementations of #GInputStream run
+ * reads in a worker thread, so the stream can be drained with
+ * g_output_stream_splice_async() while the main loop keeps
+ * running. @local_tensor should not be modified in place until
+ * the stream is closed.
+ *
+ * Returns: (transfer full): A new #GInputStream.
+ */
+GInputStream *
+scortch_local_tensor_open_read_stream (ScortchLocalTensor *local_tensor)
+{
+  ScortchTensorInputStream *stream =
+    SCORTCH_TENSOR_INPUT_STREAM (g_object_new (SCORTCH_TYPE_TENSOR_INPUT_STREAM, NULL));
+  ScortchTensorInputStreamPrivate *priv =
+    static_cast <ScortchTensorInputStreamPrivate *> (scortch_tensor_input_stream_get_instance_private (stream));
+
+  priv->blocks = new TensorBlocks (scortch_local_tensor_get_tensor (local_tensor), false);
+
+  return G_INPUT_STREAM (stream);
+}
+
+/**
+ * scortch_local_tensor_open_write_stream:
+ * @local_tensor: A #ScortchLocalTensor
+ *
+ * Open a #GOutputStream that fills the already allocated elements
+ * of @local_tensor, in the same order and layout that
+ * %scortch_local_tensor_open_read_stream yields them. The
+ * dimensions and #ScortchDType of @local_tensor have to be set
+ * beforehand. Written bytes go straight into the storage of
+ * contiguous tensors and are otherwise copied into place a block
+ * of rows at a time, when the block is full, or when the stream
+ * is flushed or closed.
+ *
+ * Writing past the end of @local_tensor fails with
+ * %G_IO_ERROR_NO_SPACE, and closing the stream before all of it
+ * was written fails with %G_IO_ERROR_PARTIAL_INPUT, keeping what
+ * was written so far. If @local_tensor is backed by read-only
+ * memory, for instance an immutable #GBytes, every write fails
+ * with %G_IO_ERROR_READ_ONLY.
+ *
+ * Returns: (transfer full): A new #GOutputStream.
+ */
+GOutputStream *
+scortch_local_tensor_open_write_stream (ScortchLocalTensor *local_tensor)
+{
+  ScortchTensorOutputStream *stream =
+    SCORTCH_TENSOR_OUTPUT_STREAM (g_object_new (SCORTCH_TYPE_TENSOR_OUTPUT_STREAM, NULL));
+  ScortchTensorOutputStreamPrivate *priv =
+    static_cast <ScortchTensorOutputStreamPrivate *> (scortch_tensor_output_stream_get_instance_private (stream));
+
+  torch::Tensor const &tensor = scortch_local_tensor_get_tensor (local_tensor);
+
+  priv->blocks = new TensorBlocks (tensor, true);
+  priv->read_only = !scortch_tensor_check_writable (tensor, nullptr);
+
+  return G_OUTPUT_STREAM (stream);
+}
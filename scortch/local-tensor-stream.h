@@ -0,0 +1,35 @@
+/*
+ * /scortch/local-tensor-stream.h
+ *
+ * Streaming the elements of a ScortchLocalTensor in bounded
+ * chunks through GIO streams.
+ *
+ * Copyright (C) 2018 Sam Spilsbury.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+#include <scortch/local-tensor.h>
+
+G_BEGIN_DECLS
+
+GInputStream * scortch_local_tensor_open_read_stream (ScortchLocalTensor *local_tensor);
+GOutputStream * scortch_local_tensor_open_write_stream (ScortchLocalTensor *local_tensor);
+
+G_END_DECLS
@@ -0,0 +1,403 @@
+/*
+ * /scortch/local-tensor-unix.cpp
+ *
+ * Passing tensors between processes as sealed memfd file
+ * descriptors. C++ source file.
+ *
+ * Copyright (C) 2018 Sam Spilsbury.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <gio/gio.h>
+#include <gio/gunixfdlist.h>
+#include <glib.h>
+
+#include <torch/torch.h>
+
+#include <scortch/local-tensor.h>
+#include <scortch/local-tensor-internal.h>
+#include <scortch/local-tensor-unix.h>
+#include <scortch/scortch-dtype-internal.h>
+#include <scortch/scortch-errors.h>
+#include <scortch/scortch-tracing-internal.h>
+
+namespace
+{
+  /* The receiver relies on these to know that the contents
+   * cannot change or be truncated under its mapping. */
+  constexpr int required_seals = F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE;
+
+  bool set_error_from_errno (char const  *what,
+                             GError     **error)
+  {
+    int saved_errno = errno;
+
+    g_set_error (error,
+                 G_IO_ERROR,
+                 g_io_error_from_errno (saved_errno),
+                 "%s: %s",
+                 what,
+                 g_strerror (saved_errno));
+    return false;
+  }
+
+  /* Number of bytes from the first to one past the last element
+   * of a tensor with non-negative strides. The dimensions and
+   * strides may come from an untrusted header, so returns false
+   * if the span does not fit in a size_t. */
+  bool strided_span_bytes (std::vector <int64_t> const &dimensions,
+                           std::vector <int64_t> const &strides,
+                           size_t                       element_size,
+                           size_t                      &size)
+  {
+    size_t last_element = 0;
+
+    size = 0;
+
+    for (size_t i = 0; i < dimensions.size (); ++i)
+      {
+        if (dimensions[i] == 0)
+          return true;
+      }
+
+    for (size_t i = 0; i < dimensions.size (); ++i)
+      {
+        size_t extent;
+
+        if (__builtin_mul_overflow (static_cast <size_t> (dimensions[i] - 1),
+                                    static_cast <size_t> (strides[i]),
+                                    &extent) ||
+            __builtin_add_overflow (last_element, extent, &last_element))
+          return false;
+      }
+
+    return !__builtin_add_overflow (last_element, 1, &last_element) &&
+           !__builtin_mul_overflow (last_element, element_size, &size);
+  }
+
+  bool set_span_overflow_error (GError **error)
+  {
+    g_set_error (error,
+                 SCORTCH_ERROR,
+                 SCORTCH_ERROR_INVALID_DIMENSIONS,
+                 "Tensor dimensions and strides describe more memory than can be addressed");
+    return false;
+  }
+
+  std::vector <int64_t> contiguous_strides (torch::IntArrayRef dimensions)
+  {
+    std::vector <int64_t> strides (dimensions.size ());
+    int64_t stride = 1;
+
+    for (size_t i = dimensions.size (); i > 0; --i)
+      {
+        strides[i - 1] = stride;
+        stride *= std::max <int64_t> (dimensions[i - 1], 1);
+      }
+
+    return strides;
+  }
+
+  /* Copy tensor into a new memfd and seal it. Dense tensors keep
+   * their strides, so that a transposed tensor is not permuted
+   * on the way, anything else is made contiguous. Returns -1
+   * with error set on failure. */
+  int new_sealed_memfd_for_tensor (torch::Tensor const    &tensor,
+                                   std::vector <int64_t>  &strides,
+                                   GError                **error)
+  {
+    ScortchTraceScope trace ("to-memfd");
+    std::vector <int64_t> dimensions (tensor.sizes ().begin (), tensor.sizes ().end ());
+
+    if (tensor.is_non_overlapping_and_dense ())
+      strides.assign (tensor.strides ().begin (), tensor.strides ().end ());
+    else
+      strides = contiguous_strides (tensor.sizes ());
+
+    size_t size;
+
+    if (!strided_span_bytes (dimensions, strides, tensor.dtype ().itemsize (), size))
+      {
+        set_span_overflow_error (error);
+        return -1;
+      }
+
+    int fd = memfd_create ("scortch-tensor", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+
+    if (fd == -1)
+      {
+        set_error_from_errno ("Could not create memfd", error);
+        return -1;
+      }
+
+    if (ftruncate (fd, size) == -1)
+      {
+        set_error_from_errno ("Could not size memfd", error);
+        close (fd);
+        return -1;
+      }
+
+    if (size > 0)
+      {
+        void *mapping = mmap (nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+        if (mapping == MAP_FAILED)
+          {
+            set_error_from_errno ("Could not map memfd", error);
+            close (fd);
+            return -1;
+          }
+
+        torch::from_blob (mapping,
+                          tensor.sizes (),
+                          torch::IntArrayRef (strides),
+                          torch::TensorOptions ().dtype (tensor.scalar_type ())).copy_ (tensor);
+
+        /* The write seal cannot be added while a writable
+         * shared mapping exists. */
+        munmap (mapping, size);
+        trace.add_bytes (size);
+      }
+
+    if (fcntl (fd, F_ADD_SEALS, required_seals | F_SEAL_SEAL) == -1)
+      {
+        set_error_from_errno ("Could not seal memfd", error);
+        close (fd);
+        return -1;
+      }
+
+    return fd;
+  }
+}
+
+/**
+ * scortch_local_tensor_to_fd_variant:
+ * @local_tensor: A #ScortchLocalTensor
+ * @fd_list: A #GUnixFDList to append the file descriptor to.
+ * @error: A #GError.
+ *
+ * Copy the elements of @local_tensor once into a new sealed
+ * memfd, append it to @fd_list and return a header describing
+ * it, of type "(axsaxh)": the dimensions, the #ScortchDType
+ * nickname, the strides in elements and the index of the file
+ * descriptor in @fd_list.
+ *
+ * The header and @fd_list can be sent over D-Bus, for instance
+ * with g_dbus_connection_call_with_unix_fd_list(), and turned
+ * back into a tensor on the other end with
+ * %scortch_local_tensor_new_from_fd_variant. Only the header
+ * goes through the message body, so the cost of sending a
+ * tensor does not depend on its size.
+ *
+ * The memfd is sealed against writing, growing and shrinking,
+ * so receivers can map it without trusting the sender.
+ *
+ * Returns: (transfer full): A floating reference to a new
+ *          #GVariant header, or %NULL with @error set if the
+ *          memfd could not be created.
+ */
+GVariant *
+scortch_local_tensor_to_fd_variant (ScortchLocalTensor  *local_tensor,
+                                    GUnixFDList         *fd_list,
+                                    GError             **error)
+{
+  torch::Tensor const &tensor = scortch_local_tensor_get_tensor (local_tensor);
+  ScortchDType dtype = scortch_local_tensor_get_dtype (local_tensor);
+  std::vector <int64_t> strides;
+  int fd = new_sealed_memfd_for_tensor (tensor, strides, error);
+
+  if (fd == -1)
+    return nullptr;
+
+  int index = g_unix_fd_list_append (fd_list, fd, error);
+  close (fd);
+
+  if (index == -1)
+    return nullptr;
+
+  return g_variant_new ("(@axs@axh)",
+                        g_variant_new_fixed_array (G_VARIANT_TYPE_INT64,
+                                                   tensor.sizes ().data (),
+                                                   tensor.dim (),
+                                                   sizeof (int64_t)),
+                        scortch_dtype_to_nick (dtype),
+                        g_variant_new_fixed_array (G_VARIANT_TYPE_INT64,
+                                                   strides.data (),
+                                                   strides.size (),
+                                                   sizeof (int64_t)),
+                        index);
+}
+
+/**
+ * scortch_local_tensor_new_from_fd_variant:
+ * @variant: A #GVariant header of type "(axsaxh)", as returned by
+ *           %scortch_local_tensor_to_fd_variant.
+ * @fd_list: The #GUnixFDList holding the file descriptor @variant refers to.
+ * @error: A #GError.
+ *
+ * Create a new #ScortchLocalTensor over a private mapping of the
+ * memfd described by @variant, without copying its elements. The
+ * tensor can be modified in place, in which case the modified
+ * pages are copied and the changes are never seen by the sender.
+ * The memfd is unmapped once the tensor storage is no longer
+ * referenced.
+ *
+ * Returns: (transfer full): A new #ScortchLocalTensor, or %NULL
+ *          with @error set if the header is malformed, the file
+ *          descriptor is not a sealed memfd large enough to hold
+ *          the described tensor, or it could not be mapped.
+ */
+ScortchLocalTensor *
+scortch_local_tensor_new_from_fd_variant (GVariant     *variant,
+                                          GUnixFDList  *fd_list,
+                                          GError      **error)
+{
+  g_autoptr(GVariant) variant_ref = g_variant_ref_sink (variant);
+
+  if (!g_variant_is_of_type (variant_ref, G_VARIANT_TYPE ("(axsaxh)")))
+    {
+      g_set_error (error,
+                   SCORTCH_ERROR,
+                   SCORTCH_ERROR_MALFORMED_DATA,
+                   "Expected a tensor header of type (axsaxh), got %s",
+                   g_variant_get_type_string (variant_ref));
+      return nullptr;
+    }
+
+  g_autoptr(GVariant) dimensions_variant = nullptr;
+  g_autoptr(GVariant) strides_variant = nullptr;
+  char const *nick = nullptr;
+  gint32 index = -1;
+
+  g_variant_get (variant_ref, "(@ax&s@axh)", &dimensions_variant, &nick, &strides_variant, &index);
+
+  std::vector <int64_t> dimensions (scortch_dimensions_from_g_variant (dimensions_variant));
+  std::vector <int64_t> strides (scortch_dimensions_from_g_variant (strides_variant));
+  ScortchDType dtype;
+
+  if (!scortch_dtype_from_nick (nick, &dtype))
+    {
+      g_set_error (error,
+                   SCORTCH_ERROR,
+                   SCORTCH_ERROR_INVALID_DATA_TYPE,
+                   "Unknown tensor dtype '%s'",
+                   nick);
+      return nullptr;
+    }
+
+  if (strides.size () != dimensions.size () ||
+      std::any_of (dimensions.begin (), dimensions.end (), [](int64_t d) { return d < 0; }) ||
+      std::any_of (strides.begin (), strides.end (), [](int64_t s) { return s < 0; }))
+    {
+      g_set_error (error,
+                   SCORTCH_ERROR,
+                   SCORTCH_ERROR_INVALID_DIMENSIONS,
+                   "Tensor header has invalid dimensions or strides");
+      return nullptr;
+    }
+
+  at::ScalarType scalar_type = scortch_dtype_to_scalar_type (dtype);
+  size_t size;
+
+  if (!strided_span_bytes (dimensions, strides, c10::elementSize (scalar_type), size))
+    {
+      set_span_overflow_error (error);
+      return nullptr;
+    }
+
+  if (index < 0 || index >= g_unix_fd_list_get_length (fd_list))
+    {
+      g_set_error (error,
+                   SCORTCH_ERROR,
+                   SCORTCH_ERROR_MALFORMED_DATA,
+                   "Tensor header refers to file descriptor %d, but only %d were passed",
+                   index,
+                   g_unix_fd_list_get_length (fd_list));
+      return nullptr;
+    }
+
+  int fd = g_unix_fd_list_get (fd_list, index, error);
+
+  if (fd == -1)
+    return nullptr;
+
+  struct stat file_stat;
+  int seals = fcntl (fd, F_GET_SEALS);
+
+  if (seals == -1 || (seals & required_seals) != required_seals)
+    {
+      g_set_error (error,
+                   SCORTCH_ERROR,
+                   SCORTCH_ERROR_MALFORMED_DATA,
+                   "Tensor file descriptor is not a memfd sealed against writing and resizing");
+      close (fd);
+      return nullptr;
+    }
+
+  if (fstat (fd, &file_stat) == -1)
+    {
+      set_error_from_errno ("Could not stat tensor file descriptor", error);
+      close (fd);
+      return nullptr;
+    }
+
+  if (static_cast <size_t> (file_stat.st_size) < size)
+    {
+      g_set_error (error,
+                   SCORTCH_ERROR,
+                   SCORTCH_ERROR_INVALID_DIMENSIONS,
+                   "Expected at least %" G_GSIZE_FORMAT " bytes of tensor data, "
+                   "but the file descriptor only holds %" G_GOFFSET_FORMAT " bytes",
+                   size,
+                   static_cast <goffset> (file_stat.st_size));
+      close (fd);
+      return nullptr;
+    }
+
+  /* Nothing to map for an empty tensor */
+  if (size == 0)
+    {
+      close (fd);
+      return scortch_local_tensor_new_from_tensor (torch::empty (torch::IntArrayRef (dimensions),
+                                                                 torch::TensorOptions ().dtype (scalar_type)));
+    }
+
+  void *mapping = mmap (nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close (fd);
+
+  if (mapping == MAP_FAILED)
+    {
+      set_error_from_errno ("Could not map tensor file descriptor", error);
+      return nullptr;
+    }
+
+  return scortch_local_tensor_new_from_tensor (torch::from_blob (mapping,
+                                                                 torch::IntArrayRef (dimensions),
+                                                                 torch::IntArrayRef (strides),
+                                                                 [size](void *data) {
+                                                                   munmap (data, size);
+                                                                 },
+                                                                 torch::TensorOptions ().dtype (scalar_type)));
+}
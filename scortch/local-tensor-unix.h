@@ -0,0 +1,40 @@
+/*
+ * /scortch/local-tensor-unix.h
+ *
+ * Passing tensors between processes as sealed memfd file
+ * descriptors, for instance over D-Bus.
+ *
+ * Copyright (C) 2018 Sam Spilsbury.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+#include <gio/gunixfdlist.h>
+
+#include <scortch/local-tensor.h>
+
+G_BEGIN_DECLS
+
+GVariant * scortch_local_tensor_to_fd_variant (ScortchLocalTensor  *local_tensor,
+                                               GUnixFDList         *fd_list,
+                                               GError             **error);
+ScortchLocalTensor * scortch_local_tensor_new_from_fd_variant (GVariant     *variant,
+                                                               GUnixFDList  *fd_list,
+                                                               GError      **error);
+
+G_END_DECLS
@@ -22,9 +22,12 @@
  */
 
 #include <algorithm>
+#include <cstring>
 #include <functional>
+#include <set>
 #include <vector>
 
+#include <gio/gio.h>
 #include <glib-object.h>
 #include <glib.h>
 #include <gobject/gobject.h>
@@ -32,7 +35,12 @@
 #include <torch/torch.h>
 
 #include <scortch/local-tensor.h>
+#include <scortch/local-tensor-internal.h>
+#include <scortch/scortch-dtype-internal.h>
 #include <scortch/scortch-errors.h>
+#include <scortch/scortch-storage-pool-internal.h>
+#include <scortch/scortch-tracing-internal.h>
+#include <scortch/scortch-worker-pool-internal.h>
 
 struct _ScortchLocalTensor
 {
@@ -41,15 +49,18 @@ struct _ScortchLocalTensor
 
 typedef struct _ScortchLocalTensorPrivate {
   torch::Tensor *tensor;
+  torch::Tensor *capacity; /* rows reserved for appending, or nullptr */
 
   GVariant *dimension_list; /* signature: ax */
   GVariant *construction_data_variant; /* signature: av */
+  ScortchDType construction_dtype;
 } ScortchLocalTensorPrivate;
 
 enum {
   PROP_0,
   PROP_DIMENSIONS,
   PROP_DATA,
+  PROP_DTYPE,
   PROP_N
 };
 
@@ -63,6 +74,29 @@ namespace
     delete t;
   }
 
+  struct SetDataTaskData
+  {
+    SetDataTaskData (GVariant *data, at::ScalarType scalar_type) :
+      data (g_variant_ref_sink (data)),
+      scalar_type (scalar_type)
+    {
+    }
+
+    ~SetDataTaskData ()
+    {
+      g_variant_unref (data);
+    }
+
+    GVariant       *data;
+    at::ScalarType  scalar_type;
+  };
+
+  /* Set by scortch_local_tensor_new_from_tensor around
+   * g_object_new, so that constructed adopts the tensor instead
+   * of allocating a zeroed one that would be replaced right away.
+   * Thread local, since tensors are created on worker threads. */
+  thread_local torch::Tensor const *construction_tensor = nullptr;
+
   /* XXX: Its not entirely clear to me why,
    *      but if we return an IntArrayRef here, we crash
    *      because at::List doesn't make a copy of the underlying
@@ -84,6 +118,51 @@ namespace
     return vec;
   }
 
+  GVariant * g_variant_from_int_list (torch::IntArrayRef list)
+  {
+    return g_variant_new_fixed_array (G_VARIANT_TYPE ("x"),
+                                      static_cast <gconstpointer> (list.data ()),
+                                      list.size (),
+                                      sizeof (int64_t));
+  }
+
+  size_t n_elements_for_dimensions (std::vector <int64_t> const &dimensions)
+  {
+    size_t n_elements = 1;
+
+    for (int64_t dimension : dimensions)
+      n_elements *= static_cast <size_t> (dimension);
+
+    return n_elements;
+  }
+
+  /* Number of bytes taken by elements of element_size in a
+   * tensor of dimensions. The dimensions may come from callers
+   * describing a foreign buffer, so returns false with error set
+   * if any is negative or the size does not fit in a size_t. */
+  bool n_bytes_for_dimensions (std::vector <int64_t> const  &dimensions,
+                               size_t                        element_size,
+                               size_t                       &n_bytes,
+                               GError                      **error)
+  {
+    n_bytes = element_size;
+
+    for (int64_t dimension : dimensions)
+      {
+        if (dimension < 0 ||
+            __builtin_mul_overflow (n_bytes, static_cast <size_t> (dimension), &n_bytes))
+          {
+            g_set_error (error,
+                         SCORTCH_ERROR,
+                         SCORTCH_ERROR_INVALID_DIMENSIONS,
+                         "Tensor dimensions are negative or too large to address");
+            return false;
+          }
+      }
+
+    return true;
+  }
+
   GVariant * single_dimensional_empty_tensor ()
   {
     g_auto(GVariantBuilder) builder = G_VARIANT_BUILDER_INIT (G_VARIANT_TYPE ("ax"));
@@ -121,8 +200,19 @@ namespace
       {
       }
 
+      InvalidScalarTypeError (at::ScalarType scalar_type) :
+        std::logic_error::logic_error (InvalidScalarTypeError::format_error (scalar_type))
+      {
+      }
+
+      InvalidScalarTypeError (char const *dtype_nick) :
+        std::logic_error::logic_error (InvalidScalarTypeError::format_error (dtype_nick))
+      {
+      }
+
     private:
-      static inline std::string format_error (caffe2::TypeMeta const &scalar_type)
+      template <typename T>
+      static inline std::string format_error (T const &scalar_type)
       {
         std::stringstream ss;
         ss << "Cannot handle scalar type " << scalar_type;
@@ -130,62 +220,62 @@ namespace
       }
   };
 
-  GVariantType const * scalar_type_to_g_variant_type (caffe2::TypeMeta scalar_type)
+  class MalformedDataError : public std::logic_error
   {
-    /* XXX: We do not support float tensors
-     *      at the moment as GVariant doesn't
-     *      support floats. */
-    if (scalar_type == torch::kFloat64) {
-      return G_VARIANT_TYPE_DOUBLE;
-    } else if (scalar_type == torch::kInt64) {
-      return G_VARIANT_TYPE_INT64;
-    } else {
-      throw InvalidScalarTypeError (scalar_type);
-    }
-  }
+    public:
+      MalformedDataError (std::string const &message) :
+        std::logic_error::logic_error (message)
+      {
+      }
+  };
 
-  size_t scalar_type_to_element_size (caffe2::TypeMeta scalar_type)
+  class CancelledError : public std::runtime_error
   {
-    if (scalar_type == torch::kFloat64) {
-      return sizeof (double);
-    } else if (scalar_type == torch::kInt64) {
-      return sizeof (int64_t);
-    } else {
-      throw InvalidScalarTypeError (scalar_type);
-    }
-  }
+    public:
+      CancelledError () :
+        std::runtime_error::runtime_error ("Operation was cancelled")
+      {
+      }
+  };
 
-  template <typename T>
-  std::vector <T>
-  append_to_vector (std::vector <T> &&vec, T &&v)
+  /* Conversions check for cancellation once every this many
+   * rows, which keeps the check off the per-element path. */
+  constexpr size_t cancellation_check_rows = 1024;
+
+  /* Most rows reserved before any have been read, beyond which
+   * the row list grows as rows are actually found. */
+  constexpr size_t max_reserved_rows = 64 * 1024;
+
+  void throw_if_cancelled (GCancellable *cancellable)
   {
-    std::vector vec_out (vec);
-    vec_out.push_back(v);
-    return vec_out;
+    if (g_cancellable_is_cancelled (cancellable))
+      throw CancelledError ();
   }
 
-  std::tuple <GVariantType const *, std::vector <int64_t>> ascertain_underlying_type_and_dimensions (GVariant *array_variant)
+  /* The element type used for rows of scalar_type in tensor
+   * data, or nullptr if GVariant cannot represent it natively
+   * and rows have to be packed into a "(say)" tuple instead. */
+  GVariantType const * scalar_type_to_g_variant_type (at::ScalarType scalar_type)
   {
-    GVariantType const *array_variant_type = G_VARIANT_TYPE (g_variant_get_type_string (array_variant));
-    if (!g_variant_type_equal (array_variant_type, G_VARIANT_TYPE ("av")))
+    switch (scalar_type)
       {
-        g_assert (g_variant_type_is_container (array_variant_type));
-        return std::make_tuple (array_variant_type,
-                                append_to_vector (std::vector <int64_t> (),
-                                                  static_cast <int64_t> (g_variant_n_children (array_variant))));
+        case torch::kFloat64:
+          return G_VARIANT_TYPE_DOUBLE;
+        case torch::kInt64:
+          return G_VARIANT_TYPE_INT64;
+        case torch::kInt32:
+          return G_VARIANT_TYPE_INT32;
+        case torch::kUInt8:
+          return G_VARIANT_TYPE_BYTE;
+        case torch::kBool:
+          return G_VARIANT_TYPE_BOOLEAN;
+        case torch::kFloat32:
+        case torch::kFloat16:
+        case torch::kBFloat16:
+          return nullptr;
+        default:
+          throw InvalidScalarTypeError (scalar_type);
       }
-
-    g_autoptr(GVariant) child_variant = g_variant_ref_sink (g_variant_get_child_value (array_variant, 0));
-    g_autoptr(GVariant) child_array = g_variant_ref_sink (g_variant_get_variant (child_variant));
-
-    GVariantType const *variant_type;
-    std::vector <int64_t> dimension_vec;
-
-    std::tie (variant_type, dimension_vec) = ascertain_underlying_type_and_dimensions (child_array);
-
-    return std::make_tuple (variant_type,
-                            append_to_vector (std::move (dimension_vec),
-                                              static_cast <int64_t> (g_variant_n_children (array_variant))));
   }
 
   unsigned int set_error_from_exception (std::exception const  &exception,
@@ -202,90 +292,399 @@ namespace
   }
 
   template <typename T>
-  void iterate_and_assign_to_tensor (torch::Tensor &tensor,
-                                     const char    *type_string,
-                                     GVariant      *array_variant)
+  struct TypeTag
+  {
+    typedef T type;
+  };
+
+  /* Call func with a TypeTag for the C++ type corresponding
+   * to scalar_type, so that generic lambdas can be instantiated
+   * for each type that we support. */
+  template <typename Func>
+  void dispatch_on_scalar_type (at::ScalarType scalar_type, Func &&func)
+  {
+    switch (scalar_type)
+      {
+        case torch::kFloat64:
+          func (TypeTag <double> ());
+          break;
+        case torch::kInt64:
+          func (TypeTag <int64_t> ());
+          break;
+        case torch::kFloat32:
+          func (TypeTag <float> ());
+          break;
+        case torch::kFloat16:
+          func (TypeTag <at::Half> ());
+          break;
+        case torch::kBFloat16:
+          func (TypeTag <at::BFloat16> ());
+          break;
+        case torch::kInt32:
+          func (TypeTag <int32_t> ());
+          break;
+        case torch::kUInt8:
+          func (TypeTag <uint8_t> ());
+          break;
+        case torch::kBool:
+          func (TypeTag <bool> ());
+          break;
+        default:
+          throw InvalidScalarTypeError (scalar_type);
+      }
+  }
+
+  /* A single row of tensor data, borrowed from a leaf variant */
+  struct LeafRow
+  {
+    at::ScalarType scalar_type;
+    gconstpointer  data;
+    size_t         n_elements;
+  };
+
+  at::ScalarType native_leaf_variant_type_to_scalar_type (GVariantType const *leaf_type)
+  {
+    if (g_variant_type_equal (leaf_type, G_VARIANT_TYPE ("ad")))
+      return torch::kFloat64;
+    else if (g_variant_type_equal (leaf_type, G_VARIANT_TYPE ("ax")))
+      return torch::kInt64;
+    else if (g_variant_type_equal (leaf_type, G_VARIANT_TYPE ("ai")))
+      return torch::kInt32;
+    else if (g_variant_type_equal (leaf_type, G_VARIANT_TYPE ("ay")))
+      return torch::kUInt8;
+    else if (g_variant_type_equal (leaf_type, G_VARIANT_TYPE ("ab")))
+      return torch::kBool;
+
+    throw InvalidVariantTypeError (leaf_type);
+  }
+
+  /* Leaves are either arrays of a type that GVariant supports
+   * natively or a "(say)" tuple of a dtype nickname and the raw
+   * bytes of the row. The returned data is borrowed from
+   * leaf_variant and stays valid for as long as it does. */
+  LeafRow read_leaf_variant (GVariant *leaf_variant)
+  {
+    if (g_variant_is_of_type (leaf_variant, G_VARIANT_TYPE ("(say)")))
+      {
+        char const *nick;
+        g_autoptr(GVariant) bytes_variant = nullptr;
+        ScortchDType dtype;
+
+        g_variant_get (leaf_variant, "(&s@ay)", &nick, &bytes_variant);
+
+        if (!scortch_dtype_from_nick (nick, &dtype))
+          throw InvalidScalarTypeError (nick);
+
+        at::ScalarType scalar_type = scortch_dtype_to_scalar_type (dtype);
+        size_t element_size = c10::elementSize (scalar_type);
+        size_t n_bytes;
+
+        /* The child shares the serialized data of leaf_variant,
+         * so the pointer outlives our reference to the child. */
+        gconstpointer data = g_variant_get_fixed_array (bytes_variant, &n_bytes, 1);
+
+        if (n_bytes % element_size != 0)
+          throw MalformedDataError ("Malformed tensor data: packed row is not a whole number of elements");
+
+        return { scalar_type, data, n_bytes / element_size };
+      }
+
+    at::ScalarType scalar_type =
+      native_leaf_variant_type_to_scalar_type (g_variant_get_type (leaf_variant));
+    size_t n_elements;
+    gconstpointer data = g_variant_get_fixed_array (leaf_variant,
+                                                    &n_elements,
+                                                    c10::elementSize (scalar_type));
+
+    return { scalar_type, data, n_elements };
+  }
+
+  template <typename Source, typename Destination>
+  Destination convert_scalar (Source value)
+  {
+    /* at::Half and at::BFloat16 only convert to and from float */
+    typedef typename std::conditional <std::is_arithmetic <Source>::value, Source, float>::type Intermediate;
+
+    return static_cast <Destination> (static_cast <Intermediate> (value));
+  }
+
+  /* Packed rows carry no alignment guarantees, so source
+   * elements are read through memcpy. */
+  template <typename Source, typename Destination>
+  void convert_elements (char const   *source,
+                         Destination  *destination,
+                         size_t        n_elements)
   {
-    T scalar;
-    GVariantIter iter;
-    size_t       count = 0;
+    for (size_t i = 0; i < n_elements; ++i)
+      {
+        Source value;
 
-    g_variant_iter_init (&iter, array_variant);
+        memcpy (&value, source + i * sizeof (Source), sizeof (Source));
+        destination[i] = convert_scalar <Source, Destination> (value);
+      }
+  }
 
-    while (g_variant_iter_next (&iter, type_string, &scalar))
+  /* Copy a single leaf row into the destination buffer,
+   * converting element types if they differ. */
+  void fill_row_from_leaf (LeafRow const  &leaf,
+                           at::ScalarType  destination_scalar_type,
+                           char           *destination)
+  {
+    if (leaf.scalar_type == destination_scalar_type)
       {
-        tensor[count++] = scalar;
+        memcpy (destination, leaf.data, leaf.n_elements * c10::elementSize (leaf.scalar_type));
+        return;
       }
+
+    dispatch_on_scalar_type (leaf.scalar_type, [&](auto source_tag) {
+      typedef typename decltype (source_tag)::type Source;
+
+      dispatch_on_scalar_type (destination_scalar_type, [&](auto destination_tag) {
+        typedef typename decltype (destination_tag)::type Destination;
+
+        convert_elements <Source, Destination> (static_cast <char const *> (leaf.data),
+                                                reinterpret_cast <Destination *> (destination),
+                                                leaf.n_elements);
+      });
+    });
   }
 
-  void set_tensor_data_from_nested_variant_arrays (torch::Tensor       &tensor,
-                                                   GVariant            *array_variant,
-                                                   GVariantType  const *underlying_type)
+  /* Shape, leaf type and row placement of a nested array of
+   * variants, computed in a single pass by walk_nested_variant_arrays
+   * so that the fill step does not need to walk the tree again. */
+  struct NestedVariantLayout
   {
-    /* Base case */
-    if (!g_variant_is_of_type (array_variant, G_VARIANT_TYPE ("av")))
+    struct Row
+    {
+      GVariant *leaf_variant; /* owned, keeps leaf.data alive */
+      LeafRow   leaf;
+      size_t    offset;       /* in elements from the start of the buffer */
+    };
+
+    NestedVariantLayout () = default;
+    NestedVariantLayout (NestedVariantLayout const &) = delete;
+    NestedVariantLayout & operator= (NestedVariantLayout const &) = delete;
+
+    ~NestedVariantLayout ()
+    {
+      for (Row &row : rows)
+        g_variant_unref (row.leaf_variant);
+    }
+
+    std::vector <int64_t> dimensions;
+    std::vector <Row>     rows;
+    at::ScalarType        leaf_scalar_type = at::ScalarType::Undefined;
+    size_t                n_elements = 0;
+
+    bool has_leaves () const
+    {
+      return leaf_scalar_type != at::ScalarType::Undefined;
+    }
+
+    size_t row_length () const
+    {
+      return has_leaves () ? static_cast <size_t> (dimensions.back ()) : 0;
+    }
+  };
+
+  std::string format_malformed_data_message (char const *problem, size_t depth)
+  {
+    std::stringstream ss;
+    ss << "Malformed tensor data: " << problem << " at nesting level " << depth;
+    return ss.str ();
+  }
+
+  /* The first time a nesting level is visited, its number of
+   * children becomes the dimension for that level and the first
+   * leaf fixes the leaf type. Every sibling visited afterwards is
+   * checked against them, so ragged or mixed input is rejected
+   * before anything is written to the tensor. */
+  void walk_nested_variant_arrays (GVariant            *array_variant,
+                                   size_t               depth,
+                                   GCancellable        *cancellable,
+                                   NestedVariantLayout &layout)
+  {
+    bool is_leaf = !g_variant_is_of_type (array_variant, G_VARIANT_TYPE ("av"));
+
+    /* Read the leaf before anything else, since the length
+     * of a packed row is not its number of children. */
+    LeafRow leaf = is_leaf ?
+      read_leaf_variant (array_variant) :
+      LeafRow { at::ScalarType::Undefined, nullptr, 0 };
+    int64_t n_children = is_leaf ?
+      static_cast <int64_t> (leaf.n_elements) :
+      static_cast <int64_t> (g_variant_n_children (array_variant));
+
+    if (depth == layout.dimensions.size ())
       {
-        g_assert (g_variant_type_is_container (G_VARIANT_TYPE (g_variant_get_type_string (array_variant))));
-        g_assert (g_variant_is_of_type (array_variant, underlying_type));
+        if (layout.has_leaves ())
+          throw MalformedDataError (format_malformed_data_message ("array nested deeper than its siblings",
+                                                                   depth));
 
-        const char   *type_string = (g_variant_type_peek_string (underlying_type) + 1);
+        layout.dimensions.push_back (n_children);
+      }
+    else if (layout.dimensions[depth] != n_children)
+      {
+        throw MalformedDataError (format_malformed_data_message ("ragged array", depth));
+      }
 
-        if (g_variant_type_equal (underlying_type, G_VARIANT_TYPE ("ad")))
+    if (is_leaf)
+      {
+        if (!layout.has_leaves ())
           {
-            iterate_and_assign_to_tensor <double> (tensor, type_string, array_variant);
+            layout.leaf_scalar_type = leaf.scalar_type;
+
+            /* All dimensions are known once we hit the first leaf,
+             * so every row can be accounted for up front. They only
+             * come from the first child at each level though, so the
+             * reservation is capped and siblings are still checked
+             * against them as the walk goes on. */
+            size_t n_rows = 1;
+            for (size_t i = 0; i < depth; ++i)
+              {
+                if (__builtin_mul_overflow (n_rows,
+                                            static_cast <size_t> (layout.dimensions[i]),
+                                            &n_rows))
+                  {
+                    n_rows = max_reserved_rows;
+                    break;
+                  }
+              }
+
+            layout.rows.reserve (std::min (n_rows, max_reserved_rows));
           }
-        else if (g_variant_type_equal (underlying_type, G_VARIANT_TYPE ("ax")))
+        else if (depth + 1 != layout.dimensions.size ())
           {
-            iterate_and_assign_to_tensor <int64_t> (tensor, type_string, array_variant);
+            throw MalformedDataError (format_malformed_data_message ("array nested shallower than its siblings",
+                                                                     depth));
           }
-        else
+        else if (layout.leaf_scalar_type != leaf.scalar_type)
           {
-            throw InvalidVariantTypeError (underlying_type);
+            throw MalformedDataError (format_malformed_data_message ("inconsistent leaf types",
+                                                                     depth));
           }
 
+        if (layout.rows.size () % cancellation_check_rows == 0)
+          throw_if_cancelled (cancellable);
+
+        layout.rows.push_back ({ g_variant_ref (array_variant), leaf, layout.n_elements });
+        layout.n_elements += static_cast <size_t> (n_children);
         return;
       }
 
-    /* Recursive case */
-    GVariantIter iter;
-    GVariant     *unowned_child_array;
-    size_t       tensor_index = 0;
+    for (int64_t i = 0; i < n_children; ++i)
+      {
+        g_autoptr(GVariant) child_variant = g_variant_get_child_value (array_variant, i);
+        g_autoptr(GVariant) child_array = g_variant_get_variant (child_variant);
+
+        walk_nested_variant_arrays (child_array, depth + 1, cancellable, layout);
+      }
+  }
 
-    g_variant_iter_init (&iter, array_variant);
-    while (g_variant_iter_next (&iter, "v", &unowned_child_array))
+  void fill_buffer_from_layout (NestedVariantLayout const &layout,
+                                at::ScalarType             destination_scalar_type,
+                                GCancellable              *cancellable,
+                                char                      *destination)
+  {
+    size_t element_size = c10::elementSize (destination_scalar_type);
+
+    for (size_t i = 0; i < layout.rows.size (); ++i)
       {
-        g_autoptr(GVariant) child_array = g_variant_ref_sink (unowned_child_array);
+        NestedVariantLayout::Row const &row = layout.rows[i];
 
-        torch::Tensor child_tensor (tensor[tensor_index]);
-        set_tensor_data_from_nested_variant_arrays (child_tensor, child_array, underlying_type);
+        if (i % cancellation_check_rows == 0)
+          throw_if_cancelled (cancellable);
 
-        ++tensor_index;
+        fill_row_from_leaf (row.leaf,
+                            destination_scalar_type,
+                            destination + row.offset * element_size);
       }
   }
 
-  torch::Tensor new_tensor_from_nested_gvariants (GVariant *array_variant)
+  torch::Tensor new_tensor_from_nested_gvariants (GVariant       *array_variant,
+                                                  at::ScalarType  scalar_type,
+                                                  GCancellable   *cancellable)
   {
-    GVariantType const *underlying_type;
-    std::vector <int64_t> dimensions;
+    ScortchTraceScope trace ("set-data");
+    NestedVariantLayout layout;
+
+    {
+      ScortchTraceScope layout_trace ("set-data-layout");
+      walk_nested_variant_arrays (array_variant, 0, cancellable, layout);
+    }
 
-    std::tie (underlying_type, dimensions) = ascertain_underlying_type_and_dimensions (array_variant);
-    std::reverse (dimensions.begin (), dimensions.end ());
+    /* Every element gets overwritten below, so there is
+     * no need to zero-fill the buffer first. */
+    torch::Tensor tensor = scortch_storage_pool_empty (torch::IntArrayRef (layout.dimensions),
+                                                       scalar_type);
+
+    {
+      ScortchTraceScope fill_trace ("set-data-fill");
+      fill_buffer_from_layout (layout,
+                               scalar_type,
+                               cancellable,
+                               static_cast <char *> (tensor.data_ptr ()));
+      fill_trace.add_bytes (tensor.nbytes ());
+    }
 
-    torch::Tensor tensor = torch::zeros (torch::IntArrayRef (dimensions)).cpu ();
-    set_tensor_data_from_nested_variant_arrays (tensor, array_variant, underlying_type);
+    trace.add_bytes (tensor.nbytes ());
 
     return tensor;
   }
 
-  GVariant * serialize_tensor_data_to_nested_gvariants (at::Tensor const &tensor)
+  /* Wrap the storage of a contiguous tensor in a GBytes
+   * that keeps a reference on the tensor. */
+  GBytes * new_bytes_for_contiguous_tensor (torch::Tensor const &contiguous)
+  {
+    torch::Tensor *tensor_ref = new torch::Tensor (contiguous);
+
+    return g_bytes_new_with_free_func (tensor_ref->data_ptr (),
+                                       tensor_ref->numel () * tensor_ref->dtype ().itemsize (),
+                                       (GDestroyNotify) safe_delete <torch::Tensor>,
+                                       tensor_ref);
+  }
+
+  GVariant * new_leaf_variant_from_bytes (at::ScalarType  scalar_type,
+                                          GBytes         *row_bytes)
+  {
+    GVariantType const *element_type = scalar_type_to_g_variant_type (scalar_type);
+
+    if (element_type != nullptr)
+      {
+        g_autoptr(GVariantType) array_type = g_variant_type_new_array (element_type);
+        return g_variant_new_from_bytes (array_type, row_bytes, TRUE);
+      }
+
+    ScortchDType dtype;
+    if (!scortch_dtype_from_scalar_type (scalar_type, &dtype))
+      throw InvalidScalarTypeError (scalar_type);
+
+    return g_variant_new ("(s@ay)",
+                          scortch_dtype_to_nick (dtype),
+                          g_variant_new_from_bytes (G_VARIANT_TYPE_BYTESTRING, row_bytes, TRUE));
+  }
+
+  GVariant * serialize_rows_to_nested_gvariants (torch::IntArrayRef  sizes,
+                                                 size_t              level,
+                                                 at::ScalarType      scalar_type,
+                                                 GBytes             *bytes,
+                                                 size_t              row_size,
+                                                 GCancellable       *cancellable,
+                                                 size_t             &row_index)
   {
-    /* Base case, only a single dimension left */
-    if (tensor.dim () == 1)
+    /* Base case, only a single dimension left. The row is
+     * a slice of the shared buffer, so nothing is copied. */
+    if (level == sizes.size () - 1)
       {
-        return g_variant_new_fixed_array (scalar_type_to_g_variant_type (tensor.dtype ()),
-                                          tensor.data_ptr (),
-                                          tensor.sizes ()[0],
-                                          scalar_type_to_element_size (tensor.dtype ()));
+        if (row_index % cancellation_check_rows == 0)
+          throw_if_cancelled (cancellable);
+
+        g_autoptr(GBytes) row_bytes = g_bytes_new_from_bytes (bytes,
+                                                              row_index * row_size,
+                                                              row_size);
+        ++row_index;
+
+        return new_leaf_variant_from_bytes (scalar_type, row_bytes);
       }
 
     /* Recursive case: Build a new array-of-variants
@@ -294,16 +693,313 @@ namespace
     g_auto(GVariantBuilder) builder = G_VARIANT_BUILDER_INIT (G_VARIANT_TYPE ("av"));
     g_variant_builder_init (&builder, G_VARIANT_TYPE ("av"));
 
-    for (size_t i = 0; i < tensor.sizes ()[0]; ++i)
+    for (int64_t i = 0; i < sizes[level]; ++i)
       {
         g_variant_builder_add (&builder,
                                "v",
-                               serialize_tensor_data_to_nested_gvariants (tensor[i]));
+                               serialize_rows_to_nested_gvariants (sizes,
+                                                                   level + 1,
+                                                                   scalar_type,
+                                                                   bytes,
+                                                                   row_size,
+                                                                   cancellable,
+                                                                   row_index));
       }
 
     return g_variant_builder_end (&builder);
   }
 
+  /* The elements are copied once up front, then every row is
+   * exported as a slice of that single buffer. Contiguous tensors
+   * are copied too, since GVariants are immutable and must not
+   * see later in-place writes to the tensor. */
+  GVariant * serialize_tensor_data_to_nested_gvariants (at::Tensor const &tensor,
+                                                        GCancellable     *cancellable)
+  {
+    ScortchTraceScope trace ("get-data");
+    torch::Tensor contiguous (tensor.is_contiguous () ?
+                              tensor.clone () :
+                              tensor.contiguous ());
+
+    trace.add_bytes (contiguous.nbytes ());
+    g_autoptr(GBytes) bytes = new_bytes_for_contiguous_tensor (contiguous);
+    size_t row_index = 0;
+
+    /* A zero-dimensional tensor is exported as a single row */
+    std::vector <int64_t> sizes (contiguous.sizes ().begin (), contiguous.sizes ().end ());
+    if (sizes.empty ())
+      sizes.push_back (1);
+
+    return serialize_rows_to_nested_gvariants (torch::IntArrayRef (sizes),
+                                               0,
+                                               contiguous.scalar_type (),
+                                               bytes,
+                                               sizes.back () * contiguous.dtype ().itemsize (),
+                                               cancellable,
+                                               row_index);
+  }
+
+  bool set_cancelled_error (CancelledError const  &e,
+                            GError              **error)
+  {
+    g_set_error (error, G_IO_ERROR, G_IO_ERROR_CANCELLED, "%s", e.what ());
+    return false;
+  }
+
+  /* Build a new tensor from nested "av" data, translating
+   * conversion errors into error. Returns false on error,
+   * including when cancellable is cancelled part way. */
+  bool new_tensor_from_data (GVariant        *data,
+                             at::ScalarType   scalar_type,
+                             GCancellable    *cancellable,
+                             torch::Tensor   &tensor,
+                             GError         **error)
+  {
+    try
+      {
+        tensor = new_tensor_from_nested_gvariants (data, scalar_type, cancellable);
+        return true;
+      }
+    catch (CancelledError const &e)
+      {
+        return set_cancelled_error (e, error);
+      }
+    catch (InvalidVariantTypeError &e)
+      {
+        return set_error_from_exception (e,
+                                         SCORTCH_ERROR,
+                                         SCORTCH_ERROR_INVALID_DATA_TYPE,
+                                         error);
+      }
+    catch (InvalidScalarTypeError &e)
+      {
+        return set_error_from_exception (e,
+                                         SCORTCH_ERROR,
+                                         SCORTCH_ERROR_INVALID_DATA_TYPE,
+                                         error);
+      }
+    catch (MalformedDataError &e)
+      {
+        return set_error_from_exception (e,
+                                         SCORTCH_ERROR,
+                                         SCORTCH_ERROR_MALFORMED_DATA,
+                                         error);
+      }
+    catch (c10::Error const &e)
+      {
+        g_set_error (error,
+                     SCORTCH_ERROR,
+                     SCORTCH_ERROR_INTERNAL,
+                     "%s",
+                     e.what_without_backtrace ());
+        return false;
+      }
+    catch (std::exception const &e)
+      {
+        g_set_error (error, SCORTCH_ERROR, SCORTCH_ERROR_INTERNAL, "%s", e.what ());
+        return false;
+      }
+  }
+
+  GVariant * new_data_from_tensor (torch::Tensor const  &tensor,
+                                   GCancellable         *cancellable,
+                                   GError              **error)
+  {
+    try
+      {
+        return serialize_tensor_data_to_nested_gvariants (tensor, cancellable);
+      }
+    catch (CancelledError const &e)
+      {
+        set_cancelled_error (e, error);
+        return nullptr;
+      }
+    catch (InvalidScalarTypeError const &e)
+      {
+        return reinterpret_cast <GVariant *> (set_error_from_exception (e,
+                                                                        SCORTCH_ERROR,
+                                                                        SCORTCH_ERROR_INVALID_DATA_TYPE,
+                                                                        error));
+      }
+  }
+
+  void set_tensor_data (ScortchLocalTensorPrivate *priv,
+                        torch::Tensor const       &data)
+  {
+    priv->tensor->set_data (data);
+
+    g_clear_pointer (&priv->dimension_list, (GDestroyNotify) g_variant_unref);
+    priv->dimension_list = g_variant_ref_sink (g_variant_from_int_list (priv->tensor->sizes ()));
+  }
+
+  /* New data does not share the reserved rows, so they are
+   * released along with the old data. */
+  void replace_tensor_data (ScortchLocalTensorPrivate *priv,
+                            torch::Tensor const       &data)
+  {
+    g_clear_pointer (&priv->capacity, (GDestroyNotify) safe_delete <torch::Tensor>);
+    set_tensor_data (priv, data);
+  }
+
+  /* The tensor is a view of the leading rows of the capacity
+   * tensor as long as nothing has replaced its data since the
+   * last reserve or append. */
+  bool capacity_is_current (ScortchLocalTensorPrivate *priv)
+  {
+    torch::Tensor const &tensor = *priv->tensor;
+
+    if (priv->capacity == nullptr)
+      return false;
+
+    torch::Tensor const &capacity = *priv->capacity;
+
+    return tensor.dim () == capacity.dim () &&
+           tensor.scalar_type () == capacity.scalar_type () &&
+           tensor.is_contiguous () &&
+           tensor.data_ptr () == capacity.data_ptr () &&
+           tensor.sizes ().slice (1) == capacity.sizes ().slice (1) &&
+           tensor.size (0) <= capacity.size (0);
+  }
+
+  int64_t current_capacity_rows (ScortchLocalTensorPrivate *priv)
+  {
+    return capacity_is_current (priv) ? priv->capacity->size (0) : priv->tensor->size (0);
+  }
+
+  bool check_appendable (ScortchLocalTensorPrivate  *priv,
+                         GError                    **error)
+  {
+    if (priv->tensor->dim () == 0)
+      {
+        g_set_error (error,
+                     SCORTCH_ERROR,
+                     SCORTCH_ERROR_INVALID_DIMENSIONS,
+                     "Cannot reserve or append rows on a zero-dimensional tensor");
+        return false;
+      }
+
+    return true;
+  }
+
+  /* Make sure there is room for at least capacity_rows rows,
+   * copying the existing rows into a new capacity tensor if
+   * there is not. The tensor keeps its visible dimensions.
+   * Returns false with error set, leaving the tensor unchanged,
+   * if the capacity could not be allocated. */
+  bool ensure_capacity_rows (ScortchLocalTensorPrivate  *priv,
+                             int64_t                     capacity_rows,
+                             GError                    **error)
+  {
+    if (capacity_rows <= current_capacity_rows (priv))
+      return true;
+
+    torch::Tensor const &tensor = *priv->tensor;
+    std::vector <int64_t> capacity_dimensions (tensor.sizes ().begin (), tensor.sizes ().end ());
+    capacity_dimensions[0] = capacity_rows;
+
+    torch::Tensor capacity;
+
+    if (!scortch_call_torch ([&]() {
+          capacity = scortch_storage_pool_empty (torch::IntArrayRef (capacity_dimensions),
+                                                 tensor.scalar_type ());
+          capacity.narrow (0, 0, tensor.size (0)).copy_ (tensor);
+        }, error))
+      return false;
+
+    if (priv->capacity == nullptr)
+      priv->capacity = new torch::Tensor (capacity);
+    else
+      *priv->capacity = capacity;
+
+    set_tensor_data (priv, capacity.narrow (0, 0, tensor.size (0)));
+    return true;
+  }
+
+  /* Copy rows in after the existing rows, growing the capacity
+   * geometrically so that a sequence of appends copies every
+   * row a constant number of times on average. */
+  bool append_rows_to_capacity (ScortchLocalTensorPrivate  *priv,
+                                torch::Tensor const        &rows,
+                                GError                    **error)
+  {
+    int64_t n_rows = priv->tensor->size (0);
+    int64_t n_appended_rows = rows.size (0);
+
+    if (n_appended_rows == 0)
+      return true;
+
+    if (n_rows + n_appended_rows > current_capacity_rows (priv) &&
+        !ensure_capacity_rows (priv,
+                               std::max (n_rows + n_appended_rows,
+                                         2 * current_capacity_rows (priv)),
+                               error))
+      return false;
+
+    if (!scortch_call_torch ([&]() {
+          priv->capacity->narrow (0, n_rows, n_appended_rows).copy_ (rows);
+        }, error))
+      return false;
+
+    set_tensor_data (priv, priv->capacity->narrow (0, 0, n_rows + n_appended_rows));
+    return true;
+  }
+
+  std::string format_row_dimensions (torch::IntArrayRef dimensions)
+  {
+    std::stringstream ss;
+
+    ss << "[";
+    for (size_t i = 1; i < dimensions.size (); ++i)
+      ss << (i == 1 ? "" : ", ") << dimensions[i];
+    ss << "]";
+
+    return ss.str ();
+  }
+
+  void set_data_in_worker (GTask        *task,
+                           gpointer      source_object G_GNUC_UNUSED,
+                           gpointer      task_data,
+                           GCancellable *cancellable)
+  {
+    SetDataTaskData *set_data_task_data = static_cast <SetDataTaskData *> (task_data);
+    g_autoptr(GError) error = nullptr;
+    torch::Tensor tensor;
+
+    if (!new_tensor_from_data (set_data_task_data->data,
+                               set_data_task_data->scalar_type,
+                               cancellable,
+                               tensor,
+                               &error))
+      {
+        g_task_return_error (task, static_cast <GError *> (g_steal_pointer (&error)));
+        return;
+      }
+
+    g_task_return_pointer (task,
+                           new torch::Tensor (tensor),
+                           (GDestroyNotify) safe_delete <torch::Tensor>);
+  }
+
+  void get_data_in_worker (GTask        *task,
+                           gpointer      source_object G_GNUC_UNUSED,
+                           gpointer      task_data,
+                           GCancellable *cancellable)
+  {
+    torch::Tensor const *tensor = static_cast <torch::Tensor const *> (task_data);
+    g_autoptr(GError) error = nullptr;
+    GVariant *data = new_data_from_tensor (*tensor, cancellable, &error);
+
+    if (data == nullptr)
+      {
+        g_task_return_error (task, static_cast <GError *> (g_steal_pointer (&error)));
+        return;
+      }
+
+    g_task_return_pointer (task,
+                           g_variant_ref_sink (data),
+                           (GDestroyNotify) g_variant_unref);
+  }
+
   template <typename Func, typename... Args>
   typename std::result_of <Func(Args..., GError **)>::type
   call_and_warn_about_gerror(const char *operation, Func &&f, Args&& ...args)
@@ -376,7 +1072,77 @@ scortch_local_tensor_set_dimensions (ScortchLocalTensor *local_tensor,
   /* We can't set the dimensions until the underlying tensor is constructed */
   if (priv->tensor != nullptr)
     {
-      priv->tensor->resize_ (torch::IntArrayRef (int_list_from_g_variant (priv->dimension_list)));
+      std::vector <int64_t> dimensions (int_list_from_g_variant (priv->dimension_list));
+      size_t n_elements = n_elements_for_dimensions (dimensions);
+      c10::Storage const &storage = priv->tensor->storage ();
+
+      /* Storage that scortch does not own, such as pooled, mapped
+       * or borrowed buffers, cannot grow in place, so the elements
+       * that fit are copied into a new tensor instead. */
+      if (!storage.resizable () &&
+          (priv->tensor->storage_offset () + n_elements) * priv->tensor->dtype ().itemsize () > storage.nbytes ())
+        {
+          torch::Tensor resized (scortch_storage_pool_empty (torch::IntArrayRef (dimensions),
+                                                             priv->tensor->scalar_type ()));
+          int64_t n_kept = std::min (static_cast <int64_t> (n_elements), priv->tensor->numel ());
+
+          resized.view (-1).narrow (0, 0, n_kept).copy_ (priv->tensor->reshape (-1).narrow (0, 0, n_kept));
+          replace_tensor_data (priv, resized);
+        }
+      else
+        {
+          priv->tensor->resize_ (torch::IntArrayRef (dimensions));
+        }
+    }
+}
+
+/**
+ * scortch_local_tensor_get_dtype:
+ * @local_tensor: A #ScortchLocalTensor
+ *
+ * Get the type of the elements stored in the tensor.
+ *
+ * Returns: The #ScortchDType of the tensor elements.
+ */
+ScortchDType
+scortch_local_tensor_get_dtype (ScortchLocalTensor *local_tensor)
+{
+  ScortchLocalTensorPrivate *priv =
+    static_cast <ScortchLocalTensorPrivate *> (scortch_local_tensor_get_instance_private (local_tensor));
+  ScortchDType dtype = priv->construction_dtype;
+
+  if (priv->tensor != nullptr)
+    scortch_dtype_from_scalar_type (priv->tensor->scalar_type (), &dtype);
+
+  return dtype;
+}
+
+/**
+ * scortch_local_tensor_set_dtype:
+ * @local_tensor: A #ScortchLocalTensor
+ * @dtype: The #ScortchDType to store the tensor elements as.
+ *
+ * Set the type of the elements stored in the tensor. Existing
+ * elements are converted to the new type, which may lose
+ * precision. Data set afterwards is converted to this type
+ * as it is copied in.
+ */
+void
+scortch_local_tensor_set_dtype (ScortchLocalTensor *local_tensor,
+                                ScortchDType        dtype)
+{
+  ScortchLocalTensorPrivate *priv =
+    static_cast <ScortchLocalTensorPrivate *> (scortch_local_tensor_get_instance_private (local_tensor));
+
+  g_return_if_fail (scortch_dtype_check (dtype, nullptr));
+
+  priv->construction_dtype = dtype;
+
+  /* We can't convert until the underlying tensor is constructed */
+  if (priv->tensor != nullptr)
+    {
+      *priv->tensor = priv->tensor->to (scortch_dtype_to_scalar_type (dtype));
+      g_clear_pointer (&priv->capacity, (GDestroyNotify) safe_delete <torch::Tensor>);
     }
 }
 
@@ -387,18 +1153,23 @@ scortch_local_tensor_set_dimensions (ScortchLocalTensor *local_tensor,
  * Return the underlying data for a tensor as an array of variants
  * (av), where each variant in the array is itself an array
  * array of variants or an array of a particular datatype
- * (d|x|f).
+ * (d|x|i|y|b). Rows of element types that GVariant cannot represent
+ * are packed into a "(say)" tuple of the #ScortchDType nickname,
+ * for instance "float32", and the raw bytes of the row.
  *
  * The level of nesting of array-variants corresponds to
  * the number of dimensions in the tensor. For instance, a 2D
- * tensor will have an array of arrays of (d|x|f). It is the programmer's
+ * tensor will have an array of arrays of (d|x|i|y|b). It is the programmer's
  * responsibility to ensure that the returned variant is decoded
  * properly, both in terms of its nesting and its underlying
  * datatype.
  *
  * Note that calling this function will cause PyTorch to
  * copy data from GPU memory into CPU memory, so it should
- * be used seldomly.
+ * be used seldomly. The elements are copied once into a new
+ * contiguous buffer, which the rows of the returned variant
+ * then share without further copies, so the variant does not
+ * change if @local_tensor is modified in place afterwards.
  *
  * Returns: (transfer full): A floating reference to a new
  *          #GVariant containing the tensor data.
@@ -413,17 +1184,7 @@ scortch_local_tensor_get_data (ScortchLocalTensor  *local_tensor,
   if (priv->tensor == nullptr)
     return g_variant_ref (priv->construction_data_variant);
 
-  try
-    {
-      return serialize_tensor_data_to_nested_gvariants (*priv->tensor);
-    }
-  catch (InvalidScalarTypeError const &e)
-    {
-      return reinterpret_cast <GVariant *> (set_error_from_exception (e,
-                                                                      SCORTCH_ERROR,
-                                                                      SCORTCH_ERROR_INVALID_DATA_TYPE,
-                                                                      error));
-    }
+  return new_data_from_tensor (*priv->tensor, nullptr, error);
 }
 
 /**
@@ -434,11 +1195,13 @@ scortch_local_tensor_get_data (ScortchLocalTensor  *local_tensor,
  *        specified in %scortch_local_tensor_get_data.
  *
  * The tensor will be automatically resized and adopt
- * the dimensionality of the nested array of variants. It
- * is the programmer's responsibility to ensure that
- * sub-array sizes are consistent between sub-arrays
- * of the same dimension and that the underlying datatype
- * is consistent between all sub-arrays.
+ * the dimensionality of the nested array of variants, while
+ * elements are converted to the #ScortchLocalTensor:dtype of the
+ * tensor as they are copied in. Sub-array
+ * sizes must be consistent between sub-arrays of the same
+ * dimension and the underlying datatype must be consistent
+ * between all sub-arrays, otherwise %SCORTCH_ERROR_MALFORMED_DATA
+ * is returned and the tensor is left unchanged.
  *
  * PyTorch will likely copy the contents of the array
  * either into CPU memory or GPU memory as a result of
@@ -447,7 +1210,7 @@ scortch_local_tensor_get_data (ScortchLocalTensor  *local_tensor,
 gboolean
 scortch_local_tensor_set_data (ScortchLocalTensor  *local_tensor,
                                GVariant            *data,
-                               GError            **error)
+                               GError             **error)
 {
   ScortchLocalTensorPrivate *priv =
     static_cast <ScortchLocalTensorPrivate *> (scortch_local_tensor_get_instance_private (local_tensor));
@@ -458,17 +1221,13 @@ scortch_local_tensor_set_data (ScortchLocalTensor  *local_tensor,
 
   if (priv->tensor != nullptr)
     {
-      try
-        {
-          priv->tensor->set_data (new_tensor_from_nested_gvariants (data));
-        }
-      catch (InvalidVariantTypeError &e)
-        {
-          return (gboolean) (set_error_from_exception (e,
-                                                       SCORTCH_ERROR,
-                                                       SCORTCH_ERROR_INVALID_DATA_TYPE,
-                                                       error));
-        }
+      g_autoptr(GVariant) data_ref = g_variant_ref_sink (data);
+      torch::Tensor tensor;
+
+      if (!new_tensor_from_data (data_ref, priv->tensor->scalar_type (), nullptr, tensor, error))
+        return FALSE;
+
+      replace_tensor_data (priv, tensor);
     }
   else
     {
@@ -478,6 +1237,341 @@ scortch_local_tensor_set_data (ScortchLocalTensor  *local_tensor,
   return TRUE;
 }
 
+/**
+ * scortch_local_tensor_get_data_async:
+ * @local_tensor: A tensor to get the data for.
+ * @cancellable: (nullable): A #GCancellable
+ * @callback: A #GAsyncReadyCallback to call when the data is ready.
+ * @user_data: Data to pass to @callback.
+ *
+ * Asynchronous version of %scortch_local_tensor_get_data. The
+ * conversion runs on the scortch worker pool, see
+ * %scortch_worker_pool_set_max_threads, so the calling thread's
+ * main loop is not blocked while a large tensor is exported. The
+ * tensor should not be modified in place until @callback is called.
+ *
+ * Cancelling @cancellable stops the conversion between blocks of
+ * rows, and the task then fails with %G_IO_ERROR_CANCELLED.
+ */
+void
+scortch_local_tensor_get_data_async (ScortchLocalTensor  *local_tensor,
+                                     GCancellable        *cancellable,
+                                     GAsyncReadyCallback  callback,
+                                     gpointer             user_data)
+{
+  ScortchLocalTensorPrivate *priv =
+    static_cast <ScortchLocalTensorPrivate *> (scortch_local_tensor_get_instance_private (local_tensor));
+  g_autoptr(GTask) task = g_task_new (local_tensor, cancellable, callback, user_data);
+
+  g_task_set_source_tag (task, (gpointer) scortch_local_tensor_get_data_async);
+  g_task_set_task_data (task,
+                        new torch::Tensor (*priv->tensor),
+                        (GDestroyNotify) safe_delete <torch::Tensor>);
+
+  scortch_worker_pool_run_task (task, get_data_in_worker);
+}
+
+/**
+ * scortch_local_tensor_get_data_finish:
+ * @local_tensor: A #ScortchLocalTensor
+ * @result: A #GAsyncResult
+ * @error: A #GError
+ *
+ * Complete a call to %scortch_local_tensor_get_data_async.
+ *
+ * Returns: (transfer full): A #GVariant containing the tensor data
+ *          as described in %scortch_local_tensor_get_data, or %NULL
+ *          with @error set.
+ */
+GVariant *
+scortch_local_tensor_get_data_finish (ScortchLocalTensor  *local_tensor,
+                                      GAsyncResult        *result,
+                                      GError             **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, local_tensor), nullptr);
+
+  return static_cast <GVariant *> (g_task_propagate_pointer (G_TASK (result), error));
+}
+
+/**
+ * scortch_local_tensor_set_data_async:
+ * @local_tensor: A tensor to set the data on
+ * @data: (transfer none): A #GVariant of type "av" as described
+ *        in %scortch_local_tensor_set_data.
+ * @cancellable: (nullable): A #GCancellable
+ * @callback: A #GAsyncReadyCallback to call when the data is set.
+ * @user_data: Data to pass to @callback.
+ *
+ * Asynchronous version of %scortch_local_tensor_set_data. @data is
+ * converted into a new tensor on the scortch worker pool and only
+ * replaces the contents of @local_tensor once
+ * %scortch_local_tensor_set_data_finish is called, so the tensor
+ * can still be read on the calling thread in the meantime.
+ *
+ * Cancelling @cancellable stops the conversion between blocks of
+ * rows, and the task then fails with %G_IO_ERROR_CANCELLED.
+ */
+void
+scortch_local_tensor_set_data_async (ScortchLocalTensor  *local_tensor,
+                                     GVariant            *data,
+                                     GCancellable        *cancellable,
+                                     GAsyncReadyCallback  callback,
+                                     gpointer             user_data)
+{
+  g_autoptr(GTask) task = g_task_new (local_tensor, cancellable, callback, user_data);
+  at::ScalarType scalar_type =
+    scortch_dtype_to_scalar_type (scortch_local_tensor_get_dtype (local_tensor));
+
+  g_task_set_source_tag (task, (gpointer) scortch_local_tensor_set_data_async);
+  g_task_set_task_data (task,
+                        new SetDataTaskData (data, scalar_type),
+                        (GDestroyNotify) safe_delete <SetDataTaskData>);
+
+  scortch_worker_pool_run_task (task, set_data_in_worker);
+}
+
+/**
+ * scortch_local_tensor_set_data_finish:
+ * @local_tensor: A #ScortchLocalTensor
+ * @result: A #GAsyncResult
+ * @error: A #GError
+ *
+ * Complete a call to %scortch_local_tensor_set_data_async,
+ * replacing the contents of @local_tensor with the converted data.
+ * If the conversion failed or was cancelled, the tensor is left
+ * unchanged.
+ *
+ * Returns: %TRUE if the data was set, %FALSE with @error set otherwise.
+ */
+gboolean
+scortch_local_tensor_set_data_finish (ScortchLocalTensor  *local_tensor,
+                                      GAsyncResult        *result,
+                                      GError             **error)
+{
+  ScortchLocalTensorPrivate *priv =
+    static_cast <ScortchLocalTensorPrivate *> (scortch_local_tensor_get_instance_private (local_tensor));
+
+  g_return_val_if_fail (g_task_is_valid (result, local_tensor), FALSE);
+
+  torch::Tensor *tensor = static_cast <torch::Tensor *> (g_task_propagate_pointer (G_TASK (result), error));
+
+  if (tensor == nullptr)
+    return FALSE;
+
+  replace_tensor_data (priv, *tensor);
+  delete tensor;
+
+  return TRUE;
+}
+
+/**
+ * scortch_local_tensor_get_bytes:
+ * @local_tensor: A tensor to get the underlying bytes for.
+ *
+ * Return the underlying data for a tensor as a contiguous,
+ * row-major buffer of elements in native byte order. Unlike
+ * %scortch_local_tensor_get_data, the data is not copied if the
+ * tensor is already contiguous. The returned #GBytes holds a
+ * reference on the tensor storage, so it remains valid even if
+ * @local_tensor is finalized.
+ *
+ * Since the buffer is shared with the tensor, modifying the
+ * tensor in place will be visible through the returned #GBytes.
+ *
+ * Returns: (transfer full): A #GBytes containing the tensor data.
+ */
+GBytes *
+scortch_local_tensor_get_bytes (ScortchLocalTensor *local_tensor)
+{
+  ScortchLocalTensorPrivate *priv =
+    static_cast <ScortchLocalTensorPrivate *> (scortch_local_tensor_get_instance_private (local_tensor));
+
+  return new_bytes_for_contiguous_tensor (priv->tensor->contiguous ());
+}
+
+/**
+ * scortch_local_tensor_reserve:
+ * @local_tensor: A #ScortchLocalTensor
+ * @capacity_rows: The number of rows to reserve space for.
+ * @error: A #GError.
+ *
+ * Reserve space for at least @capacity_rows rows along the first
+ * dimension of @local_tensor, so that appending rows with
+ * %scortch_local_tensor_append_rows does not reallocate until the
+ * tensor holds more than @capacity_rows rows. The visible
+ * #ScortchLocalTensor:dimensions do not change, and the
+ * reservation never shrinks the tensor.
+ *
+ * Replacing the data of the tensor, for instance with
+ * %scortch_local_tensor_set_data or by changing its dtype, drops
+ * the reservation.
+ *
+ * Returns: %TRUE on success, or %FALSE with @error set if
+ *          @local_tensor is zero-dimensional or the space could
+ *          not be allocated, in which case the tensor is left
+ *          unchanged.
+ */
+gboolean
+scortch_local_tensor_reserve (ScortchLocalTensor  *local_tensor,
+                              gint64               capacity_rows,
+                              GError             **error)
+{
+  ScortchLocalTensorPrivate *priv =
+    static_cast <ScortchLocalTensorPrivate *> (scortch_local_tensor_get_instance_private (local_tensor));
+
+  g_return_val_if_fail (capacity_rows >= 0, FALSE);
+
+  if (!check_appendable (priv, error))
+    return FALSE;
+
+  return ensure_capacity_rows (priv, capacity_rows, error);
+}
+
+/**
+ * scortch_local_tensor_get_capacity:
+ * @local_tensor: A #ScortchLocalTensor
+ *
+ * Get the number of rows @local_tensor can hold along its first
+ * dimension before appending rows has to reallocate it.
+ *
+ * Returns: The number of rows reserved, which is at least the
+ *          number of rows in the tensor, or 0 for a
+ *          zero-dimensional tensor.
+ */
+gint64
+scortch_local_tensor_get_capacity (ScortchLocalTensor *local_tensor)
+{
+  ScortchLocalTensorPrivate *priv =
+    static_cast <ScortchLocalTensorPrivate *> (scortch_local_tensor_get_instance_private (local_tensor));
+
+  if (priv->tensor->dim () == 0)
+    return 0;
+
+  return current_capacity_rows (priv);
+}
+
+/**
+ * scortch_local_tensor_append_rows:
+ * @local_tensor: A #ScortchLocalTensor
+ * @data: (transfer none): A #GVariant of rows to append, in the
+ *        same nested format as %scortch_local_tensor_set_data.
+ * @error: A #GError.
+ *
+ * Append the rows in @data after the existing rows of
+ * @local_tensor, growing its first dimension. @data must have
+ * as many dimensions as the tensor and match all but its first
+ * dimension. Elements are converted to the
+ * #ScortchLocalTensor:dtype of the tensor as they are copied in.
+ *
+ * Unlike %scortch_local_tensor_set_dimensions, only the appended
+ * rows are copied. When the tensor runs out of reserved rows,
+ * its capacity is doubled, so appending one row at a time takes
+ * amortized constant time per row. Use
+ * %scortch_local_tensor_reserve to avoid reallocating at all if
+ * the final number of rows is known.
+ *
+ * Returns: %TRUE on success, or %FALSE with @error set if @data
+ *          is malformed, its rows do not match the tensor or
+ *          there is not enough memory for them, in which case
+ *          the tensor is left unchanged.
+ */
+gboolean
+scortch_local_tensor_append_rows (ScortchLocalTensor  *local_tensor,
+                                  GVariant            *data,
+                                  GError             **error)
+{
+  ScortchLocalTensorPrivate *priv =
+    static_cast <ScortchLocalTensorPrivate *> (scortch_local_tensor_get_instance_private (local_tensor));
+  g_autoptr(GVariant) data_ref = g_variant_ref_sink (data);
+  torch::Tensor rows;
+
+  if (!check_appendable (priv, error))
+    return FALSE;
+
+  if (!new_tensor_from_data (data_ref, priv->tensor->scalar_type (), nullptr, rows, error))
+    return FALSE;
+
+  if (rows.dim () != priv->tensor->dim () ||
+      rows.sizes ().slice (1) != priv->tensor->sizes ().slice (1))
+    {
+      g_set_error (error,
+                   SCORTCH_ERROR,
+                   SCORTCH_ERROR_INVALID_DIMENSIONS,
+                   "Cannot append rows of dimensions %s to a tensor with rows of dimensions %s",
+                   format_row_dimensions (rows.sizes ()).c_str (),
+                   format_row_dimensions (priv->tensor->sizes ()).c_str ());
+      return FALSE;
+    }
+
+  return append_rows_to_capacity (priv, rows, error);
+}
+
+/**
+ * scortch_local_tensor_append_rows_from_bytes:
+ * @local_tensor: A #ScortchLocalTensor
+ * @bytes: (transfer none): A #GBytes of contiguous, row-major
+ *         elements of the #ScortchLocalTensor:dtype of @local_tensor
+ *         in native byte order.
+ * @error: A #GError.
+ *
+ * Append the rows in @bytes after the existing rows of
+ * @local_tensor, like %scortch_local_tensor_append_rows but
+ * without going through #GVariant. The size of @bytes must be
+ * a whole number of rows.
+ *
+ * Returns: %TRUE on success, or %FALSE with @error set if the
+ *          size of @bytes is not a multiple of the row size or
+ *          there is not enough memory for the rows, in which case
+ *          the tensor is left unchanged.
+ */
+gboolean
+scortch_local_tensor_append_rows_from_bytes (ScortchLocalTensor  *local_tensor,
+                                             GBytes              *bytes,
+                                             GError             **error)
+{
+  ScortchLocalTensorPrivate *priv =
+    static_cast <ScortchLocalTensorPrivate *> (scortch_local_tensor_get_instance_private (local_tensor));
+
+  if (!check_appendable (priv, error))
+    return FALSE;
+
+  std::vector <int64_t> row_dimensions (priv->tensor->sizes ().begin (), priv->tensor->sizes ().end ());
+  row_dimensions[0] = 1;
+
+  size_t row_size;
+  gsize size;
+  gconstpointer data = g_bytes_get_data (bytes, &size);
+
+  if (!n_bytes_for_dimensions (row_dimensions, priv->tensor->dtype ().itemsize (), row_size, error))
+    return FALSE;
+
+  if (row_size == 0 || size % row_size != 0)
+    {
+      g_set_error (error,
+                   SCORTCH_ERROR,
+                   SCORTCH_ERROR_INVALID_DIMENSIONS,
+                   "Expected a multiple of %" G_GSIZE_FORMAT " bytes of data for rows "
+                   "of dimensions %s, but got %" G_GSIZE_FORMAT " bytes",
+                   row_size,
+                   format_row_dimensions (priv->tensor->sizes ()).c_str (),
+                   size);
+      return FALSE;
+    }
+
+  if (size == 0)
+    return TRUE;
+
+  row_dimensions[0] = static_cast <int64_t> (size / row_size);
+
+  /* The rows are copied straight out of bytes, so there is no
+   * need to worry about their alignment. */
+  torch::Tensor rows = torch::from_blob (const_cast <gpointer> (data),
+                                         torch::IntArrayRef (row_dimensions),
+                                         torch::TensorOptions ().dtype (priv->tensor->scalar_type ()));
+
+  return append_rows_to_capacity (priv, rows, error);
+}
+
 static void
 scortch_local_tensor_get_property (GObject    *object,
                                    guint       prop_id,
@@ -491,6 +1585,9 @@ scortch_local_tensor_get_property (GObject    *object,
       case PROP_DIMENSIONS:
         g_value_set_variant (value, scortch_local_tensor_get_dimensions (local_tensor));
         break;
+      case PROP_DTYPE:
+        g_value_set_enum (value, scortch_local_tensor_get_dtype (local_tensor));
+        break;
       case PROP_DATA:
         /* XXX: It seems that clang can't deduce the type of a function
          * pointer at the moment, so we work around that by calling through
@@ -524,6 +1621,10 @@ scortch_local_tensor_set_property (GObject      *object,
         scortch_local_tensor_set_dimensions (local_tensor,
                                              g_value_get_variant (value));
         break;
+      case PROP_DTYPE:
+        scortch_local_tensor_set_dtype (local_tensor,
+                                        static_cast <ScortchDType> (g_value_get_enum (value)));
+        break;
       case PROP_DATA:
         call_and_warn_about_gerror ("set 'data' property",
                                     [](ScortchLocalTensor  *local_tensor,
@@ -548,26 +1649,47 @@ scortch_local_tensor_constructed (GObject *object)
   ScortchLocalTensor *local_tensor = SCORTCH_LOCAL_TENSOR (object);
   ScortchLocalTensorPrivate *priv =
     static_cast <ScortchLocalTensorPrivate *> (scortch_local_tensor_get_instance_private (local_tensor));
+  at::ScalarType scalar_type = scortch_dtype_to_scalar_type (priv->construction_dtype);
+  torch::Tensor const *adopted_tensor = construction_tensor;
+
+  construction_tensor = nullptr;
 
-  priv->tensor = new torch::Tensor (torch::zeros (torch::IntArrayRef (int_list_from_g_variant (priv->dimension_list))));
+  if (adopted_tensor != nullptr)
+    {
+      priv->tensor = new torch::Tensor (*adopted_tensor);
+
+      g_clear_pointer (&priv->dimension_list, (GDestroyNotify) g_variant_unref);
+      priv->dimension_list = g_variant_ref_sink (g_variant_from_int_list (adopted_tensor->sizes ()));
+    }
 
-  /* We need to wait until we have the tensor to set
-   * its data from the construction parameters. */
-  if (priv->construction_data_variant != nullptr)
+  /* Construction properties can be set in any order, so data
+   * has to wait until the dtype is known. It is then converted
+   * straight into a single uninitialized tensor of its own shape,
+   * instead of filling in a zeroed tensor of the given dimensions
+   * that would be replaced right away. */
+  if (priv->tensor == nullptr && priv->construction_data_variant != nullptr)
     {
-      call_and_warn_about_gerror ("set 'data' property on construction",
-                                  [](ScortchLocalTensor  *local_tensor,
-                                      GVariant            *data,
-                                      GError             **error) -> decltype(auto) {
-                                    return scortch_local_tensor_set_data (local_tensor,
-                                                                          data,
-                                                                          error);
-                                  },
-                                  local_tensor,
-                                  priv->construction_data_variant);
-      g_clear_pointer (&priv->construction_data_variant, (GDestroyNotify) g_variant_unref);
+      g_autoptr(GVariant) data = static_cast <GVariant *> (g_steal_pointer (&priv->construction_data_variant));
+      g_autoptr(GError) error = nullptr;
+      torch::Tensor tensor;
+
+      if (new_tensor_from_data (data, scalar_type, nullptr, tensor, &error))
+        {
+          priv->tensor = new torch::Tensor (tensor);
+
+          g_clear_pointer (&priv->dimension_list, (GDestroyNotify) g_variant_unref);
+          priv->dimension_list = g_variant_ref_sink (g_variant_from_int_list (tensor.sizes ()));
+        }
+      else
+        {
+          g_warning ("Could not set 'data' property on construction: %s", error->message);
+        }
     }
 
+  if (priv->tensor == nullptr)
+    priv->tensor = new torch::Tensor (scortch_storage_pool_empty (torch::IntArrayRef (int_list_from_g_variant (priv->dimension_list)),
+                                                                  scalar_type).zero_ ());
+
   G_OBJECT_CLASS (scortch_local_tensor_parent_class)->constructed (object);
 }
 
@@ -579,6 +1701,7 @@ scortch_local_tensor_finalize (GObject *object)
     static_cast <ScortchLocalTensorPrivate *> (scortch_local_tensor_get_instance_private (local_tensor));
 
   g_clear_pointer (&priv->tensor, (GDestroyNotify) safe_delete <torch::Tensor>);
+  g_clear_pointer (&priv->capacity, (GDestroyNotify) safe_delete <torch::Tensor>);
   g_clear_pointer (&priv->dimension_list, (GDestroyNotify) g_variant_unref);
   g_clear_pointer (&priv->construction_data_variant, (GDestroyNotify) g_variant_unref);
 
@@ -614,6 +1737,25 @@ scortch_local_tensor_class_init (ScortchLocalTensorClass *klass)
                                                          static_cast <GParamFlags> (G_PARAM_READWRITE |
                                                                                     G_PARAM_CONSTRUCT)));
 
+  /**
+   * ScortchLocalTensor:dtype:
+   *
+   * The type of the elements stored in the tensor.
+   *
+   * Data set on the tensor is converted to this type as it is
+   * copied in, so that tensors keep their native element width
+   * regardless of how the data was transported.
+   */
+  g_object_class_install_property (object_class,
+                                   PROP_DTYPE,
+                                   g_param_spec_enum ("dtype",
+                                                      "DType",
+                                                      "Type of the Tensor elements",
+                                                      SCORTCH_TYPE_DTYPE,
+                                                      SCORTCH_DTYPE_FLOAT64,
+                                                      static_cast <GParamFlags> (G_PARAM_READWRITE |
+                                                                                 G_PARAM_CONSTRUCT)));
+
   /**
    * ScortchLocalTensor:data:
    *
@@ -621,11 +1763,10 @@ scortch_local_tensor_class_init (ScortchLocalTensorClass *klass)
    * with the leaf variants being arrays of concrete types.
    *
    * When set, the tensor will be automatically resized and adopt
-   * the dimensionality of the nested array of variants. It
-   * is the programmer's responsibility to ensure that
-   * sub-array sizes are consistent between sub-arrays
-   * of the same dimension and that the underlying datatype
-   * is consistent between all sub-arrays. Error cannot be thrown
+   * the dimensionality of the nested array of variants. Sub-array
+   * sizes must be consistent between sub-arrays of the same
+   * dimension and the underlying datatype must be consistent
+   * between all sub-arrays. Error cannot be thrown
    * from accessing properties, so if an error occurs %NULL will
    * be returned and an error message printed to the standard out. If
    * you need to handle errors, use %scortch_local_tensor_set_data instead.
@@ -656,3 +1797,275 @@ scortch_local_tensor_new (void)
 {
   return static_cast <ScortchLocalTensor *> (g_object_new (SCORTCH_TYPE_LOCAL_TENSOR, NULL));
 }
+
+/**
+ * scortch_local_tensor_new_from_bytes:
+ * @bytes: (transfer none): A #GBytes of contiguous, row-major elements
+ *         in native byte order.
+ * @dimensions: A #GVariant of type "ax" with the dimensions of the tensor.
+ * @dtype: The #ScortchDType of the elements in @bytes.
+ * @error: A #GError.
+ *
+ * Create a new #ScortchLocalTensor directly over the memory
+ * in @bytes, without copying it. A reference is kept on @bytes
+ * for as long as the tensor storage is alive.
+ *
+ * Since #GBytes is immutable, in-place operations on the tensor
+ * and its views fail with %SCORTCH_ERROR_INVALID_OPERATION.
+ * Use %scortch_local_tensor_clone to get a copy that can be
+ * modified.
+ *
+ * Returns: (transfer full): A new #ScortchLocalTensor or %NULL
+ *          with @error set if @dimensions has negative entries
+ *          or the size of @bytes does not match @dimensions
+ *          and @dtype.
+ */
+ScortchLocalTensor *
+scortch_local_tensor_new_from_bytes (GBytes        *bytes,
+                                     GVariant      *dimensions,
+                                     ScortchDType   dtype,
+                                     GError       **error)
+{
+  g_autoptr(GVariant) dimensions_ref = g_variant_ref_sink (dimensions);
+
+  if (!scortch_dtype_check (dtype, error))
+    return nullptr;
+
+  std::vector <int64_t> dimensions_vec (int_list_from_g_variant (dimensions_ref));
+  at::ScalarType scalar_type = scortch_dtype_to_scalar_type (dtype);
+  size_t element_size = c10::elementSize (scalar_type);
+  size_t expected_size;
+
+  if (!n_bytes_for_dimensions (dimensions_vec, element_size, expected_size, error))
+    return nullptr;
+
+  gsize size;
+  gconstpointer data = g_bytes_get_data (bytes, &size);
+
+  if (size != expected_size)
+    {
+      g_set_error (error,
+                   SCORTCH_ERROR,
+                   SCORTCH_ERROR_INVALID_DIMENSIONS,
+                   "Expected %" G_GSIZE_FORMAT " bytes of data for the given "
+                   "dimensions and dtype, but got %" G_GSIZE_FORMAT " bytes",
+                   expected_size,
+                   size);
+      return nullptr;
+    }
+
+  /* PyTorch kernels assume that elements are naturally
+   * aligned, so we have to copy if they are not. */
+  if (reinterpret_cast <uintptr_t> (data) % element_size != 0)
+    {
+      ScortchTraceScope trace ("new-from-bytes-copy");
+      torch::Tensor tensor (scortch_storage_pool_empty (torch::IntArrayRef (dimensions_vec),
+                                                        scalar_type));
+      memcpy (tensor.data_ptr (), data, size);
+      trace.add_bytes (size);
+
+      return scortch_local_tensor_new_from_tensor (tensor);
+    }
+
+  return scortch_local_tensor_new_from_tensor (scortch_tensor_new_from_foreign_buffer (const_cast <gpointer> (data),
+                                                                                   torch::IntArrayRef (dimensions_vec),
+                                                                                   scalar_type,
+                                                                                   true,
+                                                                                   (GDestroyNotify) g_bytes_unref,
+                                                                                   g_bytes_ref (bytes)));
+}
+
+/**
+ * scortch_local_tensor_new_from_mapped_file:
+ * @path: (type filename): Path to the file to map.
+ * @dimensions: A #GVariant of type "ax" with the dimensions of the tensor.
+ * @dtype: The #ScortchDType of the elements in the file.
+ * @offset: Offset in bytes from the start of the file to the first element.
+ * @flags: A #ScortchMappedFileFlags controlling how the file is mapped.
+ * @error: A #GError.
+ *
+ * Create a new #ScortchLocalTensor over a memory mapping of
+ * contiguous, row-major elements in native byte order stored in
+ * @path, starting at @offset. Nothing is read from the file
+ * up front; pages are faulted in by the kernel as they are
+ * accessed and are shared with any other process mapping the
+ * same file. The file is unmapped once the tensor storage is
+ * no longer referenced.
+ *
+ * By default the mapping is read-only, so in-place operations
+ * on the tensor fail with %SCORTCH_ERROR_INVALID_OPERATION. Pass %SCORTCH_MAPPED_FILE_FLAGS_COPY_ON_WRITE
+ * to get a private mapping that can be modified, where modified
+ * pages are copied and changes are never written back to the file.
+ *
+ * Returns: (transfer full): A new #ScortchLocalTensor or %NULL
+ *          with @error set if @dimensions has negative entries,
+ *          the file could not be mapped, or it is too short to
+ *          hold @dimensions elements of @dtype at @offset.
+ */
+ScortchLocalTensor *
+scortch_local_tensor_new_from_mapped_file (const char              *path,
+                                           GVariant                *dimensions,
+                                           ScortchDType             dtype,
+                                           goffset                  offset,
+                                           ScortchMappedFileFlags   flags,
+                                           GError                 **error)
+{
+  g_autoptr(GVariant) dimensions_ref = g_variant_ref_sink (dimensions);
+
+  if (!scortch_dtype_check (dtype, error))
+    return nullptr;
+
+  std::vector <int64_t> dimensions_vec (int_list_from_g_variant (dimensions_ref));
+  at::ScalarType scalar_type = scortch_dtype_to_scalar_type (dtype);
+  size_t element_size = c10::elementSize (scalar_type);
+  size_t expected_size;
+
+  if (!n_bytes_for_dimensions (dimensions_vec, element_size, expected_size, error))
+    return nullptr;
+
+  /* The mapping itself is page aligned, so an offset that is a
+   * multiple of the element size keeps elements aligned too. */
+  if (offset < 0 || static_cast <size_t> (offset) % element_size != 0)
+    {
+      g_set_error (error,
+                   SCORTCH_ERROR,
+                   SCORTCH_ERROR_INVALID_DIMENSIONS,
+                   "Offset %" G_GOFFSET_FORMAT " is not a non-negative multiple "
+                   "of the element size %" G_GSIZE_FORMAT,
+                   offset,
+                   element_size);
+      return nullptr;
+    }
+
+  /* A writable GMappedFile is a private mapping, so
+   * writes are copy-on-write and never reach the file. */
+  gboolean writable = (flags & SCORTCH_MAPPED_FILE_FLAGS_COPY_ON_WRITE) != 0;
+  g_autoptr(GMappedFile) mapped_file = g_mapped_file_new (path, writable, error);
+
+  if (mapped_file == nullptr)
+    return nullptr;
+
+  size_t length = g_mapped_file_get_length (mapped_file);
+
+  if (static_cast <size_t> (offset) > length ||
+      length - static_cast <size_t> (offset) < expected_size)
+    {
+      g_set_error (error,
+                   SCORTCH_ERROR,
+                   SCORTCH_ERROR_INVALID_DIMENSIONS,
+                   "Expected %" G_GSIZE_FORMAT " bytes of data at offset %"
+                   G_GOFFSET_FORMAT " of %s, but the file is only %"
+                   G_GSIZE_FORMAT " bytes long",
+                   expected_size,
+                   offset,
+                   path,
+                   length);
+      return nullptr;
+    }
+
+  return scortch_local_tensor_new_from_tensor (scortch_tensor_new_from_foreign_buffer (g_mapped_file_get_contents (mapped_file) + offset,
+                                                                                   torch::IntArrayRef (dimensions_vec),
+                                                                                   scalar_type,
+                                                                                   !writable,
+                                                                                   (GDestroyNotify) g_mapped_file_unref,
+                                                                                   g_mapped_file_ref (mapped_file)));
+}
+
+namespace
+{
+  /* Storage of foreign buffers that must not be written to, by
+   * data pointer. A multiset, since several tensors can be made
+   * over the same immutable buffer. Views share their storage,
+   * so they are covered too. */
+  GMutex read_only_storage_mutex;
+  std::multiset <void const *> read_only_storage;
+}
+
+torch::Tensor
+scortch_tensor_new_from_foreign_buffer (gpointer            data,
+                                        torch::IntArrayRef  dimensions,
+                                        at::ScalarType      scalar_type,
+                                        bool                read_only,
+                                        GDestroyNotify      release,
+                                        gpointer            release_data)
+{
+  if (read_only)
+    {
+      g_mutex_lock (&read_only_storage_mutex);
+      read_only_storage.insert (data);
+      g_mutex_unlock (&read_only_storage_mutex);
+    }
+
+  return torch::from_blob (data,
+                           dimensions,
+                           [read_only, release, release_data](void *blob) {
+                             if (read_only)
+                               {
+                                 g_mutex_lock (&read_only_storage_mutex);
+                                 read_only_storage.erase (read_only_storage.find (blob));
+                                 g_mutex_unlock (&read_only_storage_mutex);
+                               }
+
+                             release (release_data);
+                           },
+                           torch::TensorOptions ().dtype (scalar_type));
+}
+
+bool
+scortch_tensor_check_writable (torch::Tensor const  &tensor,
+                               GError              **error)
+{
+  g_mutex_lock (&read_only_storage_mutex);
+  bool read_only = read_only_storage.count (tensor.storage ().data ()) > 0;
+  g_mutex_unlock (&read_only_storage_mutex);
+
+  if (read_only)
+    {
+      g_set_error (error,
+                   SCORTCH_ERROR,
+                   SCORTCH_ERROR_INVALID_OPERATION,
+                   "Tensor is backed by read-only memory and cannot be modified in place");
+      return false;
+    }
+
+  return true;
+}
+
+ScortchLocalTensor *
+scortch_local_tensor_new_from_tensor (torch::Tensor const &tensor)
+{
+  /* Tensors of types that ScortchDType cannot express are
+   * converted to double precision so that they can still be read. */
+  ScortchDType dtype;
+  torch::Tensor adopted (scortch_dtype_from_scalar_type (tensor.scalar_type (), &dtype) ?
+                         tensor : tensor.to (torch::kFloat64));
+
+  construction_tensor = &adopted;
+
+  return static_cast <ScortchLocalTensor *> (g_object_new (SCORTCH_TYPE_LOCAL_TENSOR, NULL));
+}
+
+std::vector <int64_t>
+scortch_dimensions_from_g_variant (GVariant *dimensions)
+{
+  return int_list_from_g_variant (dimensions);
+}
+
+torch::Tensor &
+scortch_local_tensor_get_tensor (ScortchLocalTensor *local_tensor)
+{
+  ScortchLocalTensorPrivate *priv =
+    static_cast <ScortchLocalTensorPrivate *> (scortch_local_tensor_get_instance_private (local_tensor));
+
+  return *priv->tensor;
+}
+
+void
+scortch_local_tensor_replace_tensor (ScortchLocalTensor  *local_tensor,
+                                     torch::Tensor const &tensor)
+{
+  ScortchLocalTensorPrivate *priv =
+    static_cast <ScortchLocalTensorPrivate *> (scortch_local_tensor_get_instance_private (local_tensor));
+
+  replace_tensor_data (priv, tensor);
+}
@@ -23,22 +23,85 @@
 
 #pragma once
 
+#include <gio/gio.h>
 #include <glib.h>
 #include <glib-object.h>
 
+#include <scortch/scortch-dtype.h>
+
 G_BEGIN_DECLS
 
+/**
+ * ScortchMappedFileFlags:
+ * @SCORTCH_MAPPED_FILE_FLAGS_NONE: Map the file read-only.
+ * @SCORTCH_MAPPED_FILE_FLAGS_COPY_ON_WRITE: Map the file privately, so
+ *   that the tensor can be modified in place without the changes
+ *   being written back to the file.
+ *
+ * Flags controlling how %scortch_local_tensor_new_from_mapped_file
+ * maps a file.
+ */
+typedef enum {
+  SCORTCH_MAPPED_FILE_FLAGS_NONE = 0,
+  SCORTCH_MAPPED_FILE_FLAGS_COPY_ON_WRITE = 1 << 0
+} ScortchMappedFileFlags;
+
 #define SCORTCH_TYPE_LOCAL_TENSOR scortch_local_tensor_get_type ()
 G_DECLARE_FINAL_TYPE (ScortchLocalTensor, scortch_local_tensor, SCORTCH, LOCAL_TENSOR, GObject)
 
-GVariant * scortch_local_tensor_get_data (ScortchLocalTensor *local_tensor);
-void scortch_local_tensor_set_data (ScortchLocalTensor *local_tensor,
-                                    GVariant           *data);
+GVariant * scortch_local_tensor_get_data (ScortchLocalTensor  *local_tensor,
+                                          GError             **error);
+gboolean scortch_local_tensor_set_data (ScortchLocalTensor  *local_tensor,
+                                        GVariant            *data,
+                                        GError             **error);
+
+void scortch_local_tensor_get_data_async (ScortchLocalTensor  *local_tensor,
+                                          GCancellable        *cancellable,
+                                          GAsyncReadyCallback  callback,
+                                          gpointer             user_data);
+GVariant * scortch_local_tensor_get_data_finish (ScortchLocalTensor  *local_tensor,
+                                                 GAsyncResult        *result,
+                                                 GError             **error);
+void scortch_local_tensor_set_data_async (ScortchLocalTensor  *local_tensor,
+                                          GVariant            *data,
+                                          GCancellable        *cancellable,
+                                          GAsyncReadyCallback  callback,
+                                          gpointer             user_data);
+gboolean scortch_local_tensor_set_data_finish (ScortchLocalTensor  *local_tensor,
+                                               GAsyncResult        *result,
+                                               GError             **error);
+
+ScortchDType scortch_local_tensor_get_dtype (ScortchLocalTensor *local_tensor);
+void scortch_local_tensor_set_dtype (ScortchLocalTensor *local_tensor,
+                                     ScortchDType        dtype);
+
+GBytes * scortch_local_tensor_get_bytes (ScortchLocalTensor *local_tensor);
+
+gboolean scortch_local_tensor_reserve (ScortchLocalTensor  *local_tensor,
+                                       gint64               capacity_rows,
+                                       GError             **error);
+gint64 scortch_local_tensor_get_capacity (ScortchLocalTensor *local_tensor);
+gboolean scortch_local_tensor_append_rows (ScortchLocalTensor  *local_tensor,
+                                           GVariant            *data,
+                                           GError             **error);
+gboolean scortch_local_tensor_append_rows_from_bytes (ScortchLocalTensor  *local_tensor,
+                                                      GBytes              *bytes,
+                                                      GError             **error);
 
 GVariant * scortch_local_tensor_get_dimensions (ScortchLocalTensor *local_tensor);
 void scortch_local_tensor_set_dimensions (ScortchLocalTensor *local_tensor,
                                           GVariant           *dimensions);
 
 ScortchLocalTensor * scortch_local_tensor_new (void);
+ScortchLocalTensor * scortch_local_tensor_new_from_bytes (GBytes        *bytes,
+                                                          GVariant      *dimensions,
+                                                          ScortchDType   dtype,
+                                                          GError       **error);
+ScortchLocalTensor * scortch_local_tensor_new_from_mapped_file (const char              *path,
+                                                                GVariant                *dimensions,
+                                                                ScortchDType             dtype,
+                                                                goffset                  offset,
+                                                                ScortchMappedFileFlags   flags,
+                                                                GError                 **error);
 
 G_END_DECLS
@@ -0,0 +1,451 @@
+/*
+ * /scortch/module.cpp
+ *
+ * GObject Binding to TorchScript modules, so that serialized
+ * models can be run on ScortchLocalTensor inputs. C++ source file.
+ *
+ * Copyright (C) 2018 Sam Spilsbury.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string>
+#include <vector>
+
+#include <gio/gio.h>
+#include <glib-object.h>
+#include <glib.h>
+
+#include <torch/script.h>
+#include <torch/torch.h>
+
+#include <scortch/local-tensor.h>
+#include <scortch/local-tensor-internal.h>
+#include <scortch/module.h>
+#include <scortch/module-internal.h>
+#include <scortch/scortch-errors.h>
+#include <scortch/scortch-tracing-internal.h>
+#include <scortch/scortch-worker-pool-internal.h>
+
+struct _ScortchModule
+{
+  GObject parent_instance;
+};
+
+typedef struct _ScortchModulePrivate {
+  torch::jit::Module *module;
+  gboolean frozen;
+
+  /* Copies of the module share its underlying object, so forward
+   * passes hold this for reading and eval and freeze, which change
+   * the object, hold it for writing. */
+  GRWLock lock;
+} ScortchModulePrivate;
+
+G_DEFINE_TYPE_WITH_PRIVATE (ScortchModule, scortch_module, G_TYPE_OBJECT);
+
+namespace
+{
+  template <typename T>
+  void safe_delete (T *t)
+  {
+    delete t;
+  }
+
+  std::vector <torch::jit::IValue> ivalues_from_local_tensors (ScortchLocalTensor **inputs,
+                                                               gsize                n_inputs)
+  {
+    std::vector <torch::jit::IValue> ivalues;
+    ivalues.reserve (n_inputs);
+
+    for (gsize i = 0; i < n_inputs; ++i)
+      ivalues.push_back (scortch_local_tensor_get_tensor (inputs[i]));
+
+    return ivalues;
+  }
+
+  /* Inference never needs the autograd graph, so gradients are
+   * always disabled. NoGradGuard is thread local, so this must
+   * be called on the thread that runs the module. */
+  bool run_forward (torch::jit::Module                &module,
+                    std::vector <torch::jit::IValue>  &inputs,
+                    torch::Tensor                     &output,
+                    GError                           **error)
+  {
+    ScortchTraceScope trace ("module-forward");
+
+    return scortch_call_torch ([&]() {
+      torch::NoGradGuard no_grad;
+      output = module.forward (inputs).toTensor ();
+    }, error);
+  }
+
+  /* The module and inputs are shallow copies, so the worker does
+   * not touch the GObjects, and a concurrent freeze replacing the
+   * module does not affect a forward pass already in flight. */
+  struct ForwardTaskData
+  {
+    torch::jit::Module                module;
+    std::vector <torch::jit::IValue>  inputs;
+  };
+
+  void forward_in_worker (GTask        *task,
+                          gpointer      source_object,
+                          gpointer      task_data,
+                          GCancellable *cancellable G_GNUC_UNUSED)
+  {
+    ScortchModulePrivate *priv =
+      static_cast <ScortchModulePrivate *> (scortch_module_get_instance_private (SCORTCH_MODULE (source_object)));
+    ForwardTaskData *data = static_cast <ForwardTaskData *> (task_data);
+    g_autoptr(GError) error = nullptr;
+    torch::Tensor output;
+    bool succeeded;
+
+    g_rw_lock_reader_lock (&priv->lock);
+    succeeded = run_forward (data->module, data->inputs, output, &error);
+    g_rw_lock_reader_unlock (&priv->lock);
+
+    if (!succeeded)
+      {
+        g_task_return_error (task, static_cast <GError *> (g_steal_pointer (&error)));
+        return;
+      }
+
+    g_task_return_pointer (task,
+                           new torch::Tensor (output),
+                           (GDestroyNotify) safe_delete <torch::Tensor>);
+  }
+}
+
+/**
+ * scortch_module_forward:
+ * @module: A #ScortchModule
+ * @inputs: (array length=n_inputs): The #ScortchLocalTensor arguments
+ *          to the forward method of @module.
+ * @n_inputs: The number of tensors in @inputs.
+ * @error: A #GError
+ *
+ * Run the forward method of @module on @inputs. Gradients are
+ * not tracked, since this is intended for inference.
+ *
+ * Returns: (transfer full): A new #ScortchLocalTensor with the
+ *          output of the module, or %NULL with @error set if
+ *          the module raised an error or did not return a tensor.
+ */
+ScortchLocalTensor *
+scortch_module_forward (ScortchModule       *module,
+                        ScortchLocalTensor **inputs,
+                        gsize                n_inputs,
+                        GError             **error)
+{
+  ScortchModulePrivate *priv =
+    static_cast <ScortchModulePrivate *> (scortch_module_get_instance_private (module));
+
+  g_return_val_if_fail (priv->module != nullptr, nullptr);
+
+  std::vector <torch::jit::IValue> ivalues (ivalues_from_local_tensors (inputs, n_inputs));
+  torch::Tensor output;
+  bool succeeded;
+
+  g_rw_lock_reader_lock (&priv->lock);
+  succeeded = run_forward (*priv->module, ivalues, output, error);
+  g_rw_lock_reader_unlock (&priv->lock);
+
+  if (!succeeded)
+    return nullptr;
+
+  return scortch_local_tensor_new_from_tensor (output);
+}
+
+/**
+ * scortch_module_forward_async:
+ * @module: A #ScortchModule
+ * @inputs: (array length=n_inputs): The #ScortchLocalTensor arguments
+ *          to the forward method of @module.
+ * @n_inputs: The number of tensors in @inputs.
+ * @cancellable: (nullable): A #GCancellable
+ * @callback: A #GAsyncReadyCallback to call when the output is ready.
+ * @user_data: Data to pass to @callback.
+ *
+ * Asynchronous version of %scortch_module_forward, run on the
+ * scortch worker pool. The inputs should not be modified in
+ * place until @callback is called.
+ */
+void
+scortch_module_forward_async (ScortchModule        *module,
+                              ScortchLocalTensor  **inputs,
+                              gsize                 n_inputs,
+                              GCancellable         *cancellable,
+                              GAsyncReadyCallback   callback,
+                              gpointer              user_data)
+{
+  ScortchModulePrivate *priv =
+    static_cast <ScortchModulePrivate *> (scortch_module_get_instance_private (module));
+
+  g_return_if_fail (priv->module != nullptr);
+
+  g_autoptr(GTask) task = g_task_new (module, cancellable, callback, user_data);
+
+  g_task_set_source_tag (task, (gpointer) scortch_module_forward_async);
+
+  g_rw_lock_reader_lock (&priv->lock);
+  g_task_set_task_data (task,
+                        new ForwardTaskData {
+                          *priv->module,
+                          ivalues_from_local_tensors (inputs, n_inputs)
+                        },
+                        (GDestroyNotify) safe_delete <ForwardTaskData>);
+  g_rw_lock_reader_unlock (&priv->lock);
+
+  scortch_worker_pool_run_task (task, forward_in_worker);
+}
+
+/**
+ * scortch_module_forward_finish:
+ * @module: A #ScortchModule
+ * @result: A #GAsyncResult
+ * @error: A #GError
+ *
+ * Complete a call to %scortch_module_forward_async.
+ *
+ * Returns: (transfer full): A new #ScortchLocalTensor with the
+ *          output of the module, or %NULL with @error set.
+ */
+ScortchLocalTensor *
+scortch_module_forward_finish (ScortchModule  *module,
+                               GAsyncResult   *result,
+                               GError        **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, module), nullptr);
+
+  torch::Tensor *output = static_cast <torch::Tensor *> (g_task_propagate_pointer (G_TASK (result), error));
+
+  if (output == nullptr)
+    return nullptr;
+
+  ScortchLocalTensor *local_output = scortch_local_tensor_new_from_tensor (*output);
+  delete output;
+
+  return local_output;
+}
+
+/**
+ * scortch_module_eval:
+ * @module: A #ScortchModule
+ *
+ * Put @module and its submodules into evaluation mode, which
+ * changes the behaviour of layers like dropout and batch
+ * normalization for inference. Forward passes running on the
+ * worker pool share the module, so this waits for them to
+ * finish first.
+ */
+void
+scortch_module_eval (ScortchModule *module)
+{
+  ScortchModulePrivate *priv =
+    static_cast <ScortchModulePrivate *> (scortch_module_get_instance_private (module));
+
+  g_return_if_fail (priv->module != nullptr);
+
+  g_rw_lock_writer_lock (&priv->lock);
+  priv->module->eval ();
+  g_rw_lock_writer_unlock (&priv->lock);
+}
+
+/**
+ * scortch_module_get_training:
+ * @module: A #ScortchModule
+ *
+ * Get whether @module is in training mode.
+ *
+ * Returns: %TRUE if @module is in training mode, %FALSE if
+ *          it is in evaluation mode.
+ */
+gboolean
+scortch_module_get_training (ScortchModule *module)
+{
+  ScortchModulePrivate *priv =
+    static_cast <ScortchModulePrivate *> (scortch_module_get_instance_private (module));
+
+  g_return_val_if_fail (priv->module != nullptr, FALSE);
+
+  g_rw_lock_reader_lock (&priv->lock);
+  gboolean training = priv->module->is_training ();
+  g_rw_lock_reader_unlock (&priv->lock);
+
+  return training;
+}
+
+/**
+ * scortch_module_freeze:
+ * @module: A #ScortchModule
+ * @error: A #GError
+ *
+ * Put @module into evaluation mode and freeze it, inlining its
+ * parameters and attributes into the graph as constants so that
+ * the JIT can optimize it further. A frozen module can no
+ * longer be trained. Freezing an already frozen module does nothing.
+ *
+ * This waits for forward passes running on the worker pool to
+ * finish first. Forward passes that were queued before the call
+ * but start afterwards run the unfrozen module in evaluation mode.
+ *
+ * Returns: %TRUE on success, %FALSE with @error set if the
+ *          module could not be frozen.
+ */
+gboolean
+scortch_module_freeze (ScortchModule  *module,
+                       GError        **error)
+{
+  ScortchModulePrivate *priv =
+    static_cast <ScortchModulePrivate *> (scortch_module_get_instance_private (module));
+
+  g_return_val_if_fail (priv->module != nullptr, FALSE);
+
+  g_rw_lock_writer_lock (&priv->lock);
+
+  if (!priv->frozen)
+    {
+      torch::jit::Module frozen_module;
+
+      if (!scortch_call_torch ([&]() {
+            priv->module->eval ();
+            frozen_module = torch::jit::freeze (*priv->module);
+          }, error))
+        {
+          g_rw_lock_writer_unlock (&priv->lock);
+          return FALSE;
+        }
+
+      *priv->module = frozen_module;
+      priv->frozen = TRUE;
+    }
+
+  g_rw_lock_writer_unlock (&priv->lock);
+
+  return TRUE;
+}
+
+/**
+ * scortch_module_get_frozen:
+ * @module: A #ScortchModule
+ *
+ * Get whether @module was frozen with %scortch_module_freeze.
+ *
+ * Returns: %TRUE if @module is frozen.
+ */
+gboolean
+scortch_module_get_frozen (ScortchModule *module)
+{
+  ScortchModulePrivate *priv =
+    static_cast <ScortchModulePrivate *> (scortch_module_get_instance_private (module));
+
+  return priv->frozen;
+}
+
+static void
+scortch_module_finalize (GObject *object)
+{
+  ScortchModule *module = SCORTCH_MODULE (object);
+  ScortchModulePrivate *priv =
+    static_cast <ScortchModulePrivate *> (scortch_module_get_instance_private (module));
+
+  g_clear_pointer (&priv->module, (GDestroyNotify) safe_delete <torch::jit::Module>);
+  g_rw_lock_clear (&priv->lock);
+
+  G_OBJECT_CLASS (scortch_module_parent_class)->finalize (object);
+}
+
+static void
+scortch_module_class_init (ScortchModuleClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = scortch_module_finalize;
+}
+
+static void
+scortch_module_init (ScortchModule *module)
+{
+  ScortchModulePrivate *priv =
+    static_cast <ScortchModulePrivate *> (scortch_module_get_instance_private (module));
+
+  g_rw_lock_init (&priv->lock);
+}
+
+/**
+ * scortch_module_new_from_file:
+ * @path: (type filename): The path to a TorchScript module
+ *        serialized with torch.jit.save.
+ * @error: A #GError
+ *
+ * Load a serialized TorchScript module from @path. The module is
+ * loaded in the mode it was saved in, so most callers will want
+ * to call %scortch_module_eval or %scortch_module_freeze before
+ * running inference.
+ *
+ * Returns: (transfer full): A new #ScortchModule or %NULL with
+ *          @error set if the module could not be loaded.
+ */
+ScortchModule *
+scortch_module_new_from_file (const char  *path,
+                              GError     **error)
+{
+  torch::jit::Module loaded_module;
+
+  try
+    {
+      loaded_module = torch::jit::load (std::string (path));
+    }
+  catch (c10::Error const &e)
+    {
+      g_set_error (error,
+                   SCORTCH_ERROR,
+                   SCORTCH_ERROR_INVALID_MODULE,
+                   "Could not load module from %s: %s",
+                   path,
+                   e.what_without_backtrace ());
+      return nullptr;
+    }
+  catch (std::exception const &e)
+    {
+      g_set_error (error,
+                   SCORTCH_ERROR,
+                   SCORTCH_ERROR_INVALID_MODULE,
+                   "Could not load module from %s: %s",
+                   path,
+                   e.what ());
+      return nullptr;
+    }
+
+  ScortchModule *module = static_cast <ScortchModule *> (g_object_new (SCORTCH_TYPE_MODULE, NULL));
+  ScortchModulePrivate *priv =
+    static_cast <ScortchModulePrivate *> (scortch_module_get_instance_private (module));
+
+  priv->module = new torch::jit::Module (loaded_module);
+
+  return module;
+}
+
+torch::jit::Module &
+scortch_module_get_module (ScortchModule *module)
+{
+  ScortchModulePrivate *priv =
+    static_cast <ScortchModulePrivate *> (scortch_module_get_instance_private (module));
+
+  g_assert (priv->module != nullptr);
+
+  return *priv->module;
+}
@@ -0,0 +1,60 @@
+/*
+ * /scortch/module.h
+ *
+ * GObject Binding to TorchScript modules, so that serialized
+ * models can be run on ScortchLocalTensor inputs.
+ *
+ * Copyright (C) 2018 Sam Spilsbury.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+#include <glib.h>
+#include <glib-object.h>
+
+#include <scortch/local-tensor.h>
+
+G_BEGIN_DECLS
+
+#define SCORTCH_TYPE_MODULE scortch_module_get_type ()
+G_DECLARE_FINAL_TYPE (ScortchModule, scortch_module, SCORTCH, MODULE, GObject)
+
+ScortchModule * scortch_module_new_from_file (const char  *path,
+                                              GError     **error);
+
+ScortchLocalTensor * scortch_module_forward (ScortchModule       *module,
+                                             ScortchLocalTensor **inputs,
+                                             gsize                n_inputs,
+                                             GError             **error);
+void scortch_module_forward_async (ScortchModule        *module,
+                                   ScortchLocalTensor  **inputs,
+                                   gsize                 n_inputs,
+                                   GCancellable         *cancellable,
+                                   GAsyncReadyCallback   callback,
+                                   gpointer              user_data);
+ScortchLocalTensor * scortch_module_forward_finish (ScortchModule  *module,
+                                                    GAsyncResult   *result,
+                                                    GError        **error);
+
+void scortch_module_eval (ScortchModule *module);
+gboolean scortch_module_get_training (ScortchModule *module);
+gboolean scortch_module_freeze (ScortchModule  *module,
+                                GError        **error);
+gboolean scortch_module_get_frozen (ScortchModule *module);
+
+G_END_DECLS
@@ -0,0 +1,47 @@
+/*
+ * /scortch/scortch-dtype-internal.h
+ *
+ * Conversions between ScortchDType and PyTorch scalar types.
+ * Private C++ header, not installed.
+ *
+ * Copyright (C) 2018 Sam Spilsbury.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <torch/torch.h>
+
+#include <scortch/scortch-dtype.h>
+
+at::ScalarType scortch_dtype_to_scalar_type (ScortchDType dtype);
+
+/* Returns false with SCORTCH_ERROR_INVALID_DATA_TYPE set if dtype
+ * is not one of the ScortchDType values, for instance an integer
+ * passed in from a language binding. */
+bool scortch_dtype_check (ScortchDType   dtype,
+                          GError       **error);
+
+/* Returns false if scalar_type has no corresponding ScortchDType. */
+bool scortch_dtype_from_scalar_type (at::ScalarType  scalar_type,
+                                     ScortchDType   *out_dtype);
+
+/* The nickname used to tag packed "(say)" rows, for instance "float32". */
+char const * scortch_dtype_to_nick (ScortchDType dtype);
+
+/* Returns false if nick does not name a ScortchDType. */
+bool scortch_dtype_from_nick (char const   *nick,
+                              ScortchDType *out_dtype);
@@ -0,0 +1,167 @@
+/*
+ * /scortch/scortch-dtype.cpp
+ *
+ * Element types that tensors in scortch can hold.
+ *
+ * Copyright (C) 2018 Sam Spilsbury.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <glib-object.h>
+
+#include <scortch/scortch-dtype.h>
+#include <scortch/scortch-dtype-internal.h>
+#include <scortch/scortch-errors.h>
+
+namespace
+{
+  GEnumValue const dtype_values[] = {
+    { SCORTCH_DTYPE_FLOAT64, "SCORTCH_DTYPE_FLOAT64", "float64" },
+    { SCORTCH_DTYPE_INT64, "SCORTCH_DTYPE_INT64", "int64" },
+    { SCORTCH_DTYPE_FLOAT32, "SCORTCH_DTYPE_FLOAT32", "float32" },
+    { SCORTCH_DTYPE_FLOAT16, "SCORTCH_DTYPE_FLOAT16", "float16" },
+    { SCORTCH_DTYPE_BFLOAT16, "SCORTCH_DTYPE_BFLOAT16", "bfloat16" },
+    { SCORTCH_DTYPE_INT32, "SCORTCH_DTYPE_INT32", "int32" },
+    { SCORTCH_DTYPE_UINT8, "SCORTCH_DTYPE_UINT8", "uint8" },
+    { SCORTCH_DTYPE_BOOL, "SCORTCH_DTYPE_BOOL", "bool" },
+    { 0, nullptr, nullptr }
+  };
+}
+
+GType
+scortch_dtype_get_type (void)
+{
+  static gsize dtype_type = 0;
+
+  if (g_once_init_enter (&dtype_type))
+    {
+      GType type = g_enum_register_static (g_intern_static_string ("ScortchDType"), dtype_values);
+
+      g_once_init_leave (&dtype_type, type);
+    }
+
+  return dtype_type;
+}
+
+at::ScalarType
+scortch_dtype_to_scalar_type (ScortchDType dtype)
+{
+  switch (dtype)
+    {
+      case SCORTCH_DTYPE_FLOAT64:
+        return torch::kFloat64;
+      case SCORTCH_DTYPE_INT64:
+        return torch::kInt64;
+      case SCORTCH_DTYPE_FLOAT32:
+        return torch::kFloat32;
+      case SCORTCH_DTYPE_FLOAT16:
+        return torch::kFloat16;
+      case SCORTCH_DTYPE_BFLOAT16:
+        return torch::kBFloat16;
+      case SCORTCH_DTYPE_INT32:
+        return torch::kInt32;
+      case SCORTCH_DTYPE_UINT8:
+        return torch::kUInt8;
+      case SCORTCH_DTYPE_BOOL:
+        return torch::kBool;
+      default:
+        g_assert_not_reached ();
+    }
+
+  return torch::kFloat64;
+}
+
+bool
+scortch_dtype_check (ScortchDType   dtype,
+                     GError       **error)
+{
+  for (GEnumValue const *value = dtype_values; value->value_name != nullptr; ++value)
+    {
+      if (value->value == dtype)
+        return true;
+    }
+
+  g_set_error (error,
+               SCORTCH_ERROR,
+               SCORTCH_ERROR_INVALID_DATA_TYPE,
+               "%d is not a valid ScortchDType",
+               static_cast <int> (dtype));
+  return false;
+}
+
+bool
+scortch_dtype_from_scalar_type (at::ScalarType  scalar_type,
+                                ScortchDType   *out_dtype)
+{
+  switch (scalar_type)
+    {
+      case torch::kFloat64:
+        *out_dtype = SCORTCH_DTYPE_FLOAT64;
+        return true;
+      case torch::kInt64:
+        *out_dtype = SCORTCH_DTYPE_INT64;
+        return true;
+      case torch::kFloat32:
+        *out_dtype = SCORTCH_DTYPE_FLOAT32;
+        return true;
+      case torch::kFloat16:
+        *out_dtype = SCORTCH_DTYPE_FLOAT16;
+        return true;
+      case torch::kBFloat16:
+        *out_dtype = SCORTCH_DTYPE_BFLOAT16;
+        return true;
+      case torch::kInt32:
+        *out_dtype = SCORTCH_DTYPE_INT32;
+        return true;
+      case torch::kUInt8:
+        *out_dtype = SCORTCH_DTYPE_UINT8;
+        return true;
+      case torch::kBool:
+        *out_dtype = SCORTCH_DTYPE_BOOL;
+        return true;
+      default:
+        return false;
+    }
+}
+
+char const *
+scortch_dtype_to_nick (ScortchDType dtype)
+{
+  for (GEnumValue const *value = dtype_values; value->value_name != nullptr; ++value)
+    {
+      if (value->value == dtype)
+        return value->value_nick;
+    }
+
+  g_assert_not_reached ();
+  return nullptr;
+}
+
+bool
+scortch_dtype_from_nick (char const   *nick,
+                         ScortchDType *out_dtype)
+{
+  for (GEnumValue const *value = dtype_values; value->value_name != nullptr; ++value)
+    {
+      if (g_strcmp0 (value->value_nick, nick) == 0)
+        {
+          *out_dtype = static_cast <ScortchDType> (value->value);
+          return true;
+        }
+    }
+
+  return false;
+}
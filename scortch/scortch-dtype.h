@@ -0,0 +1,61 @@
+/*
+ * /scortch/scortch-dtype.h
+ *
+ * Element types that tensors in scortch can hold.
+ *
+ * Copyright (C) 2018 Sam Spilsbury.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <glib.h>
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+/**
+ * ScortchDType:
+ * @SCORTCH_DTYPE_FLOAT64: 64-bit floating point elements.
+ * @SCORTCH_DTYPE_INT64: 64-bit signed integer elements.
+ * @SCORTCH_DTYPE_FLOAT32: 32-bit floating point elements.
+ * @SCORTCH_DTYPE_FLOAT16: 16-bit IEEE 754 half precision elements.
+ * @SCORTCH_DTYPE_BFLOAT16: 16-bit brain floating point elements.
+ * @SCORTCH_DTYPE_INT32: 32-bit signed integer elements.
+ * @SCORTCH_DTYPE_UINT8: 8-bit unsigned integer elements.
+ * @SCORTCH_DTYPE_BOOL: Boolean elements, stored as one byte each.
+ *
+ * Enumeration of the element types a #ScortchLocalTensor can hold.
+ *
+ * Element types that GVariant cannot represent natively (float32,
+ * float16 and bfloat16) are transported in tensor data as a "(say)"
+ * tuple of the dtype nickname and the raw bytes of the row.
+ */
+typedef enum {
+  SCORTCH_DTYPE_FLOAT64,
+  SCORTCH_DTYPE_INT64,
+  SCORTCH_DTYPE_FLOAT32,
+  SCORTCH_DTYPE_FLOAT16,
+  SCORTCH_DTYPE_BFLOAT16,
+  SCORTCH_DTYPE_INT32,
+  SCORTCH_DTYPE_UINT8,
+  SCORTCH_DTYPE_BOOL
+} ScortchDType;
+
+#define SCORTCH_TYPE_DTYPE scortch_dtype_get_type ()
+GType scortch_dtype_get_type (void);
+
+G_END_DECLS
@@ -30,12 +30,22 @@ G_BEGIN_DECLS
  * ScortchError
  * @SCORTCH_ERROR_INTERNAL: Internal error occurred in Scortch or PyTorch.
  * @SCORTCH_ERROR_INVALID_DATA_TYPE: The data type chosen is not supported.
+ * @SCORTCH_ERROR_INVALID_DIMENSIONS: The dimensions do not match the data.
+ * @SCORTCH_ERROR_MALFORMED_DATA: The nested data is ragged or mixes leaf types.
+ * @SCORTCH_ERROR_INVALID_OPERATION: PyTorch rejected a tensor operation, for
+ *   instance because the shapes of its operands do not match.
+ * @SCORTCH_ERROR_INVALID_MODULE: A serialized TorchScript module could
+ *   not be loaded.
  *
  * Error enumeration for Scorch related errors.
  */
 typedef enum {
   SCORTCH_ERROR_INTERNAL,
-  SCORTCH_ERROR_INVALID_DATA_TYPE
+  SCORTCH_ERROR_INVALID_DATA_TYPE,
+  SCORTCH_ERROR_INVALID_DIMENSIONS,
+  SCORTCH_ERROR_MALFORMED_DATA,
+  SCORTCH_ERROR_INVALID_OPERATION,
+  SCORTCH_ERROR_INVALID_MODULE
 } ScortchError;
 
 #define SCORTCH_ERROR scortch_error_quark ()
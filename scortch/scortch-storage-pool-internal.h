@@ -0,0 +1,34 @@
+/*
+ * /scortch/scortch-storage-pool-internal.h
+ *
+ * Allocating tensors from the storage pool.
+ *
+ * Copyright (C) 2018 Sam Spilsbury.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <torch/torch.h>
+
+#include <scortch/scortch-storage-pool.h>
+
+/* Like torch::empty, but takes the storage from the pool if it
+ * is enabled. The storage goes back to the pool once the last
+ * tensor referencing it is destroyed. Storage from the pool
+ * cannot be resized in place. */
+torch::Tensor scortch_storage_pool_empty (torch::IntArrayRef dimensions,
+                                          at::ScalarType     scalar_type);
@@ -0,0 +1,328 @@
+/*
+ * /scortch/scortch-storage-pool.cpp
+ *
+ * Opt-in pool recycling the storage of short-lived tensors.
+ * C++ source file.
+ *
+ * Copyright (C) 2018 Sam Spilsbury.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <atomic>
+#include <cstdlib>
+#include <iterator>
+#include <unordered_map>
+#include <vector>
+
+#include <glib.h>
+
+#include <torch/torch.h>
+
+#include <scortch/scortch-storage-pool.h>
+#include <scortch/scortch-storage-pool-internal.h>
+
+namespace
+{
+  /* Every block is aligned to a cache line, which satisfies the
+   * alignment of every element type and of vectorized kernels,
+   * so blocks only need to be told apart by their size. */
+  constexpr size_t block_alignment = 64;
+  constexpr guint64 default_max_bytes = 256 * 1024 * 1024;
+
+  GMutex pool_mutex;
+  std::atomic <bool> pool_enabled (false);
+  guint64 pool_max_bytes = default_max_bytes;
+  guint64 pool_cached_bytes = 0;
+  guint64 pool_hits = 0;
+  guint64 pool_misses = 0;
+  std::unordered_map <size_t, std::vector <void *>> free_blocks;
+
+  /* Returns false if the tensor or its rounded up block size
+   * does not fit in a size_t. */
+  bool block_size_for (torch::IntArrayRef  dimensions,
+                       at::ScalarType      scalar_type,
+                       size_t             &n_bytes,
+                       size_t             &block_size)
+  {
+    n_bytes = c10::elementSize (scalar_type);
+
+    for (int64_t dimension : dimensions)
+      {
+        if (dimension < 0 ||
+            __builtin_mul_overflow (n_bytes, static_cast <size_t> (dimension), &n_bytes))
+          return false;
+      }
+
+    if (__builtin_add_overflow (n_bytes, block_alignment - 1, &block_size))
+      return false;
+
+    block_size &= ~(block_alignment - 1);
+    return true;
+  }
+
+  /* Returns nullptr if the system allocator fails, in which
+   * case the caller falls back to torch::empty so that the
+   * failure is reported as a c10::Error like any other. */
+  void * allocate_block (size_t block_size)
+  {
+    void *block = nullptr;
+
+    if (posix_memalign (&block, block_alignment, block_size) != 0)
+      return nullptr;
+
+    return block;
+  }
+
+  /* Must be called with pool_mutex held. Frees cached blocks
+   * until no more than max_bytes are cached. */
+  void trim_to_unlocked (guint64 max_bytes)
+  {
+    for (auto it = free_blocks.begin ();
+         it != free_blocks.end () && pool_cached_bytes > max_bytes;)
+      {
+        std::vector <void *> &blocks = it->second;
+
+        while (!blocks.empty () && pool_cached_bytes > max_bytes)
+          {
+            free (blocks.back ());
+            blocks.pop_back ();
+            pool_cached_bytes -= it->first;
+          }
+
+        it = blocks.empty () ? free_blocks.erase (it) : std::next (it);
+      }
+  }
+
+  void * take_block (size_t block_size)
+  {
+    g_mutex_lock (&pool_mutex);
+
+    auto it = free_blocks.find (block_size);
+    void *block = nullptr;
+
+    if (it != free_blocks.end () && !it->second.empty ())
+      {
+        block = it->second.back ();
+        it->second.pop_back ();
+        pool_cached_bytes -= block_size;
+        ++pool_hits;
+      }
+    else
+      {
+        ++pool_misses;
+      }
+
+    g_mutex_unlock (&pool_mutex);
+
+    return block != nullptr ? block : allocate_block (block_size);
+  }
+
+  /* Blocks outlive the setting they were allocated under, so
+   * a block released after the pool was disabled or shrunk
+   * below its size is freed instead. */
+  void release_block (void *block, size_t block_size)
+  {
+    g_mutex_lock (&pool_mutex);
+
+    if (pool_enabled.load () && pool_cached_bytes + block_size <= pool_max_bytes)
+      {
+        free_blocks[block_size].push_back (block);
+        pool_cached_bytes += block_size;
+        block = nullptr;
+      }
+
+    g_mutex_unlock (&pool_mutex);
+
+    free (block);
+  }
+}
+
+torch::Tensor
+scortch_storage_pool_empty (torch::IntArrayRef dimensions,
+                            at::ScalarType     scalar_type)
+{
+  torch::TensorOptions options (torch::TensorOptions ().dtype (scalar_type));
+  size_t n_bytes;
+  size_t block_size;
+
+  /* Invalid or overflowing dimensions are left for torch::empty
+   * to reject with a c10::Error. */
+  if (!pool_enabled.load (std::memory_order_relaxed) ||
+      !block_size_for (dimensions, scalar_type, n_bytes, block_size) ||
+      n_bytes == 0)
+    return torch::empty (dimensions, options);
+
+  void *block = take_block (block_size);
+
+  if (block == nullptr)
+    return torch::empty (dimensions, options);
+
+  return torch::from_blob (block,
+                           dimensions,
+                           [block_size](void *block) {
+                             release_block (block, block_size);
+                           },
+                           options);
+}
+
+/**
+ * scortch_storage_pool_set_enabled:
+ * @enabled: Whether to recycle tensor storage.
+ *
+ * Enable or disable the process-wide storage pool. While it is
+ * enabled, the storage of tensors that scortch allocates itself,
+ * for instance when constructing a #ScortchLocalTensor or setting
+ * its data, is returned to the pool when the last tensor using it
+ * is finalized, and handed out again to the next tensor of the
+ * same size in bytes. This avoids going back to the system
+ * allocator, and faulting in fresh pages, when many tensors of
+ * the same shape are created and dropped in quick succession.
+ *
+ * The pool holds at most %scortch_storage_pool_get_max_bytes
+ * bytes of unused storage. Disabling the pool frees everything
+ * it holds. The pool is disabled by default.
+ */
+void
+scortch_storage_pool_set_enabled (gboolean enabled)
+{
+  g_mutex_lock (&pool_mutex);
+
+  pool_enabled.store (enabled);
+
+  if (!enabled)
+    trim_to_unlocked (0);
+
+  g_mutex_unlock (&pool_mutex);
+}
+
+/**
+ * scortch_storage_pool_get_enabled:
+ *
+ * Check whether the storage pool is enabled.
+ *
+ * Returns: %TRUE if tensor storage is recycled through the pool.
+ */
+gboolean
+scortch_storage_pool_get_enabled (void)
+{
+  return pool_enabled.load ();
+}
+
+/**
+ * scortch_storage_pool_set_max_bytes:
+ * @max_bytes: The maximum number of bytes of unused storage to keep.
+ *
+ * Set the maximum number of bytes of unused storage the pool
+ * keeps for reuse. Storage released while the pool is full is
+ * freed. If the pool currently holds more than @max_bytes, the
+ * excess is freed right away. The default is 256 MiB.
+ */
+void
+scortch_storage_pool_set_max_bytes (guint64 max_bytes)
+{
+  g_mutex_lock (&pool_mutex);
+
+  pool_max_bytes = max_bytes;
+  trim_to_unlocked (max_bytes);
+
+  g_mutex_unlock (&pool_mutex);
+}
+
+/**
+ * scortch_storage_pool_get_max_bytes:
+ *
+ * Get the maximum number of bytes of unused storage the pool keeps.
+ *
+ * Returns: The maximum number of bytes kept by the pool.
+ */
+guint64
+scortch_storage_pool_get_max_bytes (void)
+{
+  g_mutex_lock (&pool_mutex);
+  guint64 max_bytes = pool_max_bytes;
+  g_mutex_unlock (&pool_mutex);
+
+  return max_bytes;
+}
+
+/**
+ * scortch_storage_pool_get_hits:
+ *
+ * Get the number of allocations that were served with storage
+ * from the pool since the process started.
+ *
+ * Returns: The number of pool hits.
+ */
+guint64
+scortch_storage_pool_get_hits (void)
+{
+  g_mutex_lock (&pool_mutex);
+  guint64 hits = pool_hits;
+  g_mutex_unlock (&pool_mutex);
+
+  return hits;
+}
+
+/**
+ * scortch_storage_pool_get_misses:
+ *
+ * Get the number of allocations made while the pool was enabled
+ * that found no storage of the right size in the pool and went
+ * to the system allocator, since the process started.
+ *
+ * Returns: The number of pool misses.
+ */
+guint64
+scortch_storage_pool_get_misses (void)
+{
+  g_mutex_lock (&pool_mutex);
+  guint64 misses = pool_misses;
+  g_mutex_unlock (&pool_mutex);
+
+  return misses;
+}
+
+/**
+ * scortch_storage_pool_get_cached_bytes:
+ *
+ * Get the number of bytes of unused storage currently held by
+ * the pool.
+ *
+ * Returns: The number of bytes held by the pool.
+ */
+guint64
+scortch_storage_pool_get_cached_bytes (void)
+{
+  g_mutex_lock (&pool_mutex);
+  guint64 cached_bytes = pool_cached_bytes;
+  g_mutex_unlock (&pool_mutex);
+
+  return cached_bytes;
+}
+
+/**
+ * scortch_storage_pool_trim:
+ *
+ * Free all unused storage held by the pool, for instance after
+ * a burst of allocations is over. The pool stays enabled.
+ */
+void
+scortch_storage_pool_trim (void)
+{
+  g_mutex_lock (&pool_mutex);
+  trim_to_unlocked (0);
+  g_mutex_unlock (&pool_mutex);
+}
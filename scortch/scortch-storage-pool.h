@@ -0,0 +1,41 @@
+/*
+ * /scortch/scortch-storage-pool.h
+ *
+ * Opt-in pool recycling the storage of short-lived tensors.
+ *
+ * Copyright (C) 2018 Sam Spilsbury.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+void scortch_storage_pool_set_enabled (gboolean enabled);
+gboolean scortch_storage_pool_get_enabled (void);
+
+void scortch_storage_pool_set_max_bytes (guint64 max_bytes);
+guint64 scortch_storage_pool_get_max_bytes (void);
+
+guint64 scortch_storage_pool_get_hits (void);
+guint64 scortch_storage_pool_get_misses (void);
+guint64 scortch_storage_pool_get_cached_bytes (void);
+
+void scortch_storage_pool_trim (void);
+
+G_END_DECLS
@@ -0,0 +1,108 @@
+/*
+ * /scortch/scortch-tracing-internal.h
+ *
+ * Trace scopes for instrumenting scortch hot paths.
+ *
+ * Copyright (C) 2018 Sam Spilsbury.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include <glib.h>
+
+#include <scortch/scortch-tracing.h>
+
+enum ScortchTracingState
+{
+  SCORTCH_TRACING_STATE_UNINITIALIZED,
+  SCORTCH_TRACING_STATE_DISABLED,
+  SCORTCH_TRACING_STATE_ENABLED
+};
+
+extern std::atomic <int> scortch_tracing_state;
+
+/* Enable tracing if the SCORTCH_TRACE environment variable is
+ * set, the first time anything is traced. */
+void scortch_tracing_init_from_environment ();
+
+/* Add a finished span to the counters for name and, if a trace
+ * file is open, write it out as a trace event. */
+void scortch_tracing_record (char const *name,
+                             int64_t     start_ns,
+                             int64_t     end_ns,
+                             size_t      bytes);
+
+/* A single relaxed load once initialized, so that trace
+ * scopes cost next to nothing when tracing is disabled. */
+inline bool
+scortch_tracing_is_active ()
+{
+  int state = scortch_tracing_state.load (std::memory_order_relaxed);
+
+  if (G_UNLIKELY (state == SCORTCH_TRACING_STATE_UNINITIALIZED))
+    {
+      scortch_tracing_init_from_environment ();
+      state = scortch_tracing_state.load (std::memory_order_relaxed);
+    }
+
+  return state == SCORTCH_TRACING_STATE_ENABLED;
+}
+
+inline int64_t
+scortch_tracing_now_ns ()
+{
+  auto now = std::chrono::steady_clock::now ().time_since_epoch ();
+  return std::chrono::duration_cast <std::chrono::nanoseconds> (now).count ();
+}
+
+/* Times the enclosing block as a span called name, which must
+ * be a string literal. Bytes copied within the block can be
+ * attributed to the span with add_bytes. */
+class ScortchTraceScope
+{
+public:
+  explicit ScortchTraceScope (char const *name) :
+    name (name),
+    start_ns (scortch_tracing_is_active () ? scortch_tracing_now_ns () : -1),
+    bytes (0)
+  {
+  }
+
+  ~ScortchTraceScope ()
+  {
+    if (start_ns >= 0)
+      scortch_tracing_record (name, start_ns, scortch_tracing_now_ns (), bytes);
+  }
+
+  ScortchTraceScope (ScortchTraceScope const &) = delete;
+  ScortchTraceScope & operator= (ScortchTraceScope const &) = delete;
+
+  void add_bytes (size_t n_bytes)
+  {
+    bytes += n_bytes;
+  }
+
+private:
+  char const *name;
+  int64_t     start_ns;
+  size_t      bytes;
+};
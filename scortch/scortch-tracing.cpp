@@ -0,0 +1,292 @@
+/*
+ * /scortch/scortch-tracing.cpp
+ *
+ * Opt-in tracing and timing of scortch hot paths. C++ source file.
+ *
+ * Copyright (C) 2018 Sam Spilsbury.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+
+#include <glib.h>
+#include <unistd.h>
+
+#include <scortch/scortch-tracing.h>
+#include <scortch/scortch-tracing-internal.h>
+
+std::atomic <int> scortch_tracing_state (SCORTCH_TRACING_STATE_UNINITIALIZED);
+
+namespace
+{
+  struct Counter
+  {
+    guint64 calls = 0;
+    guint64 bytes = 0;
+    guint64 nanoseconds = 0;
+  };
+
+  GMutex tracing_mutex;
+  std::map <std::string, Counter> counters;
+  FILE *trace_file = nullptr;
+  bool trace_file_has_events = false;
+
+  /* Small, stable ids for threads in the trace, which are
+   * easier to read than pthread handles. */
+  unsigned int current_thread_trace_id ()
+  {
+    static std::atomic <unsigned int> next_thread_trace_id (1);
+    thread_local unsigned int thread_trace_id = next_thread_trace_id++;
+
+    return thread_trace_id;
+  }
+
+  /* Must be called with tracing_mutex held */
+  void close_trace_file_unlocked ()
+  {
+    if (trace_file == nullptr)
+      return;
+
+    fputs ("\n]\n", trace_file);
+    fclose (trace_file);
+    trace_file = nullptr;
+  }
+
+  /* Must be called with tracing_mutex held. The file is a
+   * Chrome trace-event JSON array, which chrome://tracing,
+   * Perfetto and speedscope can all load. The previous file is
+   * closed first, since it might be the same path, and opening
+   * it again would truncate it under the old FILE. */
+  bool open_trace_file_unlocked (char const  *path,
+                                 GError     **error)
+  {
+    close_trace_file_unlocked ();
+
+    FILE *file = fopen (path, "w");
+
+    if (file == nullptr)
+      {
+        int saved_errno = errno;
+
+        g_set_error (error,
+                     G_FILE_ERROR,
+                     g_file_error_from_errno (saved_errno),
+                     "Could not open trace file %s: %s",
+                     path,
+                     g_strerror (saved_errno));
+        return false;
+      }
+
+    fputs ("[\n", file);
+    trace_file = file;
+    trace_file_has_events = false;
+
+    return true;
+  }
+}
+
+void
+scortch_tracing_init_from_environment ()
+{
+  int expected = SCORTCH_TRACING_STATE_UNINITIALIZED;
+
+  g_mutex_lock (&tracing_mutex);
+
+  /* Tracing might have been enabled or disabled explicitly
+   * while we were waiting for the lock. */
+  if (scortch_tracing_state.load () != expected)
+    {
+      g_mutex_unlock (&tracing_mutex);
+      return;
+    }
+
+  char const *trace = g_getenv ("SCORTCH_TRACE");
+  int state = SCORTCH_TRACING_STATE_DISABLED;
+
+  if (trace != nullptr && *trace != '\0')
+    {
+      g_autoptr(GError) error = nullptr;
+
+      state = SCORTCH_TRACING_STATE_ENABLED;
+
+      if (g_strcmp0 (trace, "1") != 0 &&
+          !open_trace_file_unlocked (trace, &error))
+        g_warning ("SCORTCH_TRACE: %s, only keeping counters", error->message);
+    }
+
+  scortch_tracing_state.store (state);
+  g_mutex_unlock (&tracing_mutex);
+}
+
+void
+scortch_tracing_record (char const *name,
+                        int64_t     start_ns,
+                        int64_t     end_ns,
+                        size_t      bytes)
+{
+  g_mutex_lock (&tracing_mutex);
+
+  Counter &counter = counters[name];
+  ++counter.calls;
+  counter.bytes += bytes;
+  counter.nanoseconds += end_ns - start_ns;
+
+  if (trace_file != nullptr)
+    {
+      fprintf (trace_file,
+               "%s{\"name\": \"%s\", \"cat\": \"scortch\", \"ph\": \"X\", "
+               "\"ts\": %.3f, \"dur\": %.3f, \"pid\": %d, \"tid\": %u, "
+               "\"args\": {\"bytes\": %" G_GSIZE_FORMAT "}}",
+               trace_file_has_events ? ",\n" : "",
+               name,
+               start_ns / 1000.0,
+               (end_ns - start_ns) / 1000.0,
+               static_cast <int> (getpid ()),
+               current_thread_trace_id (),
+               bytes);
+      trace_file_has_events = true;
+    }
+
+  g_mutex_unlock (&tracing_mutex);
+}
+
+/**
+ * scortch_tracing_enable:
+ * @trace_file_path: (type filename) (nullable): Path of a file to
+ *                   write trace events to, or %NULL to only keep
+ *                   counters.
+ * @error: A #GError.
+ *
+ * Start timing conversions between #GVariant data and tensors,
+ * and operations that run PyTorch kernels, in this process. The
+ * number of calls, bytes copied and nanoseconds spent in each
+ * is accumulated and can be read with
+ * %scortch_tracing_get_counters.
+ *
+ * If @trace_file_path is not %NULL, every call is also written
+ * to it as a Chrome trace-event JSON array, replacing any trace
+ * file that was open before. The previous file is closed even if
+ * @trace_file_path cannot be opened. The array is terminated when
+ * tracing is disabled, though trace viewers also accept files
+ * that were cut off when the process exited.
+ *
+ * Tracing can also be enabled without changing the program by
+ * setting the SCORTCH_TRACE environment variable to either a
+ * trace file path or to 1 to only keep counters.
+ *
+ * Returns: %TRUE if tracing was enabled, or %FALSE with @error
+ *          set if the trace file could not be opened.
+ */
+gboolean
+scortch_tracing_enable (const char  *trace_file_path,
+                        GError     **error)
+{
+  g_mutex_lock (&tracing_mutex);
+
+  if (trace_file_path != nullptr &&
+      !open_trace_file_unlocked (trace_file_path, error))
+    {
+      g_mutex_unlock (&tracing_mutex);
+      return FALSE;
+    }
+
+  scortch_tracing_state.store (SCORTCH_TRACING_STATE_ENABLED);
+  g_mutex_unlock (&tracing_mutex);
+
+  return TRUE;
+}
+
+/**
+ * scortch_tracing_disable:
+ *
+ * Stop tracing and close the trace file, if any. Counters are
+ * kept until %scortch_tracing_reset_counters is called.
+ */
+void
+scortch_tracing_disable (void)
+{
+  g_mutex_lock (&tracing_mutex);
+
+  scortch_tracing_state.store (SCORTCH_TRACING_STATE_DISABLED);
+  close_trace_file_unlocked ();
+
+  g_mutex_unlock (&tracing_mutex);
+}
+
+/**
+ * scortch_tracing_is_enabled:
+ *
+ * Check whether scortch is currently tracing, either because
+ * %scortch_tracing_enable was called or because the SCORTCH_TRACE
+ * environment variable is set.
+ *
+ * Returns: %TRUE if tracing is enabled.
+ */
+gboolean
+scortch_tracing_is_enabled (void)
+{
+  return scortch_tracing_is_active ();
+}
+
+/**
+ * scortch_tracing_get_counters:
+ *
+ * Get the counters accumulated since tracing was first enabled
+ * or the counters were last reset, keyed by the name of the
+ * traced span, such as "set-data-fill" or "torch-compute". Each
+ * value is a tuple of the number of calls, the number of bytes
+ * copied and the total time spent in nanoseconds. Spans nest,
+ * so the time of a span includes the time of any spans it
+ * contains.
+ *
+ * Returns: (transfer full): A #GVariant of type "a{s(ttt)}".
+ */
+GVariant *
+scortch_tracing_get_counters (void)
+{
+  g_auto(GVariantBuilder) builder = G_VARIANT_BUILDER_INIT (G_VARIANT_TYPE ("a{s(ttt)}"));
+
+  g_mutex_lock (&tracing_mutex);
+
+  for (auto const &entry : counters)
+    g_variant_builder_add (&builder,
+                           "{s(ttt)}",
+                           entry.first.c_str (),
+                           entry.second.calls,
+                           entry.second.bytes,
+                           entry.second.nanoseconds);
+
+  g_mutex_unlock (&tracing_mutex);
+
+  return g_variant_ref_sink (g_variant_builder_end (&builder));
+}
+
+/**
+ * scortch_tracing_reset_counters:
+ *
+ * Reset all counters to zero.
+ */
+void
+scortch_tracing_reset_counters (void)
+{
+  g_mutex_lock (&tracing_mutex);
+  counters.clear ();
+  g_mutex_unlock (&tracing_mutex);
+}
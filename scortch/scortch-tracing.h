@@ -0,0 +1,37 @@
+/*
+ * /scortch/scortch-tracing.h
+ *
+ * Opt-in tracing and timing of scortch hot paths.
+ *
+ * Copyright (C) 2018 Sam Spilsbury.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+gboolean scortch_tracing_enable (const char  *trace_file_path,
+                                 GError     **error);
+void scortch_tracing_disable (void);
+gboolean scortch_tracing_is_enabled (void);
+
+GVariant * scortch_tracing_get_counters (void);
+void scortch_tracing_reset_counters (void);
+
+G_END_DECLS
@@ -0,0 +1,35 @@
+/*
+ * /scortch/scortch-worker-pool-internal.h
+ *
+ * Private functions to run GTasks on the scortch worker pool.
+ *
+ * Copyright (C) 2018 Sam Spilsbury.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+#include <scortch/scortch-worker-pool.h>
+
+/* Run task_func for task on the scortch worker pool, like
+ * g_task_run_in_thread. The pool holds a reference on task
+ * until task_func has run. If the cancellable of task is
+ * cancelled before task_func starts, task returns
+ * G_IO_ERROR_CANCELLED and task_func is not called. */
+void scortch_worker_pool_run_task (GTask           *task,
+                                   GTaskThreadFunc  task_func);
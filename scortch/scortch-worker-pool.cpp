@@ -0,0 +1,132 @@
+/*
+ * /scortch/scortch-worker-pool.cpp
+ *
+ * Bounded pool of threads running asynchronous scortch operations.
+ *
+ * Copyright (C) 2018 Sam Spilsbury.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <gio/gio.h>
+#include <glib.h>
+
+#include <scortch/scortch-worker-pool.h>
+#include <scortch/scortch-worker-pool-internal.h>
+
+namespace
+{
+  struct WorkItem
+  {
+    WorkItem (GTask *task, GTaskThreadFunc task_func) :
+      task (G_TASK (g_object_ref (task))),
+      task_func (task_func)
+    {
+    }
+
+    ~WorkItem ()
+    {
+      g_object_unref (task);
+    }
+
+    GTask           *task;
+    GTaskThreadFunc  task_func;
+  };
+
+  GMutex pool_mutex;
+  GThreadPool *pool = nullptr;
+  guint pool_max_threads = 0;
+
+  void run_work_item (gpointer data, gpointer user_data G_GNUC_UNUSED)
+  {
+    WorkItem *item = static_cast <WorkItem *> (data);
+
+    if (!g_task_return_error_if_cancelled (item->task))
+      item->task_func (item->task,
+                       g_task_get_source_object (item->task),
+                       g_task_get_task_data (item->task),
+                       g_task_get_cancellable (item->task));
+
+    delete item;
+  }
+
+  /* Must be called with pool_mutex held */
+  GThreadPool * get_pool_unlocked ()
+  {
+    if (pool_max_threads == 0)
+      pool_max_threads = g_get_num_processors ();
+
+    if (pool == nullptr)
+      pool = g_thread_pool_new (run_work_item,
+                                nullptr,
+                                pool_max_threads,
+                                FALSE,
+                                nullptr);
+
+    return pool;
+  }
+}
+
+/**
+ * scortch_worker_pool_set_max_threads:
+ * @max_threads: The maximum number of threads, which must be at least 1.
+ *
+ * Set the maximum number of threads that asynchronous scortch operations,
+ * such as %scortch_local_tensor_set_data_async, run on concurrently.
+ * This pool is separate from the one GLib uses for g_task_run_in_thread,
+ * so long-running tensor operations do not starve other asynchronous
+ * I/O in the process. By default, there is one thread per processor.
+ */
+void
+scortch_worker_pool_set_max_threads (guint max_threads)
+{
+  g_return_if_fail (max_threads > 0);
+
+  g_mutex_lock (&pool_mutex);
+
+  pool_max_threads = max_threads;
+
+  if (pool != nullptr)
+    g_thread_pool_set_max_threads (pool, max_threads, nullptr);
+
+  g_mutex_unlock (&pool_mutex);
+}
+
+/**
+ * scortch_worker_pool_get_max_threads:
+ *
+ * Get the maximum number of threads that asynchronous scortch
+ * operations run on concurrently.
+ *
+ * Returns: The maximum number of threads in the worker pool.
+ */
+guint
+scortch_worker_pool_get_max_threads (void)
+{
+  g_mutex_lock (&pool_mutex);
+  guint max_threads = g_thread_pool_get_max_threads (get_pool_unlocked ());
+  g_mutex_unlock (&pool_mutex);
+
+  return max_threads;
+}
+
+void
+scortch_worker_pool_run_task (GTask           *task,
+                              GTaskThreadFunc  task_func)
+{
+  g_mutex_lock (&pool_mutex);
+  g_thread_pool_push (get_pool_unlocked (), new WorkItem (task, task_func), nullptr);
+  g_mutex_unlock (&pool_mutex);
+}
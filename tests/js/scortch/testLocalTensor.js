@@ -54,4 +54,49 @@ describe('ScortchLocalTensor', function() {
 
     expect(local_tensor.data.deep_unpack()).toEqual([1, 2]);
   });
+
+  it('can be constructed from bytes without copying', function() {
+    let values = new Float64Array([1, 2, 3, 4]);
+    let local_tensor = Scortch.LocalTensor.new_from_bytes(new GLib.Bytes(new Uint8Array(values.buffer)),
+                                                          new GLib.Variant('ax', [2, 2]),
+                                                          Scortch.DType.FLOAT64);
+
+    expect(local_tensor.dimensions.deep_unpack()).toEqual([2, 2]);
+    expect(Array.from(new Float64Array(local_tensor.get_bytes().toArray().buffer))).toEqual([1, 2, 3, 4]);
+  });
+
+  it('keeps the dtype it was constructed with', function() {
+    let local_tensor = new Scortch.LocalTensor({
+      dtype: Scortch.DType.FLOAT32,
+      data: new GLib.Variant('av', [new GLib.Variant('ad', [1, 2])])
+    });
+
+    expect(local_tensor.dtype).toEqual(Scortch.DType.FLOAT32);
+    expect(Array.from(new Float32Array(local_tensor.get_bytes().toArray().buffer))).toEqual([1, 2]);
+  });
+
+  it('can have data set asynchronously', function(done) {
+    let local_tensor = new Scortch.LocalTensor({});
+
+    local_tensor.set_data_async(new GLib.Variant('av', [new GLib.Variant('ax', [1, 2])]),
+                                null,
+                                (obj, result) => {
+      expect(local_tensor.set_data_finish(result)).toBe(true);
+      expect(local_tensor.data.deep_unpack()).toEqual([1, 2]);
+      done();
+    });
+  });
+
+  it('can have rows appended', function() {
+    let local_tensor = new Scortch.LocalTensor({
+      dimensions: new GLib.Variant('ax', [0, 2])
+    });
+
+    local_tensor.reserve(4);
+    local_tensor.append_rows_from_bytes(new GLib.Bytes(new Uint8Array(new Float64Array([1, 2, 3, 4]).buffer)));
+
+    expect(local_tensor.dimensions.deep_unpack()).toEqual([2, 2]);
+    expect(local_tensor.get_capacity()).toEqual(4);
+    expect(Array.from(new Float64Array(local_tensor.get_bytes().toArray().buffer))).toEqual([1, 2, 3, 4]);
+  });
 });
@@ -0,0 +1,224 @@
+/*
+ * /tests/scortch/batching-engine-test.cpp
+ *
+ * Tests for the batching inference engine.
+ *
+ * Copyright (C) 2018 Sam Spilsbury.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <gio/gio.h>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <scortch/batching-engine.h>
+#include <scortch/local-tensor.h>
+#include <scortch/module.h>
+#include <scortch/scortch-errors.h>
+
+#include <scortch/module-test-helpers.h>
+#include <scortch/tensor-test-helpers.h>
+
+using ::testing::DoubleEq;
+using ::testing::ElementsAre;
+using ::testing::IsNull;
+using ::testing::Not;
+
+using scortch_test::bytes_of;
+using scortch_test::dimensions_of;
+using scortch_test::tensor_from_values;
+
+using ScortchBatchingEngineTest = scortch_test::TemporaryModuleTest;
+
+namespace {
+  struct PendingRequest
+  {
+    ~PendingRequest ()
+    {
+      g_clear_object (&input);
+      g_clear_object (&result);
+    }
+
+    ScortchLocalTensor *input = nullptr;
+    GAsyncResult *result = nullptr;
+  };
+
+  void store_result (GObject      *source_object G_GNUC_UNUSED,
+                     GAsyncResult *result,
+                     gpointer      user_data)
+  {
+    static_cast <PendingRequest *> (user_data)->result = G_ASYNC_RESULT (g_object_ref (result));
+  }
+
+  void submit_requests (ScortchBatchingEngine *engine,
+                        PendingRequest        *requests,
+                        size_t                 n_requests)
+  {
+    for (size_t i = 0; i < n_requests; ++i)
+      {
+        double const value = i;
+        requests[i].input = tensor_from_values <double> ({ value, value },
+                                                         { 2 },
+                                                         SCORTCH_DTYPE_FLOAT64);
+        scortch_batching_engine_submit_async (engine,
+                                              requests[i].input,
+                                              nullptr,
+                                              store_result,
+                                              &requests[i]);
+      }
+  }
+
+  void wait_for_requests (PendingRequest *requests,
+                          size_t          n_requests)
+  {
+    for (size_t i = 0; i < n_requests; ++i)
+      while (requests[i].result == nullptr)
+        g_main_context_iteration (nullptr, TRUE);
+  }
+}
+
+TEST_F (ScortchBatchingEngineTest, full_batch_runs_in_one_forward_pass)
+{
+  g_autoptr(ScortchModule) module = scortch_module_new_from_file (path, nullptr);
+  ASSERT_THAT (module, Not (IsNull ()));
+
+  /* A long wait means only filling the batch can trigger it */
+  g_autoptr(ScortchBatchingEngine) engine = scortch_batching_engine_new (module, 4, G_USEC_PER_SEC * 60);
+  PendingRequest requests[4];
+
+  submit_requests (engine, requests, G_N_ELEMENTS (requests));
+  wait_for_requests (requests, G_N_ELEMENTS (requests));
+
+  for (size_t i = 0; i < G_N_ELEMENTS (requests); ++i)
+    {
+      g_autoptr(GError) error = nullptr;
+      g_autoptr(ScortchLocalTensor) output =
+        scortch_batching_engine_submit_finish (engine, requests[i].result, &error);
+
+      ASSERT_THAT (output, Not (IsNull ()));
+      EXPECT_THAT (dimensions_of (output), ElementsAre (2));
+      double const expected = i * 2.0 + 1.0;
+      EXPECT_THAT (bytes_of <double> (output), ElementsAre (expected, expected));
+    }
+
+  EXPECT_EQ (scortch_batching_engine_get_last_batch_size (engine), 4u);
+  EXPECT_THAT (scortch_batching_engine_get_mean_batch_size (engine), DoubleEq (4));
+  EXPECT_EQ (scortch_batching_engine_get_queue_depth (engine), 0u);
+}
+
+TEST_F (ScortchBatchingEngineTest, partial_batch_runs_after_max_wait)
+{
+  g_autoptr(ScortchModule) module = scortch_module_new_from_file (path, nullptr);
+  ASSERT_THAT (module, Not (IsNull ()));
+
+  g_autoptr(ScortchBatchingEngine) engine = scortch_batching_engine_new (module, 64, 1000);
+  PendingRequest requests[3];
+
+  submit_requests (engine, requests, G_N_ELEMENTS (requests));
+  wait_for_requests (requests, G_N_ELEMENTS (requests));
+
+  g_autoptr(ScortchLocalTensor) output =
+    scortch_batching_engine_submit_finish (engine, requests[2].result, nullptr);
+
+  EXPECT_THAT (bytes_of <double> (output), ElementsAre (5, 5));
+  EXPECT_LE (scortch_batching_engine_get_last_batch_size (engine), 3u);
+}
+
+TEST_F (ScortchBatchingEngineTest, reports_queue_depth_until_limit_is_lowered)
+{
+  g_autoptr(ScortchModule) module = scortch_module_new_from_file (path, nullptr);
+  ASSERT_THAT (module, Not (IsNull ()));
+
+  g_autoptr(ScortchBatchingEngine) engine = scortch_batching_engine_new (module, 64, G_USEC_PER_SEC * 60);
+  PendingRequest requests[2];
+
+  submit_requests (engine, requests, G_N_ELEMENTS (requests));
+  EXPECT_EQ (scortch_batching_engine_get_queue_depth (engine), 2u);
+
+  /* Lowering the batch size wakes the batcher up */
+  scortch_batching_engine_set_max_batch_size (engine, 2);
+  wait_for_requests (requests, G_N_ELEMENTS (requests));
+
+  EXPECT_EQ (scortch_batching_engine_get_queue_depth (engine), 0u);
+  EXPECT_EQ (scortch_batching_engine_get_last_batch_size (engine), 2u);
+}
+
+TEST_F (ScortchBatchingEngineTest, cancelled_request_is_dropped)
+{
+  g_autoptr(ScortchModule) module = scortch_module_new_from_file (path, nullptr);
+  ASSERT_THAT (module, Not (IsNull ()));
+
+  g_autoptr(ScortchBatchingEngine) engine = scortch_batching_engine_new (module, 2, G_USEC_PER_SEC * 60);
+  g_autoptr(GCancellable) cancellable = g_cancellable_new ();
+  g_autoptr(GError) error = nullptr;
+  PendingRequest cancelled;
+  PendingRequest requests[1];
+
+  cancelled.input = tensor_from_values <double> ({ 1, 1 }, { 2 }, SCORTCH_DTYPE_FLOAT64);
+  g_cancellable_cancel (cancellable);
+  scortch_batching_engine_submit_async (engine, cancelled.input, cancellable, store_result, &cancelled);
+  submit_requests (engine, requests, G_N_ELEMENTS (requests));
+
+  wait_for_requests (&cancelled, 1);
+  wait_for_requests (requests, G_N_ELEMENTS (requests));
+
+  g_autoptr(ScortchLocalTensor) output =
+    scortch_batching_engine_submit_finish (engine, cancelled.result, &error);
+
+  EXPECT_THAT (output, IsNull ());
+  EXPECT_TRUE (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED));
+  EXPECT_EQ (scortch_batching_engine_get_last_batch_size (engine), 1u);
+}
+
+TEST_F (ScortchBatchingEngineTest, engine_released_in_callback)
+{
+  g_autoptr(ScortchModule) module = scortch_module_new_from_file (path, nullptr);
+  ASSERT_THAT (module, Not (IsNull ()));
+
+  /* The callback drops the only reference held by the test, so the
+   * engine is finalized when the task releases it, which has to
+   * happen on this thread and not on the batching thread. */
+  ScortchBatchingEngine *engine = scortch_batching_engine_new (module, 1, 0);
+  g_autoptr(ScortchLocalTensor) input = tensor_from_values <double> ({ 1, 1 },
+                                                                     { 2 },
+                                                                     SCORTCH_DTYPE_FLOAT64);
+  bool called = false;
+
+  g_object_add_weak_pointer (G_OBJECT (engine), reinterpret_cast <gpointer *> (&engine));
+
+  struct ReleaseEngine
+  {
+    static void callback (GObject      *source_object,
+                          GAsyncResult *result,
+                          gpointer      user_data)
+    {
+      g_autoptr(ScortchLocalTensor) output =
+        scortch_batching_engine_submit_finish (SCORTCH_BATCHING_ENGINE (source_object), result, nullptr);
+
+      EXPECT_THAT (output, Not (IsNull ()));
+      *static_cast <bool *> (user_data) = true;
+      g_object_unref (source_object);
+    }
+  };
+
+  scortch_batching_engine_submit_async (engine, input, nullptr, ReleaseEngine::callback, &called);
+
+  while (!called || engine != nullptr)
+    g_main_context_iteration (nullptr, TRUE);
+
+  EXPECT_TRUE (called);
+}
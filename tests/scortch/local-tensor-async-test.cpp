@@ -0,0 +1,209 @@
+/*
+ * /tests/scortch/local-tensor-async-test.cpp
+ *
+ * Tests for the asynchronous ScortchLocalTensor API.
+ *
+ * Copyright (C) 2018 Sam Spilsbury.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <gio/gio.h>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <scortch/local-tensor.h>
+#include <scortch/local-tensor-operations.h>
+#include <scortch/scortch-errors.h>
+#include <scortch/scortch-worker-pool.h>
+
+#include <scortch/tensor-test-helpers.h>
+
+using ::testing::ElementsAre;
+using ::testing::IsNull;
+using ::testing::Not;
+
+using scortch_test::bytes_of;
+using scortch_test::dimensions_of;
+using scortch_test::tensor_from_values;
+
+namespace {
+  void store_result (GObject      *source_object G_GNUC_UNUSED,
+                     GAsyncResult *result,
+                     gpointer      user_data)
+  {
+    *static_cast <GAsyncResult **> (user_data) = G_ASYNC_RESULT (g_object_ref (result));
+  }
+
+  /* Spin the default main context until store_result is called */
+  GAsyncResult * iterate_until_result (GAsyncResult **result)
+  {
+    while (*result == nullptr)
+      g_main_context_iteration (nullptr, TRUE);
+
+    return *result;
+  }
+
+  GVariant * matrix_data ()
+  {
+    g_auto(GVariantBuilder) builder = G_VARIANT_BUILDER_INIT (G_VARIANT_TYPE ("av"));
+    double const first_row[] = { 1, 2, 3 };
+    double const second_row[] = { 4, 5, 6 };
+
+    g_variant_builder_add (&builder, "v",
+                           g_variant_new_fixed_array (G_VARIANT_TYPE_DOUBLE, first_row, 3, sizeof (double)));
+    g_variant_builder_add (&builder, "v",
+                           g_variant_new_fixed_array (G_VARIANT_TYPE_DOUBLE, second_row, 3, sizeof (double)));
+
+    return g_variant_builder_end (&builder);
+  }
+}
+
+TEST (ScortchLocalTensorAsync, set_data_async_replaces_data_on_finish)
+{
+  g_autoptr(ScortchLocalTensor) tensor = scortch_local_tensor_new ();
+  g_autoptr(GAsyncResult) result = nullptr;
+  g_autoptr(GError) error = nullptr;
+
+  scortch_local_tensor_set_data_async (tensor, matrix_data (), nullptr, store_result, &result);
+  iterate_until_result (&result);
+
+  ASSERT_TRUE (scortch_local_tensor_set_data_finish (tensor, result, &error));
+  EXPECT_THAT (dimensions_of (tensor), ElementsAre (2, 3));
+  EXPECT_THAT (bytes_of <double> (tensor), ElementsAre (1, 2, 3, 4, 5, 6));
+}
+
+TEST (ScortchLocalTensorAsync, set_data_async_reports_malformed_data)
+{
+  g_autoptr(ScortchLocalTensor) tensor = scortch_local_tensor_new ();
+  g_autoptr(GAsyncResult) result = nullptr;
+  g_autoptr(GError) error = nullptr;
+
+  scortch_local_tensor_set_data_async (tensor,
+                                       g_variant_new_string ("not a tensor"),
+                                       nullptr,
+                                       store_result,
+                                       &result);
+  iterate_until_result (&result);
+
+  EXPECT_FALSE (scortch_local_tensor_set_data_finish (tensor, result, &error));
+  EXPECT_THAT (error, Not (IsNull ()));
+}
+
+TEST (ScortchLocalTensorAsync, get_data_async_matches_get_data)
+{
+  g_autoptr(ScortchLocalTensor) tensor = scortch_local_tensor_new ();
+  g_autoptr(GAsyncResult) result = nullptr;
+  g_autoptr(GError) error = nullptr;
+
+  ASSERT_TRUE (scortch_local_tensor_set_data (tensor, matrix_data (), nullptr));
+
+  scortch_local_tensor_get_data_async (tensor, nullptr, store_result, &result);
+  iterate_until_result (&result);
+
+  g_autoptr(GVariant) data = scortch_local_tensor_get_data_finish (tensor, result, &error);
+  g_autoptr(GVariant) expected = g_variant_ref_sink (scortch_local_tensor_get_data (tensor, nullptr));
+
+  ASSERT_THAT (data, Not (IsNull ()));
+  EXPECT_TRUE (g_variant_equal (data, expected));
+}
+
+TEST (ScortchLocalTensorAsync, cancelled_operation_leaves_tensor_unchanged)
+{
+  g_autoptr(ScortchLocalTensor) tensor = scortch_local_tensor_new ();
+  g_autoptr(GCancellable) cancellable = g_cancellable_new ();
+  g_autoptr(GAsyncResult) result = nullptr;
+  g_autoptr(GError) error = nullptr;
+
+  g_cancellable_cancel (cancellable);
+  scortch_local_tensor_set_data_async (tensor, matrix_data (), cancellable, store_result, &result);
+  iterate_until_result (&result);
+
+  EXPECT_FALSE (scortch_local_tensor_set_data_finish (tensor, result, &error));
+  EXPECT_TRUE (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED));
+  EXPECT_THAT (dimensions_of (tensor), Not (ElementsAre (2, 3)));
+}
+
+TEST (ScortchLocalTensorAsync, get_data_async_cancelled_while_running)
+{
+  g_autoptr(ScortchLocalTensor) tensor = tensor_from_values <float> (std::vector <float> (65536 * 4),
+                                                                     { 65536, 4 },
+                                                                     SCORTCH_DTYPE_FLOAT32);
+  g_autoptr(GCancellable) cancellable = g_cancellable_new ();
+  g_autoptr(GAsyncResult) result = nullptr;
+  g_autoptr(GError) error = nullptr;
+
+  /* Whether the worker has started or not, the conversion
+   * must notice the cancellation and report it. */
+  scortch_local_tensor_get_data_async (tensor, cancellable, store_result, &result);
+  g_cancellable_cancel (cancellable);
+  iterate_until_result (&result);
+
+  g_autoptr(GVariant) data = scortch_local_tensor_get_data_finish (tensor, result, &error);
+
+  EXPECT_THAT (data, IsNull ());
+  EXPECT_TRUE (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED));
+}
+
+TEST (ScortchLocalTensorAsync, matmul_async)
+{
+  g_autoptr(ScortchLocalTensor) left = tensor_from_values <double> ({ 1, 2, 3, 4 },
+                                                                    { 2, 2 },
+                                                                    SCORTCH_DTYPE_FLOAT64);
+  g_autoptr(ScortchLocalTensor) right = tensor_from_values <double> ({ 0, 1, 1, 0 },
+                                                                     { 2, 2 },
+                                                                     SCORTCH_DTYPE_FLOAT64);
+  g_autoptr(GAsyncResult) result = nullptr;
+  g_autoptr(GError) error = nullptr;
+
+  scortch_local_tensor_matmul_async (left, right, nullptr, store_result, &result);
+  iterate_until_result (&result);
+
+  g_autoptr(ScortchLocalTensor) product = scortch_local_tensor_matmul_finish (left, result, &error);
+
+  ASSERT_THAT (product, Not (IsNull ()));
+  EXPECT_THAT (bytes_of <double> (product), ElementsAre (2, 1, 4, 3));
+}
+
+TEST (ScortchLocalTensorAsync, async_operation_reports_errors)
+{
+  g_autoptr(ScortchLocalTensor) left = tensor_from_values <double> ({ 1, 2, 3 },
+                                                                    { 3 },
+                                                                    SCORTCH_DTYPE_FLOAT64);
+  g_autoptr(ScortchLocalTensor) right = tensor_from_values <double> ({ 1, 2 },
+                                                                     { 2 },
+                                                                     SCORTCH_DTYPE_FLOAT64);
+  g_autoptr(GAsyncResult) result = nullptr;
+  g_autoptr(GError) error = nullptr;
+
+  scortch_local_tensor_add_async (left, right, nullptr, store_result, &result);
+  iterate_until_result (&result);
+
+  g_autoptr(ScortchLocalTensor) sum = scortch_local_tensor_add_finish (left, result, &error);
+
+  EXPECT_THAT (sum, IsNull ());
+  EXPECT_TRUE (g_error_matches (error, SCORTCH_ERROR, SCORTCH_ERROR_INVALID_OPERATION));
+}
+
+TEST (ScortchWorkerPool, set_max_threads)
+{
+  guint const previous = scortch_worker_pool_get_max_threads ();
+
+  scortch_worker_pool_set_max_threads (2);
+  EXPECT_EQ (scortch_worker_pool_get_max_threads (), 2u);
+
+  scortch_worker_pool_set_max_threads (previous);
+}
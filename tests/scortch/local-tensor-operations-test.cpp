@@ -0,0 +1,465 @@
+/*
+ * /tests/scortch/local-tensor-operations-test.cpp
+ *
+ * Tests for tensor operations on ScortchLocalTensor.
+ *
+ * Copyright (C) 2018 Sam Spilsbury.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <scortch/local-tensor.h>
+#include <scortch/local-tensor-operations.h>
+#include <scortch/scortch-errors.h>
+
+#include <scortch/tensor-test-helpers.h>
+
+using ::testing::DoubleNear;
+using ::testing::ElementsAre;
+using ::testing::IsNull;
+using ::testing::Not;
+
+using scortch_test::bytes_of;
+using scortch_test::dimensions_of;
+using scortch_test::dimensions_variant;
+using scortch_test::tensor_from_values;
+
+TEST (ScortchLocalTensorOperations, add_broadcasts_operands)
+{
+  g_autoptr(ScortchLocalTensor) matrix = tensor_from_values <double> ({ 1, 2, 3, 4, 5, 6 },
+                                                                      { 2, 3 },
+                                                                      SCORTCH_DTYPE_FLOAT64);
+  g_autoptr(ScortchLocalTensor) row = tensor_from_values <double> ({ 10, 20, 30 },
+                                                                   { 3 },
+                                                                   SCORTCH_DTYPE_FLOAT64);
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(ScortchLocalTensor) result = scortch_local_tensor_add (matrix, row, &error);
+
+  ASSERT_THAT (result, Not (IsNull ()));
+  EXPECT_THAT (dimensions_of (result), ElementsAre (2, 3));
+  EXPECT_THAT (bytes_of <double> (result), ElementsAre (11, 22, 33, 14, 25, 36));
+}
+
+TEST (ScortchLocalTensorOperations, elementwise_operations)
+{
+  g_autoptr(ScortchLocalTensor) left = tensor_from_values <double> ({ 8, 6 },
+                                                                    { 2 },
+                                                                    SCORTCH_DTYPE_FLOAT64);
+  g_autoptr(ScortchLocalTensor) right = tensor_from_values <double> ({ 2, 3 },
+                                                                     { 2 },
+                                                                     SCORTCH_DTYPE_FLOAT64);
+  g_autoptr(ScortchLocalTensor) difference = scortch_local_tensor_sub (left, right, nullptr);
+  g_autoptr(ScortchLocalTensor) product = scortch_local_tensor_mul (left, right, nullptr);
+  g_autoptr(ScortchLocalTensor) quotient = scortch_local_tensor_div (left, right, nullptr);
+
+  EXPECT_THAT (bytes_of <double> (difference), ElementsAre (6, 3));
+  EXPECT_THAT (bytes_of <double> (product), ElementsAre (16, 18));
+  EXPECT_THAT (bytes_of <double> (quotient), ElementsAre (4, 2));
+}
+
+TEST (ScortchLocalTensorOperations, mismatched_shapes_set_error)
+{
+  g_autoptr(ScortchLocalTensor) left = tensor_from_values <double> ({ 1, 2, 3 },
+                                                                    { 3 },
+                                                                    SCORTCH_DTYPE_FLOAT64);
+  g_autoptr(ScortchLocalTensor) right = tensor_from_values <double> ({ 1, 2 },
+                                                                     { 2 },
+                                                                     SCORTCH_DTYPE_FLOAT64);
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(ScortchLocalTensor) result = scortch_local_tensor_add (left, right, &error);
+
+  EXPECT_THAT (result, IsNull ());
+  EXPECT_TRUE (g_error_matches (error, SCORTCH_ERROR, SCORTCH_ERROR_INVALID_OPERATION));
+}
+
+TEST (ScortchLocalTensorOperations, matmul)
+{
+  g_autoptr(ScortchLocalTensor) left = tensor_from_values <float> ({ 1, 2, 3, 4, 5, 6 },
+                                                                   { 2, 3 },
+                                                                   SCORTCH_DTYPE_FLOAT32);
+  g_autoptr(ScortchLocalTensor) right = tensor_from_values <float> ({ 1, 0, 0, 1, 1, 1 },
+                                                                    { 3, 2 },
+                                                                    SCORTCH_DTYPE_FLOAT32);
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(ScortchLocalTensor) result = scortch_local_tensor_matmul (left, right, &error);
+
+  ASSERT_THAT (result, Not (IsNull ()));
+  EXPECT_EQ (scortch_local_tensor_get_dtype (result), SCORTCH_DTYPE_FLOAT32);
+  EXPECT_THAT (dimensions_of (result), ElementsAre (2, 2));
+  EXPECT_THAT (bytes_of <float> (result), ElementsAre (4, 5, 10, 11));
+}
+
+TEST (ScortchLocalTensorOperations, reductions)
+{
+  g_autoptr(ScortchLocalTensor) matrix = tensor_from_values <double> ({ 1, 5, 3, 4, 2, 6 },
+                                                                      { 2, 3 },
+                                                                      SCORTCH_DTYPE_FLOAT64);
+  g_autoptr(ScortchLocalTensor) sum = scortch_local_tensor_sum (matrix, 1, FALSE, nullptr);
+  g_autoptr(ScortchLocalTensor) mean = scortch_local_tensor_mean (matrix, 0, TRUE, nullptr);
+  g_autoptr(ScortchLocalTensor) indices = nullptr;
+  g_autoptr(ScortchLocalTensor) max = scortch_local_tensor_max (matrix, -1, FALSE, &indices, nullptr);
+
+  EXPECT_THAT (dimensions_of (sum), ElementsAre (2));
+  EXPECT_THAT (bytes_of <double> (sum), ElementsAre (9, 12));
+  EXPECT_THAT (dimensions_of (mean), ElementsAre (1, 3));
+  EXPECT_THAT (bytes_of <double> (mean), ElementsAre (2.5, 3.5, 4.5));
+  EXPECT_THAT (bytes_of <double> (max), ElementsAre (5, 6));
+  EXPECT_EQ (scortch_local_tensor_get_dtype (indices), SCORTCH_DTYPE_INT64);
+  EXPECT_THAT (bytes_of <int64_t> (indices), ElementsAre (1, 2));
+}
+
+TEST (ScortchLocalTensorOperations, softmax_and_log_softmax)
+{
+  g_autoptr(ScortchLocalTensor) logits = tensor_from_values <double> ({ 0, 0, 0, 0 },
+                                                                      { 2, 2 },
+                                                                      SCORTCH_DTYPE_FLOAT64);
+  g_autoptr(ScortchLocalTensor) probabilities = scortch_local_tensor_softmax (logits, 1, nullptr);
+  g_autoptr(ScortchLocalTensor) log_probabilities = scortch_local_tensor_log_softmax (logits, 1, nullptr);
+
+  EXPECT_THAT (bytes_of <double> (probabilities),
+               ElementsAre (DoubleNear (0.5, 1e-9),
+                            DoubleNear (0.5, 1e-9),
+                            DoubleNear (0.5, 1e-9),
+                            DoubleNear (0.5, 1e-9)));
+  EXPECT_THAT (bytes_of <double> (log_probabilities)[0], DoubleNear (-0.693147, 1e-6));
+}
+
+TEST (ScortchLocalTensorOperations, reshape_infers_dimension)
+{
+  g_autoptr(ScortchLocalTensor) vector = tensor_from_values <int64_t> ({ 1, 2, 3, 4, 5, 6 },
+                                                                       { 6 },
+                                                                       SCORTCH_DTYPE_INT64);
+  g_autoptr(ScortchLocalTensor) result = scortch_local_tensor_reshape (vector,
+                                                                       dimensions_variant ({ 3, -1 }),
+                                                                       nullptr);
+
+  EXPECT_THAT (dimensions_of (result), ElementsAre (3, 2));
+  EXPECT_THAT (bytes_of <int64_t> (result), ElementsAre (1, 2, 3, 4, 5, 6));
+}
+
+TEST (ScortchLocalTensorOperations, reshape_wrong_size_sets_error)
+{
+  g_autoptr(ScortchLocalTensor) vector = tensor_from_values <int64_t> ({ 1, 2, 3 },
+                                                                       { 3 },
+                                                                       SCORTCH_DTYPE_INT64);
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(ScortchLocalTensor) result = scortch_local_tensor_reshape (vector,
+                                                                       dimensions_variant ({ 2, 2 }),
+                                                                       &error);
+
+  EXPECT_THAT (result, IsNull ());
+  EXPECT_TRUE (g_error_matches (error, SCORTCH_ERROR, SCORTCH_ERROR_INVALID_OPERATION));
+}
+
+TEST (ScortchLocalTensorOperations, transpose)
+{
+  g_autoptr(ScortchLocalTensor) matrix = tensor_from_values <int64_t> ({ 1, 2, 3, 4, 5, 6 },
+                                                                       { 2, 3 },
+                                                                       SCORTCH_DTYPE_INT64);
+  g_autoptr(ScortchLocalTensor) result = scortch_local_tensor_transpose (matrix, 0, 1, nullptr);
+
+  EXPECT_THAT (dimensions_of (result), ElementsAre (3, 2));
+  EXPECT_THAT (bytes_of <int64_t> (result), ElementsAre (1, 4, 2, 5, 3, 6));
+}
+
+TEST (ScortchLocalTensorOperations, slice_with_step)
+{
+  g_autoptr(ScortchLocalTensor) matrix = tensor_from_values <int64_t> ({ 1, 2, 3, 4, 5, 6 },
+                                                                       { 2, 3 },
+                                                                       SCORTCH_DTYPE_INT64);
+  g_autoptr(ScortchLocalTensor) result = scortch_local_tensor_slice (matrix, 1, 0, G_MAXINT64, 2, nullptr);
+
+  EXPECT_THAT (dimensions_of (result), ElementsAre (2, 2));
+  EXPECT_THAT (bytes_of <int64_t> (result), ElementsAre (1, 3, 4, 6));
+}
+
+TEST (ScortchLocalTensorOperations, slice_zero_step_sets_error)
+{
+  g_autoptr(ScortchLocalTensor) vector = tensor_from_values <int64_t> ({ 1, 2, 3 },
+                                                                       { 3 },
+                                                                       SCORTCH_DTYPE_INT64);
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(ScortchLocalTensor) result = scortch_local_tensor_slice (vector, 0, 0, 3, 0, &error);
+
+  EXPECT_THAT (result, IsNull ());
+  EXPECT_TRUE (g_error_matches (error, SCORTCH_ERROR, SCORTCH_ERROR_INVALID_OPERATION));
+}
+
+TEST (ScortchLocalTensorOperations, narrow)
+{
+  g_autoptr(ScortchLocalTensor) matrix = tensor_from_values <int64_t> ({ 1, 2, 3, 4, 5, 6 },
+                                                                       { 3, 2 },
+                                                                       SCORTCH_DTYPE_INT64);
+  g_autoptr(ScortchLocalTensor) result = scortch_local_tensor_narrow (matrix, 0, 1, 2, nullptr);
+
+  EXPECT_THAT (dimensions_of (result), ElementsAre (2, 2));
+  EXPECT_THAT (bytes_of <int64_t> (result), ElementsAre (3, 4, 5, 6));
+}
+
+TEST (ScortchLocalTensorOperations, narrow_out_of_range_sets_error)
+{
+  g_autoptr(ScortchLocalTensor) vector = tensor_from_values <int64_t> ({ 1, 2, 3 },
+                                                                       { 3 },
+                                                                       SCORTCH_DTYPE_INT64);
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(ScortchLocalTensor) result = scortch_local_tensor_narrow (vector, 0, 2, 2, &error);
+
+  EXPECT_THAT (result, IsNull ());
+  EXPECT_TRUE (g_error_matches (error, SCORTCH_ERROR, SCORTCH_ERROR_INVALID_OPERATION));
+}
+
+TEST (ScortchLocalTensorOperations, select_row)
+{
+  g_autoptr(ScortchLocalTensor) matrix = tensor_from_values <int64_t> ({ 1, 2, 3, 4, 5, 6 },
+                                                                       { 3, 2 },
+                                                                       SCORTCH_DTYPE_INT64);
+  g_autoptr(ScortchLocalTensor) result = scortch_local_tensor_select (matrix, 0, -1, nullptr);
+
+  EXPECT_THAT (dimensions_of (result), ElementsAre (2));
+  EXPECT_THAT (bytes_of <int64_t> (result), ElementsAre (5, 6));
+}
+
+TEST (ScortchLocalTensorOperations, view)
+{
+  g_autoptr(ScortchLocalTensor) vector = tensor_from_values <int64_t> ({ 1, 2, 3, 4, 5, 6 },
+                                                                       { 6 },
+                                                                       SCORTCH_DTYPE_INT64);
+  g_autoptr(ScortchLocalTensor) result = scortch_local_tensor_view (vector,
+                                                                    dimensions_variant ({ -1, 3 }),
+                                                                    nullptr);
+
+  EXPECT_THAT (dimensions_of (result), ElementsAre (2, 3));
+  EXPECT_THAT (bytes_of <int64_t> (result), ElementsAre (1, 2, 3, 4, 5, 6));
+}
+
+TEST (ScortchLocalTensorOperations, view_of_transposed_tensor_sets_error)
+{
+  g_autoptr(ScortchLocalTensor) matrix = tensor_from_values <int64_t> ({ 1, 2, 3, 4, 5, 6 },
+                                                                       { 2, 3 },
+                                                                       SCORTCH_DTYPE_INT64);
+  g_autoptr(ScortchLocalTensor) transposed = scortch_local_tensor_transpose (matrix, 0, 1, nullptr);
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(ScortchLocalTensor) result = scortch_local_tensor_view (transposed,
+                                                                    dimensions_variant ({ 6 }),
+                                                                    &error);
+
+  EXPECT_THAT (result, IsNull ());
+  EXPECT_TRUE (g_error_matches (error, SCORTCH_ERROR, SCORTCH_ERROR_INVALID_OPERATION));
+}
+
+TEST (ScortchLocalTensorOperations, views_share_storage)
+{
+  g_autoptr(ScortchLocalTensor) matrix = tensor_from_values <double> ({ 1, 2, 3, 4 },
+                                                                      { 2, 2 },
+                                                                      SCORTCH_DTYPE_FLOAT64);
+  g_autoptr(ScortchLocalTensor) row = scortch_local_tensor_select (matrix, 0, 1, nullptr);
+
+  ASSERT_TRUE (scortch_local_tensor_fill (row, 0, nullptr));
+
+  EXPECT_THAT (bytes_of <double> (matrix), ElementsAre (1, 2, 0, 0));
+}
+
+TEST (ScortchLocalTensorOperations, view_outlives_parent)
+{
+  ScortchLocalTensor *matrix = tensor_from_values <double> ({ 1, 2, 3, 4 },
+                                                            { 2, 2 },
+                                                            SCORTCH_DTYPE_FLOAT64);
+  g_autoptr(ScortchLocalTensor) column = scortch_local_tensor_slice (matrix, 1, 1, 2, 1, nullptr);
+
+  g_object_unref (matrix);
+
+  EXPECT_THAT (dimensions_of (column), ElementsAre (2, 1));
+  EXPECT_THAT (bytes_of <double> (column), ElementsAre (2, 4));
+}
+
+TEST (ScortchLocalTensorOperations, cat)
+{
+  g_autoptr(ScortchLocalTensor) first = tensor_from_values <int64_t> ({ 1, 2 },
+                                                                      { 1, 2 },
+                                                                      SCORTCH_DTYPE_INT64);
+  g_autoptr(ScortchLocalTensor) second = tensor_from_values <int64_t> ({ 3, 4, 5, 6 },
+                                                                       { 2, 2 },
+                                                                       SCORTCH_DTYPE_INT64);
+  ScortchLocalTensor *tensors[] = { first, second };
+  g_autoptr(ScortchLocalTensor) result = scortch_local_tensor_cat (tensors, 2, 0, nullptr);
+
+  EXPECT_THAT (dimensions_of (result), ElementsAre (3, 2));
+  EXPECT_THAT (bytes_of <int64_t> (result), ElementsAre (1, 2, 3, 4, 5, 6));
+}
+
+TEST (ScortchLocalTensorOperations, in_place_operations_modify_tensor)
+{
+  g_autoptr(ScortchLocalTensor) tensor = tensor_from_values <double> ({ 1, 2, 3, 4 },
+                                                                      { 2, 2 },
+                                                                      SCORTCH_DTYPE_FLOAT64);
+  g_autoptr(ScortchLocalTensor) row = tensor_from_values <double> ({ 1, 2 },
+                                                                   { 2 },
+                                                                   SCORTCH_DTYPE_FLOAT64);
+
+  ASSERT_TRUE (scortch_local_tensor_add_in_place (tensor, row, nullptr));
+  EXPECT_THAT (bytes_of <double> (tensor), ElementsAre (2, 4, 4, 6));
+
+  ASSERT_TRUE (scortch_local_tensor_mul_in_place (tensor, row, nullptr));
+  EXPECT_THAT (bytes_of <double> (tensor), ElementsAre (2, 8, 4, 12));
+
+  ASSERT_TRUE (scortch_local_tensor_clamp_in_place (tensor, 3, 10, nullptr));
+  EXPECT_THAT (bytes_of <double> (tensor), ElementsAre (3, 8, 4, 10));
+
+  ASSERT_TRUE (scortch_local_tensor_fill (tensor, 7, nullptr));
+  EXPECT_THAT (bytes_of <double> (tensor), ElementsAre (7, 7, 7, 7));
+  EXPECT_THAT (dimensions_of (tensor), ElementsAre (2, 2));
+}
+
+TEST (ScortchLocalTensorOperations, in_place_operations_reject_read_only_memory)
+{
+  double const values[] = { 1, 2, 3, 4 };
+  g_autoptr(GBytes) bytes = g_bytes_new (values, sizeof (values));
+  g_autoptr(ScortchLocalTensor) tensor = scortch_local_tensor_new_from_bytes (bytes,
+                                                                              dimensions_variant ({ 2, 2 }),
+                                                                              SCORTCH_DTYPE_FLOAT64,
+                                                                              nullptr);
+  g_autoptr(ScortchLocalTensor) row = scortch_local_tensor_select (tensor, 0, 1, nullptr);
+  g_autoptr(ScortchLocalTensor) other = tensor_from_values <double> ({ 1, 1 },
+                                                                     { 2 },
+                                                                     SCORTCH_DTYPE_FLOAT64);
+  g_autoptr(GError) add_error = nullptr;
+  g_autoptr(GError) fill_error = nullptr;
+  g_autoptr(GError) out_error = nullptr;
+
+  EXPECT_FALSE (scortch_local_tensor_add_in_place (tensor, other, &add_error));
+  EXPECT_TRUE (g_error_matches (add_error, SCORTCH_ERROR, SCORTCH_ERROR_INVALID_OPERATION));
+
+  /* Views share the read-only storage */
+  EXPECT_FALSE (scortch_local_tensor_fill (row, 0, &fill_error));
+  EXPECT_TRUE (g_error_matches (fill_error, SCORTCH_ERROR, SCORTCH_ERROR_INVALID_OPERATION));
+
+  EXPECT_FALSE (scortch_local_tensor_add_out (other, other, row, &out_error));
+  EXPECT_TRUE (g_error_matches (out_error, SCORTCH_ERROR, SCORTCH_ERROR_INVALID_OPERATION));
+
+  /* The caller's bytes were left alone */
+  EXPECT_THAT (bytes_of <double> (tensor), ElementsAre (1, 2, 3, 4));
+
+  g_autoptr(ScortchLocalTensor) copy = scortch_local_tensor_clone (tensor, nullptr);
+
+  ASSERT_TRUE (scortch_local_tensor_add_in_place (copy, other, nullptr));
+  EXPECT_THAT (bytes_of <double> (copy), ElementsAre (2, 3, 4, 5));
+}
+
+TEST (ScortchLocalTensorOperations, in_place_operation_cannot_broadcast_self)
+{
+  g_autoptr(ScortchLocalTensor) row = tensor_from_values <double> ({ 1, 2 },
+                                                                   { 2 },
+                                                                   SCORTCH_DTYPE_FLOAT64);
+  g_autoptr(ScortchLocalTensor) matrix = tensor_from_values <double> ({ 1, 2, 3, 4 },
+                                                                      { 2, 2 },
+                                                                      SCORTCH_DTYPE_FLOAT64);
+  g_autoptr(GError) error = nullptr;
+
+  EXPECT_FALSE (scortch_local_tensor_add_in_place (row, matrix, &error));
+  EXPECT_TRUE (g_error_matches (error, SCORTCH_ERROR, SCORTCH_ERROR_INVALID_OPERATION));
+}
+
+TEST (ScortchLocalTensorOperations, out_operations_write_into_destination)
+{
+  g_autoptr(ScortchLocalTensor) left = tensor_from_values <float> ({ 1, 2, 3, 4 },
+                                                                   { 2, 2 },
+                                                                   SCORTCH_DTYPE_FLOAT32);
+  g_autoptr(ScortchLocalTensor) right = tensor_from_values <float> ({ 1, 0, 0, 1 },
+                                                                    { 2, 2 },
+                                                                    SCORTCH_DTYPE_FLOAT32);
+  g_autoptr(ScortchLocalTensor) destination = tensor_from_values <float> ({ 0, 0, 0, 0 },
+                                                                          { 2, 2 },
+                                                                          SCORTCH_DTYPE_FLOAT32);
+  g_autoptr(GBytes) storage_before = scortch_local_tensor_get_bytes (destination);
+  g_autoptr(GError) error = nullptr;
+
+  ASSERT_TRUE (scortch_local_tensor_add_out (left, right, destination, &error));
+  EXPECT_THAT (bytes_of <float> (destination), ElementsAre (2, 2, 3, 5));
+
+  ASSERT_TRUE (scortch_local_tensor_sub_out (left, right, destination, &error));
+  EXPECT_THAT (bytes_of <float> (destination), ElementsAre (0, 2, 3, 3));
+
+  ASSERT_TRUE (scortch_local_tensor_mul_out (left, right, destination, &error));
+  EXPECT_THAT (bytes_of <float> (destination), ElementsAre (1, 0, 0, 4));
+
+  ASSERT_TRUE (scortch_local_tensor_div_out (right, left, destination, &error));
+  EXPECT_THAT (bytes_of <float> (destination), ElementsAre (1, 0, 0, 0.25));
+
+  ASSERT_TRUE (scortch_local_tensor_matmul_out (left, right, destination, &error));
+  EXPECT_THAT (bytes_of <float> (destination), ElementsAre (1, 2, 3, 4));
+
+  /* The destination was written in place rather than reallocated */
+  g_autoptr(GBytes) storage_after = scortch_local_tensor_get_bytes (destination);
+  EXPECT_EQ (g_bytes_get_data (storage_before, nullptr),
+             g_bytes_get_data (storage_after, nullptr));
+}
+
+TEST (ScortchLocalTensorOperations, div_out_of_integers_is_floating_point)
+{
+  g_autoptr(ScortchLocalTensor) left = tensor_from_values <int64_t> ({ 1, 6 },
+                                                                     { 2 },
+                                                                     SCORTCH_DTYPE_INT64);
+  g_autoptr(ScortchLocalTensor) right = tensor_from_values <int64_t> ({ 2, 4 },
+                                                                      { 2 },
+                                                                      SCORTCH_DTYPE_INT64);
+  g_autoptr(ScortchLocalTensor) destination = tensor_from_values <float> ({ 0, 0 },
+                                                                          { 2 },
+                                                                          SCORTCH_DTYPE_FLOAT32);
+  g_autoptr(ScortchLocalTensor) int_destination = tensor_from_values <int64_t> ({ 0, 0 },
+                                                                                { 2 },
+                                                                                SCORTCH_DTYPE_INT64);
+  g_autoptr(GError) error = nullptr;
+
+  ASSERT_TRUE (scortch_local_tensor_div_out (left, right, destination, &error)) << error->message;
+  EXPECT_THAT (bytes_of <float> (destination), ElementsAre (0.5, 1.5));
+
+  EXPECT_FALSE (scortch_local_tensor_div_out (left, right, int_destination, &error));
+  EXPECT_TRUE (g_error_matches (error, SCORTCH_ERROR, SCORTCH_ERROR_INVALID_DATA_TYPE));
+}
+
+TEST (ScortchLocalTensorOperations, out_operation_rejects_wrong_shape)
+{
+  g_autoptr(ScortchLocalTensor) left = tensor_from_values <double> ({ 1, 2, 3, 4, 5, 6 },
+                                                                    { 2, 3 },
+                                                                    SCORTCH_DTYPE_FLOAT64);
+  g_autoptr(ScortchLocalTensor) right = tensor_from_values <double> ({ 1, 2, 3 },
+                                                                     { 3, 1 },
+                                                                     SCORTCH_DTYPE_FLOAT64);
+  g_autoptr(ScortchLocalTensor) destination = tensor_from_values <double> ({ 0, 0 },
+                                                                           { 1, 2 },
+                                                                           SCORTCH_DTYPE_FLOAT64);
+  g_autoptr(GError) error = nullptr;
+
+  EXPECT_FALSE (scortch_local_tensor_matmul_out (left, right, destination, &error));
+  EXPECT_TRUE (g_error_matches (error, SCORTCH_ERROR, SCORTCH_ERROR_INVALID_DIMENSIONS));
+  EXPECT_THAT (dimensions_of (destination), ElementsAre (1, 2));
+}
+
+TEST (ScortchLocalTensorOperations, out_operation_rejects_wrong_dtype)
+{
+  g_autoptr(ScortchLocalTensor) left = tensor_from_values <double> ({ 1, 2 },
+                                                                    { 2 },
+                                                                    SCORTCH_DTYPE_FLOAT64);
+  g_autoptr(ScortchLocalTensor) destination = tensor_from_values <float> ({ 0, 0 },
+                                                                          { 2 },
+                                                                          SCORTCH_DTYPE_FLOAT32);
+  g_autoptr(GError) error = nullptr;
+
+  EXPECT_FALSE (scortch_local_tensor_add_out (left, left, destination, &error));
+  EXPECT_TRUE (g_error_matches (error, SCORTCH_ERROR, SCORTCH_ERROR_INVALID_DATA_TYPE));
+}
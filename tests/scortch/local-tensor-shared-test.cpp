@@ -0,0 +1,264 @@
+/*
+ * /tests/scortch/local-tensor-shared-test.cpp
+ *
+ * Tests for ScortchLocalTensor in shared memory.
+ *
+ * Copyright (C) 2018 Sam Spilsbury.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <gio/gio.h>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <scortch/local-tensor.h>
+#include <scortch/local-tensor-operations.h>
+#include <scortch/local-tensor-shared.h>
+#include <scortch/scortch-errors.h>
+
+#include <scortch/tensor-test-helpers.h>
+
+using ::testing::ElementsAre;
+using ::testing::IsNull;
+using ::testing::Not;
+
+using scortch_test::bytes_of;
+using scortch_test::dimensions_of;
+using scortch_test::dimensions_variant;
+using scortch_test::tensor_from_values;
+
+TEST (ScortchLocalTensorShared, new_shared_is_zeroed)
+{
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(ScortchLocalTensor) tensor = scortch_local_tensor_new_shared (dimensions_variant ({ 2, 2 }),
+                                                                          SCORTCH_DTYPE_FLOAT64,
+                                                                          &error);
+
+  ASSERT_THAT (tensor, Not (IsNull ())) << error->message;
+  EXPECT_TRUE (scortch_local_tensor_is_shared (tensor));
+  EXPECT_THAT (dimensions_of (tensor), ElementsAre (2, 2));
+  EXPECT_THAT (bytes_of <double> (tensor), ElementsAre (0, 0, 0, 0));
+}
+
+TEST (ScortchLocalTensorShared, attached_tensor_sees_writes)
+{
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(ScortchLocalTensor) tensor = scortch_local_tensor_new_shared (dimensions_variant ({ 3 }),
+                                                                          SCORTCH_DTYPE_INT64,
+                                                                          &error);
+
+  ASSERT_THAT (tensor, Not (IsNull ())) << error->message;
+
+  g_autoptr(ScortchLocalTensor) attached =
+    scortch_local_tensor_new_from_shared_handle (scortch_local_tensor_get_shared_handle (tensor), &error);
+
+  ASSERT_THAT (attached, Not (IsNull ())) << error->message;
+  EXPECT_THAT (dimensions_of (attached), ElementsAre (3));
+  EXPECT_EQ (scortch_local_tensor_get_dtype (attached), SCORTCH_DTYPE_INT64);
+
+  ASSERT_TRUE (scortch_local_tensor_fill (tensor, 7, nullptr));
+  EXPECT_THAT (bytes_of <int64_t> (attached), ElementsAre (7, 7, 7));
+
+  ASSERT_TRUE (scortch_local_tensor_fill (attached, 3, nullptr));
+  EXPECT_THAT (bytes_of <int64_t> (tensor), ElementsAre (3, 3, 3));
+}
+
+TEST (ScortchLocalTensorShared, share_memory_keeps_contents)
+{
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(ScortchLocalTensor) tensor = tensor_from_values <float> ({ 1, 2, 3, 4 },
+                                                                     { 2, 2 },
+                                                                     SCORTCH_DTYPE_FLOAT32);
+
+  EXPECT_FALSE (scortch_local_tensor_is_shared (tensor));
+  EXPECT_THAT (scortch_local_tensor_get_shared_handle (tensor), IsNull ());
+
+  ASSERT_TRUE (scortch_local_tensor_share_memory (tensor, &error)) << error->message;
+  EXPECT_TRUE (scortch_local_tensor_is_shared (tensor));
+  EXPECT_THAT (bytes_of <float> (tensor), ElementsAre (1, 2, 3, 4));
+
+  g_autoptr(ScortchLocalTensor) attached =
+    scortch_local_tensor_new_from_shared_handle (scortch_local_tensor_get_shared_handle (tensor), &error);
+
+  ASSERT_THAT (attached, Not (IsNull ())) << error->message;
+  EXPECT_THAT (bytes_of <float> (attached), ElementsAre (1, 2, 3, 4));
+}
+
+TEST (ScortchLocalTensorShared, share_memory_makes_views_contiguous)
+{
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(ScortchLocalTensor) matrix = tensor_from_values <int64_t> ({ 1, 2, 3, 4, 5, 6 },
+                                                                       { 2, 3 },
+                                                                       SCORTCH_DTYPE_INT64);
+  g_autoptr(ScortchLocalTensor) transposed = scortch_local_tensor_transpose (matrix, 0, 1, nullptr);
+
+  ASSERT_TRUE (scortch_local_tensor_share_memory (transposed, &error)) << error->message;
+  EXPECT_THAT (dimensions_of (transposed), ElementsAre (3, 2));
+  EXPECT_THAT (bytes_of <int64_t> (transposed), ElementsAre (1, 4, 2, 5, 3, 6));
+
+  /* The original is left on its own storage */
+  EXPECT_FALSE (scortch_local_tensor_is_shared (matrix));
+}
+
+TEST (ScortchLocalTensorShared, share_memory_twice_keeps_segment)
+{
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(ScortchLocalTensor) tensor = scortch_local_tensor_new_shared (dimensions_variant ({ 4 }),
+                                                                          SCORTCH_DTYPE_FLOAT64,
+                                                                          &error);
+
+  ASSERT_THAT (tensor, Not (IsNull ())) << error->message;
+
+  g_autoptr(GVariant) handle = g_variant_ref_sink (scortch_local_tensor_get_shared_handle (tensor));
+
+  ASSERT_TRUE (scortch_local_tensor_share_memory (tensor, &error)) << error->message;
+
+  g_autoptr(GVariant) handle_after = g_variant_ref_sink (scortch_local_tensor_get_shared_handle (tensor));
+
+  EXPECT_TRUE (g_variant_equal (handle, handle_after));
+}
+
+TEST (ScortchLocalTensorShared, views_are_not_shared)
+{
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(ScortchLocalTensor) tensor = scortch_local_tensor_new_shared (dimensions_variant ({ 4, 2 }),
+                                                                          SCORTCH_DTYPE_FLOAT64,
+                                                                          &error);
+
+  ASSERT_THAT (tensor, Not (IsNull ())) << error->message;
+
+  g_autoptr(ScortchLocalTensor) rows = scortch_local_tensor_narrow (tensor, 0, 1, 2, &error);
+
+  ASSERT_THAT (rows, Not (IsNull ())) << error->message;
+  EXPECT_FALSE (scortch_local_tensor_is_shared (rows));
+}
+
+TEST (ScortchLocalTensorShared, forked_worker_writes_are_seen)
+{
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(ScortchLocalTensor) tensor = scortch_local_tensor_new_shared (dimensions_variant ({ 2 }),
+                                                                          SCORTCH_DTYPE_FLOAT64,
+                                                                          &error);
+
+  ASSERT_THAT (tensor, Not (IsNull ())) << error->message;
+
+  g_autoptr(GVariant) handle = g_variant_ref_sink (scortch_local_tensor_get_shared_handle (tensor));
+  pid_t pid = fork ();
+
+  ASSERT_NE (pid, -1);
+
+  if (pid == 0)
+    {
+      ScortchLocalTensor *attached = scortch_local_tensor_new_from_shared_handle (handle, nullptr);
+
+      if (attached == nullptr)
+        _exit (1);
+
+      gboolean filled = scortch_local_tensor_fill (attached, 5, nullptr);
+
+      g_object_unref (attached);
+      _exit (filled ? 0 : 1);
+    }
+
+  int status;
+
+  ASSERT_EQ (waitpid (pid, &status, 0), pid);
+  ASSERT_TRUE (WIFEXITED (status));
+  ASSERT_EQ (WEXITSTATUS (status), 0);
+
+  EXPECT_THAT (bytes_of <double> (tensor), ElementsAre (5, 5));
+}
+
+TEST (ScortchLocalTensorShared, segment_is_unlinked_with_creator)
+{
+  g_autoptr(GError) error = nullptr;
+  ScortchLocalTensor *tensor = scortch_local_tensor_new_shared (dimensions_variant ({ 2 }),
+                                                                SCORTCH_DTYPE_FLOAT64,
+                                                                &error);
+
+  ASSERT_THAT (tensor, Not (IsNull ())) << error->message;
+
+  g_autoptr(GVariant) handle = g_variant_ref_sink (scortch_local_tensor_get_shared_handle (tensor));
+  g_object_unref (tensor);
+
+  g_autoptr(ScortchLocalTensor) attached = scortch_local_tensor_new_from_shared_handle (handle, &error);
+
+  EXPECT_THAT (attached, IsNull ());
+  EXPECT_TRUE (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND));
+}
+
+TEST (ScortchLocalTensorShared, mismatched_handle_is_rejected)
+{
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(ScortchLocalTensor) tensor = scortch_local_tensor_new_shared (dimensions_variant ({ 2 }),
+                                                                          SCORTCH_DTYPE_FLOAT64,
+                                                                          &error);
+
+  ASSERT_THAT (tensor, Not (IsNull ())) << error->message;
+
+  g_autoptr(GVariant) handle = g_variant_ref_sink (scortch_local_tensor_get_shared_handle (tensor));
+  char const *name = nullptr;
+
+  g_variant_get_child (handle, 0, "&s", &name);
+
+  g_autoptr(ScortchLocalTensor) attached =
+    scortch_local_tensor_new_from_shared_handle (g_variant_new ("(s@axs)", name, dimensions_variant ({ 3 }), "float64"),
+                                                 &error);
+
+  EXPECT_THAT (attached, IsNull ());
+  EXPECT_TRUE (g_error_matches (error, SCORTCH_ERROR, SCORTCH_ERROR_INVALID_DIMENSIONS));
+}
+
+TEST (ScortchLocalTensorShared, overflowing_dimensions_are_rejected)
+{
+  g_autoptr(GError) error = nullptr;
+  int64_t const large = G_GINT64_CONSTANT (1) << 32;
+  g_autoptr(ScortchLocalTensor) tensor = scortch_local_tensor_new_shared (dimensions_variant ({ large, large }),
+                                                                          SCORTCH_DTYPE_FLOAT64,
+                                                                          &error);
+
+  EXPECT_THAT (tensor, IsNull ());
+  EXPECT_TRUE (g_error_matches (error, SCORTCH_ERROR, SCORTCH_ERROR_INVALID_DIMENSIONS));
+}
+
+TEST (ScortchLocalTensorShared, overflowing_handle_is_rejected)
+{
+  g_autoptr(GError) error = nullptr;
+  int64_t const large = G_GINT64_CONSTANT (1) << 62;
+  g_autoptr(ScortchLocalTensor) attached =
+    scortch_local_tensor_new_from_shared_handle (g_variant_new ("(s@axs)",
+                                                                "/scortch-overflow",
+                                                                dimensions_variant ({ large, 4 }),
+                                                                "float64"),
+                                                 &error);
+
+  EXPECT_THAT (attached, IsNull ());
+  EXPECT_TRUE (g_error_matches (error, SCORTCH_ERROR, SCORTCH_ERROR_INVALID_DIMENSIONS));
+}
+
+TEST (ScortchLocalTensorShared, malformed_handle_is_rejected)
+{
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(ScortchLocalTensor) attached =
+    scortch_local_tensor_new_from_shared_handle (g_variant_new_string ("/scortch"), &error);
+
+  EXPECT_THAT (attached, IsNull ());
+  EXPECT_TRUE (g_error_matches (error, SCORTCH_ERROR, SCORTCH_ERROR_MALFORMED_DATA));
+}
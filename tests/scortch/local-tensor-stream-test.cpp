@@ -0,0 +1,239 @@
+/*
+ * /tests/scortch/local-tensor-stream-test.cpp
+ *
+ * Tests for streaming ScortchLocalTensor elements through GIO streams.
+ *
+ * Copyright (C) 2018 Sam Spilsbury.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <vector>
+
+#include <gio/gio.h>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <scortch/local-tensor.h>
+#include <scortch/local-tensor-operations.h>
+#include <scortch/local-tensor-stream.h>
+
+#include <scortch/tensor-test-helpers.h>
+
+using ::testing::ElementsAre;
+using ::testing::IsNull;
+using ::testing::Lt;
+using ::testing::Not;
+
+using scortch_test::bytes_of;
+using scortch_test::dimensions_variant;
+using scortch_test::tensor_from_values;
+
+namespace {
+  template <typename T>
+  std::vector <T> read_all (GInputStream *stream)
+  {
+    g_autoptr(GOutputStream) memory = g_memory_output_stream_new_resizable ();
+    g_autoptr(GError) error = nullptr;
+
+    EXPECT_GE (g_output_stream_splice (memory,
+                                       stream,
+                                       static_cast <GOutputStreamSpliceFlags> (G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE |
+                                                                               G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET),
+                                       nullptr,
+                                       &error),
+               0) << error->message;
+
+    T const *data = static_cast <T const *> (g_memory_output_stream_get_data (G_MEMORY_OUTPUT_STREAM (memory)));
+    size_t size = g_memory_output_stream_get_data_size (G_MEMORY_OUTPUT_STREAM (memory));
+
+    return std::vector <T> (data, data + size / sizeof (T));
+  }
+
+  ScortchLocalTensor * zeros (std::vector <int64_t> const &dimensions,
+                              ScortchDType                 dtype)
+  {
+    return static_cast <ScortchLocalTensor *> (g_object_new (SCORTCH_TYPE_LOCAL_TENSOR,
+                                                             "dimensions", dimensions_variant (dimensions),
+                                                             "dtype", dtype,
+                                                             NULL));
+  }
+
+  void store_result (GObject      *source_object G_GNUC_UNUSED,
+                     GAsyncResult *result,
+                     gpointer      user_data)
+  {
+    *static_cast <GAsyncResult **> (user_data) = G_ASYNC_RESULT (g_object_ref (result));
+  }
+}
+
+TEST (ScortchLocalTensorStream, read_contiguous)
+{
+  g_autoptr(ScortchLocalTensor) tensor = tensor_from_values <double> ({ 1, 2, 3, 4, 5, 6 },
+                                                                      { 2, 3 },
+                                                                      SCORTCH_DTYPE_FLOAT64);
+  g_autoptr(GInputStream) stream = scortch_local_tensor_open_read_stream (tensor);
+
+  EXPECT_THAT (read_all <double> (stream), ElementsAre (1, 2, 3, 4, 5, 6));
+}
+
+TEST (ScortchLocalTensorStream, read_transposed_in_row_major_order)
+{
+  g_autoptr(ScortchLocalTensor) matrix = tensor_from_values <int64_t> ({ 1, 2, 3, 4, 5, 6 },
+                                                                       { 2, 3 },
+                                                                       SCORTCH_DTYPE_INT64);
+  g_autoptr(ScortchLocalTensor) transposed = scortch_local_tensor_transpose (matrix, 0, 1, nullptr);
+  g_autoptr(GInputStream) stream = scortch_local_tensor_open_read_stream (transposed);
+
+  EXPECT_THAT (read_all <int64_t> (stream), ElementsAre (1, 4, 2, 5, 3, 6));
+}
+
+TEST (ScortchLocalTensorStream, read_empty)
+{
+  g_autoptr(ScortchLocalTensor) tensor = scortch_local_tensor_new ();
+  g_autoptr(GInputStream) stream = scortch_local_tensor_open_read_stream (tensor);
+
+  EXPECT_THAT (read_all <double> (stream), ElementsAre ());
+}
+
+TEST (ScortchLocalTensorStream, reads_are_bounded)
+{
+  int64_t const n_elements = 4 * 1024 * 1024;
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(ScortchLocalTensor) tensor = zeros ({ n_elements }, SCORTCH_DTYPE_FLOAT64);
+  g_autoptr(GInputStream) stream = scortch_local_tensor_open_read_stream (tensor);
+  std::vector <char> buffer (n_elements * sizeof (double));
+  size_t total = 0;
+  gssize n_read;
+
+  while ((n_read = g_input_stream_read (stream, buffer.data (), buffer.size (), nullptr, &error)) > 0)
+    {
+      EXPECT_THAT (static_cast <size_t> (n_read), Lt (buffer.size ()));
+      total += n_read;
+    }
+
+  ASSERT_EQ (n_read, 0) << error->message;
+  EXPECT_EQ (total, buffer.size ());
+}
+
+TEST (ScortchLocalTensorStream, write_contiguous)
+{
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(ScortchLocalTensor) tensor = zeros ({ 2, 2 }, SCORTCH_DTYPE_FLOAT32);
+  g_autoptr(GOutputStream) stream = scortch_local_tensor_open_write_stream (tensor);
+  float const values[] = { 1, 2, 3, 4 };
+
+  /* Split across an element boundary */
+  ASSERT_TRUE (g_output_stream_write_all (stream, values, 6, nullptr, nullptr, &error)) << error->message;
+  ASSERT_TRUE (g_output_stream_write_all (stream,
+                                          reinterpret_cast <char const *> (values) + 6,
+                                          sizeof (values) - 6,
+                                          nullptr,
+                                          nullptr,
+                                          &error)) << error->message;
+  ASSERT_TRUE (g_output_stream_close (stream, nullptr, &error)) << error->message;
+
+  EXPECT_THAT (bytes_of <float> (tensor), ElementsAre (1, 2, 3, 4));
+}
+
+TEST (ScortchLocalTensorStream, write_transposed_view)
+{
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(ScortchLocalTensor) matrix = zeros ({ 2, 3 }, SCORTCH_DTYPE_INT64);
+  g_autoptr(ScortchLocalTensor) transposed = scortch_local_tensor_transpose (matrix, 0, 1, nullptr);
+  g_autoptr(GOutputStream) stream = scortch_local_tensor_open_write_stream (transposed);
+  int64_t const values[] = { 1, 4, 2, 5, 3, 6 };
+
+  ASSERT_TRUE (g_output_stream_write_all (stream, values, sizeof (values), nullptr, nullptr, &error)) << error->message;
+  ASSERT_TRUE (g_output_stream_close (stream, nullptr, &error)) << error->message;
+
+  EXPECT_THAT (bytes_of <int64_t> (matrix), ElementsAre (1, 2, 3, 4, 5, 6));
+}
+
+TEST (ScortchLocalTensorStream, write_past_end_fails)
+{
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(ScortchLocalTensor) tensor = zeros ({ 2 }, SCORTCH_DTYPE_FLOAT64);
+  g_autoptr(GOutputStream) stream = scortch_local_tensor_open_write_stream (tensor);
+  double const values[] = { 1, 2, 3 };
+
+  EXPECT_FALSE (g_output_stream_write_all (stream, values, sizeof (values), nullptr, nullptr, &error));
+  EXPECT_TRUE (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NO_SPACE));
+  EXPECT_THAT (bytes_of <double> (tensor), ElementsAre (1, 2));
+}
+
+TEST (ScortchLocalTensorStream, write_to_read_only_memory_fails)
+{
+  g_autoptr(GError) error = nullptr;
+  double const original[] = { 1, 2 };
+  g_autoptr(GBytes) bytes = g_bytes_new (original, sizeof (original));
+  g_autoptr(ScortchLocalTensor) tensor = scortch_local_tensor_new_from_bytes (bytes,
+                                                                              dimensions_variant ({ 2 }),
+                                                                              SCORTCH_DTYPE_FLOAT64,
+                                                                              &error);
+  ASSERT_THAT (tensor, Not (IsNull ())) << error->message;
+
+  g_autoptr(GOutputStream) stream = scortch_local_tensor_open_write_stream (tensor);
+  double const values[] = { 3, 4 };
+
+  EXPECT_FALSE (g_output_stream_write_all (stream, values, sizeof (values), nullptr, nullptr, &error));
+  EXPECT_TRUE (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_READ_ONLY));
+  EXPECT_THAT (bytes_of <double> (tensor), ElementsAre (1, 2));
+}
+
+TEST (ScortchLocalTensorStream, close_before_full_fails)
+{
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(ScortchLocalTensor) matrix = zeros ({ 2, 2 }, SCORTCH_DTYPE_FLOAT64);
+  g_autoptr(ScortchLocalTensor) transposed = scortch_local_tensor_transpose (matrix, 0, 1, nullptr);
+  g_autoptr(GOutputStream) stream = scortch_local_tensor_open_write_stream (transposed);
+  double const value = 1;
+
+  ASSERT_TRUE (g_output_stream_write_all (stream, &value, sizeof (value), nullptr, nullptr, &error)) << error->message;
+  EXPECT_FALSE (g_output_stream_close (stream, nullptr, &error));
+  EXPECT_TRUE (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_PARTIAL_INPUT));
+
+  /* What was written is kept */
+  EXPECT_THAT (bytes_of <double> (matrix), ElementsAre (1, 0, 0, 0));
+}
+
+TEST (ScortchLocalTensorStream, splice_between_tensors_async)
+{
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(ScortchLocalTensor) source = tensor_from_values <float> ({ 1, 2, 3, 4, 5, 6 },
+                                                                     { 3, 2 },
+                                                                     SCORTCH_DTYPE_FLOAT32);
+  g_autoptr(ScortchLocalTensor) destination = zeros ({ 3, 2 }, SCORTCH_DTYPE_FLOAT32);
+  g_autoptr(GInputStream) input = scortch_local_tensor_open_read_stream (source);
+  g_autoptr(GOutputStream) output = scortch_local_tensor_open_write_stream (destination);
+  g_autoptr(GAsyncResult) result = nullptr;
+
+  g_output_stream_splice_async (output,
+                                input,
+                                static_cast <GOutputStreamSpliceFlags> (G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE |
+                                                                        G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET),
+                                G_PRIORITY_DEFAULT,
+                                nullptr,
+                                store_result,
+                                &result);
+
+  while (result == nullptr)
+    g_main_context_iteration (nullptr, TRUE);
+
+  EXPECT_EQ (g_output_stream_splice_finish (output, result, &error),
+             static_cast <gssize> (6 * sizeof (float)));
+  EXPECT_THAT (bytes_of <float> (destination), ElementsAre (1, 2, 3, 4, 5, 6));
+}
@@ -20,16 +20,131 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <unistd.h>
+
+#include <glib/gstdio.h>
+
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 
 #include <scortch/local-tensor.h>
+#include <scortch/local-tensor-operations.h>
+#include <scortch/scortch-errors.h>
+
+#include <scortch/tensor-test-helpers.h>
 
 using ::testing::ElementsAre;
+using ::testing::Eq;
+using ::testing::Ge;
 using ::testing::IsNull;
 using ::testing::Not;
 
+using scortch_test::bytes_of;
+using scortch_test::dimensions_of;
+using scortch_test::dimensions_variant;
+using scortch_test::tensor_from_values;
+
 namespace {
+  /* Build an "av" of nested "av" arrays with leaves of
+   * type leaf_type_string, filled with increasing values
+   * starting from zero. */
+  GVariant * nested_variant_arrays (std::vector <int64_t> const &dimensions,
+                                    char const                  *leaf_type_string,
+                                    size_t                       level,
+                                    int64_t                     &counter)
+  {
+    if (level == dimensions.size () - 1)
+      {
+        g_auto(GVariantBuilder) builder = G_VARIANT_BUILDER_INIT (G_VARIANT_TYPE_ARRAY);
+        g_autoptr(GVariantType) leaf_type = g_variant_type_new (leaf_type_string);
+
+        g_variant_builder_init (&builder, leaf_type);
+
+        for (int64_t i = 0; i < dimensions[level]; ++i, ++counter)
+          {
+            if (g_variant_type_equal (leaf_type, G_VARIANT_TYPE ("ad")))
+              g_variant_builder_add (&builder, "d", static_cast <double> (counter) * 0.5);
+            else
+              g_variant_builder_add (&builder, "x", counter);
+          }
+
+        return g_variant_builder_end (&builder);
+      }
+
+    g_auto(GVariantBuilder) builder = G_VARIANT_BUILDER_INIT (G_VARIANT_TYPE ("av"));
+    g_variant_builder_init (&builder, G_VARIANT_TYPE ("av"));
+
+    for (int64_t i = 0; i < dimensions[level]; ++i)
+      g_variant_builder_add (&builder,
+                             "v",
+                             nested_variant_arrays (dimensions, leaf_type_string, level + 1, counter));
+
+    return g_variant_builder_end (&builder);
+  }
+
+  GVariant * nested_variant_arrays (std::vector <int64_t> const &dimensions,
+                                    char const                  *leaf_type_string)
+  {
+    int64_t counter = 0;
+    return nested_variant_arrays (dimensions, leaf_type_string, 0, counter);
+  }
+
+  /* Reference implementation of the element-by-element fill
+   * that the bulk fill replaces, visiting every scalar in
+   * row-major order and converting it to double. */
+  void flatten_element_wise (GVariant *variant, std::vector <double> &out)
+  {
+    if (g_variant_is_of_type (variant, G_VARIANT_TYPE ("av")))
+      {
+        GVariantIter iter;
+        GVariant *child;
+
+        g_variant_iter_init (&iter, variant);
+        while (g_variant_iter_next (&iter, "v", &child))
+          {
+            flatten_element_wise (child, out);
+            g_variant_unref (child);
+          }
+
+        return;
+      }
+
+    GVariantIter iter;
+    g_variant_iter_init (&iter, variant);
+
+    if (g_variant_is_of_type (variant, G_VARIANT_TYPE ("ad")))
+      {
+        double scalar;
+        while (g_variant_iter_next (&iter, "d", &scalar))
+          out.push_back (scalar);
+      }
+    else
+      {
+        int64_t scalar;
+        while (g_variant_iter_next (&iter, "x", &scalar))
+          out.push_back (static_cast <double> (scalar));
+      }
+  }
+
+  std::vector <double> flatten_element_wise (GVariant *variant)
+  {
+    std::vector <double> out;
+    flatten_element_wise (variant, out);
+    return out;
+  }
+
+  /* Write contents to a new temporary file and return its path */
+  gchar * write_temporary_file (gconstpointer contents, gsize size)
+  {
+    gchar *path = nullptr;
+    int fd = g_file_open_tmp ("scortch-test-XXXXXX", &path, nullptr);
+
+    close (fd);
+    g_file_set_contents (path, static_cast <gchar const *> (contents), size, nullptr);
+
+    return path;
+  }
+
   TEST (ScortchLocalTensor, construct) {
     g_autoptr(ScortchLocalTensor) tensor = scortch_local_tensor_new ();
 
@@ -71,4 +186,652 @@ namespace {
     EXPECT_THAT (std::vector <int64_t> (dimensions, dimensions + n_dimensions),
                  ElementsAre (2));
   }
+
+  TEST (ScortchLocalTensor, new_from_bytes) {
+    double const values[] = { 1.0, 2.0, 3.0, 4.0, 5.0, 6.0 };
+    g_autoptr(GBytes) bytes = g_bytes_new (values, sizeof (values));
+    g_autoptr(GError) error = nullptr;
+    g_autoptr(ScortchLocalTensor) tensor =
+      scortch_local_tensor_new_from_bytes (bytes,
+                                           dimensions_variant ({ 2, 3 }),
+                                           SCORTCH_DTYPE_FLOAT64,
+                                           &error);
+
+    ASSERT_THAT (error, IsNull ());
+    EXPECT_THAT (dimensions_of (tensor), ElementsAre (2, 3));
+    EXPECT_THAT (bytes_of <double> (tensor), ElementsAre (1.0, 2.0, 3.0, 4.0, 5.0, 6.0));
+  }
+
+  TEST (ScortchLocalTensor, new_from_bytes_shares_memory) {
+    int64_t const values[] = { 1, 2, 3, 4 };
+    g_autoptr(GBytes) bytes = g_bytes_new (values, sizeof (values));
+    g_autoptr(GError) error = nullptr;
+    g_autoptr(ScortchLocalTensor) tensor =
+      scortch_local_tensor_new_from_bytes (bytes,
+                                           dimensions_variant ({ 4 }),
+                                           SCORTCH_DTYPE_INT64,
+                                           &error);
+    g_autoptr(GBytes) tensor_bytes = scortch_local_tensor_get_bytes (tensor);
+
+    ASSERT_THAT (error, IsNull ());
+    EXPECT_EQ (g_bytes_get_data (bytes, nullptr),
+               g_bytes_get_data (tensor_bytes, nullptr));
+  }
+
+  TEST (ScortchLocalTensor, new_from_bytes_size_mismatch) {
+    double const values[] = { 1.0, 2.0, 3.0 };
+    g_autoptr(GBytes) bytes = g_bytes_new (values, sizeof (values));
+    g_autoptr(GError) error = nullptr;
+    g_autoptr(ScortchLocalTensor) tensor =
+      scortch_local_tensor_new_from_bytes (bytes,
+                                           dimensions_variant ({ 2, 2 }),
+                                           SCORTCH_DTYPE_FLOAT64,
+                                           &error);
+
+    EXPECT_THAT (tensor, IsNull ());
+    EXPECT_TRUE (g_error_matches (error, SCORTCH_ERROR, SCORTCH_ERROR_INVALID_DIMENSIONS));
+  }
+
+  TEST (ScortchLocalTensor, new_from_bytes_negative_dimensions) {
+    double const values[] = { 1.0, 2.0 };
+    g_autoptr(GBytes) bytes = g_bytes_new (values, sizeof (values));
+    g_autoptr(GError) error = nullptr;
+
+    /* Unchecked, -1 * -2 elements would match the 2 in bytes */
+    g_autoptr(ScortchLocalTensor) tensor =
+      scortch_local_tensor_new_from_bytes (bytes,
+                                           dimensions_variant ({ -1, -2 }),
+                                           SCORTCH_DTYPE_FLOAT64,
+                                           &error);
+
+    EXPECT_THAT (tensor, IsNull ());
+    EXPECT_TRUE (g_error_matches (error, SCORTCH_ERROR, SCORTCH_ERROR_INVALID_DIMENSIONS));
+  }
+
+  TEST (ScortchLocalTensor, new_from_bytes_overflowing_dimensions) {
+    double const values[] = { 1.0, 2.0 };
+    g_autoptr(GBytes) bytes = g_bytes_new (values, sizeof (values));
+    g_autoptr(GError) error = nullptr;
+
+    /* Unchecked, 8 * (2^61 + 2) bytes would wrap around to 16 */
+    g_autoptr(ScortchLocalTensor) tensor =
+      scortch_local_tensor_new_from_bytes (bytes,
+                                           dimensions_variant ({ (G_GINT64_CONSTANT (1) << 61) + 2 }),
+                                           SCORTCH_DTYPE_FLOAT64,
+                                           &error);
+
+    EXPECT_THAT (tensor, IsNull ());
+    EXPECT_TRUE (g_error_matches (error, SCORTCH_ERROR, SCORTCH_ERROR_INVALID_DIMENSIONS));
+  }
+
+  TEST (ScortchLocalTensor, new_from_bytes_invalid_dtype) {
+    double const values[] = { 1.0, 2.0 };
+    g_autoptr(GBytes) bytes = g_bytes_new (values, sizeof (values));
+    g_autoptr(GError) error = nullptr;
+    g_autoptr(ScortchLocalTensor) tensor =
+      scortch_local_tensor_new_from_bytes (bytes,
+                                           dimensions_variant ({ 2 }),
+                                           static_cast <ScortchDType> (42),
+                                           &error);
+
+    EXPECT_THAT (tensor, IsNull ());
+    EXPECT_TRUE (g_error_matches (error, SCORTCH_ERROR, SCORTCH_ERROR_INVALID_DATA_TYPE));
+  }
+
+  TEST (ScortchLocalTensor, get_bytes_outlives_tensor) {
+    int64_t const values[] = { 7, 8, 9 };
+    g_autoptr(GBytes) bytes = g_bytes_new (values, sizeof (values));
+    ScortchLocalTensor *tensor =
+      scortch_local_tensor_new_from_bytes (bytes,
+                                           dimensions_variant ({ 3 }),
+                                           SCORTCH_DTYPE_INT64,
+                                           nullptr);
+    g_autoptr(GBytes) tensor_bytes = scortch_local_tensor_get_bytes (tensor);
+    g_object_unref (tensor);
+
+    size_t size;
+    int64_t const *data = static_cast <int64_t const *> (g_bytes_get_data (tensor_bytes, &size));
+    EXPECT_THAT (std::vector <int64_t> (data, data + size / sizeof (int64_t)),
+                 ElementsAre (7, 8, 9));
+  }
+
+  TEST (ScortchLocalTensor, set_data_bulk_fill_matches_element_wise) {
+    g_autoptr(ScortchLocalTensor) tensor = scortch_local_tensor_new ();
+    g_autoptr(GVariant) data = g_variant_ref_sink (nested_variant_arrays ({ 3, 4, 5 }, "ad"));
+    g_autoptr(GError) error = nullptr;
+
+    ASSERT_TRUE (scortch_local_tensor_set_data (tensor, data, &error));
+    ASSERT_THAT (error, IsNull ());
+
+    EXPECT_THAT (dimensions_of (tensor), ElementsAre (3, 4, 5));
+    EXPECT_EQ (bytes_of <double> (tensor), flatten_element_wise (data));
+  }
+
+  TEST (ScortchLocalTensor, set_data_converts_leaf_type) {
+    g_autoptr(ScortchLocalTensor) tensor = scortch_local_tensor_new ();
+    g_autoptr(GVariant) data = g_variant_ref_sink (nested_variant_arrays ({ 4, 3 }, "ax"));
+    g_autoptr(GError) error = nullptr;
+
+    ASSERT_TRUE (scortch_local_tensor_set_data (tensor, data, &error));
+    ASSERT_THAT (error, IsNull ());
+
+    EXPECT_THAT (dimensions_of (tensor), ElementsAre (4, 3));
+    EXPECT_EQ (bytes_of <double> (tensor), flatten_element_wise (data));
+  }
+
+  TEST (ScortchLocalTensor, set_data_one_dimensional) {
+    g_autoptr(ScortchLocalTensor) tensor = scortch_local_tensor_new ();
+    g_autoptr(GVariant) data = g_variant_ref_sink (nested_variant_arrays ({ 7 }, "ad"));
+    g_autoptr(GError) error = nullptr;
+
+    ASSERT_TRUE (scortch_local_tensor_set_data (tensor, data, &error));
+    ASSERT_THAT (error, IsNull ());
+
+    EXPECT_THAT (dimensions_of (tensor), ElementsAre (7));
+    EXPECT_EQ (bytes_of <double> (tensor), flatten_element_wise (data));
+  }
+
+  TEST (ScortchLocalTensor, set_data_rejects_ragged_rows) {
+    g_autoptr(ScortchLocalTensor) tensor = scortch_local_tensor_new ();
+    g_autoptr(GVariant) data =
+      g_variant_ref_sink (g_variant_new_parsed ("[<[1.0, 2.0]>, <[3.0]>]"));
+    g_autoptr(GError) error = nullptr;
+
+    EXPECT_FALSE (scortch_local_tensor_set_data (tensor, data, &error));
+    EXPECT_TRUE (g_error_matches (error, SCORTCH_ERROR, SCORTCH_ERROR_MALFORMED_DATA));
+    EXPECT_THAT (dimensions_of (tensor), ElementsAre (0));
+  }
+
+  TEST (ScortchLocalTensor, set_data_rejects_wide_first_path) {
+    g_autoptr(ScortchLocalTensor) tensor = scortch_local_tensor_new ();
+    g_autoptr(GError) error = nullptr;
+    constexpr size_t width = 1000;
+    double const leaf_values[] = { 1.0 };
+    GVariant *nested = nullptr;
+
+    /* Only the first child is wide at each level, so the shape
+     * read along the first path claims 1000^4 rows that are not
+     * actually there. */
+    for (size_t level = 0; level < 4; ++level)
+      {
+        g_auto(GVariantBuilder) builder = G_VARIANT_BUILDER_INIT (G_VARIANT_TYPE ("av"));
+
+        for (size_t i = 0; i < width; ++i)
+          g_variant_builder_add (&builder, "v",
+                                 i == 0 && nested != nullptr ?
+                                   nested :
+                                   g_variant_new_fixed_array (G_VARIANT_TYPE_DOUBLE,
+                                                              leaf_values,
+                                                              G_N_ELEMENTS (leaf_values),
+                                                              sizeof (double)));
+
+        nested = g_variant_builder_end (&builder);
+      }
+
+    g_autoptr(GVariant) data = g_variant_ref_sink (nested);
+
+    EXPECT_FALSE (scortch_local_tensor_set_data (tensor, data, &error));
+    EXPECT_TRUE (g_error_matches (error, SCORTCH_ERROR, SCORTCH_ERROR_MALFORMED_DATA));
+  }
+
+  TEST (ScortchLocalTensor, set_data_rejects_mixed_leaf_types) {
+    g_autoptr(ScortchLocalTensor) tensor = scortch_local_tensor_new ();
+    g_autoptr(GVariant) data =
+      g_variant_ref_sink (g_variant_new_parsed ("[<[1.0, 2.0]>, <[int64 3, 4]>]"));
+    g_autoptr(GError) error = nullptr;
+
+    EXPECT_FALSE (scortch_local_tensor_set_data (tensor, data, &error));
+    EXPECT_TRUE (g_error_matches (error, SCORTCH_ERROR, SCORTCH_ERROR_MALFORMED_DATA));
+  }
+
+  TEST (ScortchLocalTensor, set_data_rejects_inconsistent_nesting) {
+    g_autoptr(ScortchLocalTensor) tensor = scortch_local_tensor_new ();
+    g_autoptr(GVariant) data =
+      g_variant_ref_sink (g_variant_new_parsed ("[<[1.0, 2.0]>, <[<[3.0, 4.0]>, <[5.0, 6.0]>]>]"));
+    g_autoptr(GError) error = nullptr;
+
+    EXPECT_FALSE (scortch_local_tensor_set_data (tensor, data, &error));
+    EXPECT_TRUE (g_error_matches (error, SCORTCH_ERROR, SCORTCH_ERROR_MALFORMED_DATA));
+  }
+
+  TEST (ScortchLocalTensor, set_data_rejects_unsupported_leaf_type) {
+    g_autoptr(ScortchLocalTensor) tensor = scortch_local_tensor_new ();
+    g_autoptr(GVariant) data =
+      g_variant_ref_sink (g_variant_new_parsed ("[<['a', 'b']>]"));
+    g_autoptr(GError) error = nullptr;
+
+    EXPECT_FALSE (scortch_local_tensor_set_data (tensor, data, &error));
+    EXPECT_TRUE (g_error_matches (error, SCORTCH_ERROR, SCORTCH_ERROR_INVALID_DATA_TYPE));
+  }
+
+  TEST (ScortchLocalTensor, default_dtype_is_float64) {
+    g_autoptr(ScortchLocalTensor) tensor = scortch_local_tensor_new ();
+
+    EXPECT_EQ (scortch_local_tensor_get_dtype (tensor), SCORTCH_DTYPE_FLOAT64);
+  }
+
+  TEST (ScortchLocalTensor, set_data_keeps_construction_dtype) {
+    g_autoptr(GVariant) data = g_variant_ref_sink (nested_variant_arrays ({ 2, 3 }, "ad"));
+    g_autoptr(ScortchLocalTensor) tensor =
+      static_cast <ScortchLocalTensor *> (g_object_new (SCORTCH_TYPE_LOCAL_TENSOR,
+                                                        "dtype", SCORTCH_DTYPE_FLOAT32,
+                                                        "data", data,
+                                                        NULL));
+
+    EXPECT_EQ (scortch_local_tensor_get_dtype (tensor), SCORTCH_DTYPE_FLOAT32);
+    EXPECT_THAT (bytes_of <float> (tensor), ElementsAre (0.0f, 0.5f, 1.0f, 1.5f, 2.0f, 2.5f));
+  }
+
+  TEST (ScortchLocalTensor, construction_data_overrides_dimensions) {
+    g_autoptr(GVariant) data = g_variant_ref_sink (nested_variant_arrays ({ 2, 3 }, "ad"));
+    g_autoptr(ScortchLocalTensor) tensor =
+      static_cast <ScortchLocalTensor *> (g_object_new (SCORTCH_TYPE_LOCAL_TENSOR,
+                                                        "dimensions", dimensions_variant ({ 100, 100 }),
+                                                        "data", data,
+                                                        "dtype", SCORTCH_DTYPE_INT64,
+                                                        NULL));
+
+    EXPECT_EQ (scortch_local_tensor_get_dtype (tensor), SCORTCH_DTYPE_INT64);
+    EXPECT_THAT (dimensions_of (tensor), ElementsAre (2, 3));
+    EXPECT_THAT (bytes_of <int64_t> (tensor), ElementsAre (0, 0, 1, 1, 2, 2));
+  }
+
+  TEST (ScortchLocalTensor, get_data_packs_float32_rows) {
+    float const values[] = { 1.0f, 2.0f, 3.0f, 4.0f };
+    g_autoptr(GBytes) bytes = g_bytes_new (values, sizeof (values));
+    g_autoptr(ScortchLocalTensor) tensor =
+      scortch_local_tensor_new_from_bytes (bytes,
+                                           dimensions_variant ({ 2, 2 }),
+                                           SCORTCH_DTYPE_FLOAT32,
+                                           nullptr);
+    g_autoptr(GError) error = nullptr;
+    g_autoptr(GVariant) data = g_variant_ref_sink (scortch_local_tensor_get_data (tensor, &error));
+
+    ASSERT_THAT (error, IsNull ());
+
+    g_autoptr(GVariant) row_variant = g_variant_get_child_value (data, 1);
+    g_autoptr(GVariant) row = g_variant_get_variant (row_variant);
+    ASSERT_TRUE (g_variant_is_of_type (row, G_VARIANT_TYPE ("(say)")));
+
+    char const *nick;
+    g_autoptr(GVariant) row_bytes = nullptr;
+    g_variant_get (row, "(&s@ay)", &nick, &row_bytes);
+
+    size_t n_bytes;
+    float const *row_values = static_cast <float const *> (g_variant_get_fixed_array (row_bytes,
+                                                                                       &n_bytes,
+                                                                                       1));
+    EXPECT_STREQ (nick, "float32");
+    EXPECT_THAT (std::vector <float> (row_values, row_values + n_bytes / sizeof (float)),
+                 ElementsAre (3.0f, 4.0f));
+  }
+
+  TEST (ScortchLocalTensor, packed_rows_round_trip) {
+    g_autoptr(GVariant) data = g_variant_ref_sink (nested_variant_arrays ({ 3, 2 }, "ad"));
+    g_autoptr(ScortchLocalTensor) source =
+      static_cast <ScortchLocalTensor *> (g_object_new (SCORTCH_TYPE_LOCAL_TENSOR,
+                                                        "dtype", SCORTCH_DTYPE_FLOAT16,
+                                                        "data", data,
+                                                        NULL));
+    g_autoptr(GVariant) packed = g_variant_ref_sink (scortch_local_tensor_get_data (source, nullptr));
+    g_autoptr(ScortchLocalTensor) destination = scortch_local_tensor_new ();
+    g_autoptr(GError) error = nullptr;
+
+    ASSERT_TRUE (scortch_local_tensor_set_data (destination, packed, &error));
+    ASSERT_THAT (error, IsNull ());
+
+    EXPECT_THAT (dimensions_of (destination), ElementsAre (3, 2));
+    EXPECT_EQ (bytes_of <double> (destination), flatten_element_wise (data));
+  }
+
+  TEST (ScortchLocalTensor, uint8_rows_are_native_byte_arrays) {
+    g_autoptr(GVariant) data =
+      g_variant_ref_sink (g_variant_new_parsed ("[<[byte 1, 2, 3]>, <[byte 4, 5, 6]>]"));
+    g_autoptr(ScortchLocalTensor) tensor =
+      static_cast <ScortchLocalTensor *> (g_object_new (SCORTCH_TYPE_LOCAL_TENSOR,
+                                                        "dtype", SCORTCH_DTYPE_UINT8,
+                                                        "data", data,
+                                                        NULL));
+    g_autoptr(GVariant) round_trip = g_variant_ref_sink (scortch_local_tensor_get_data (tensor, nullptr));
+
+    EXPECT_THAT (bytes_of <uint8_t> (tensor), ElementsAre (1, 2, 3, 4, 5, 6));
+    EXPECT_TRUE (g_variant_equal (data, round_trip));
+  }
+
+  TEST (ScortchLocalTensor, set_dtype_converts_elements) {
+    g_autoptr(GVariant) data = g_variant_ref_sink (g_variant_new_parsed ("[<[1.75, 2.25]>]"));
+    g_autoptr(ScortchLocalTensor) tensor = scortch_local_tensor_new ();
+
+    ASSERT_TRUE (scortch_local_tensor_set_data (tensor, data, nullptr));
+    scortch_local_tensor_set_dtype (tensor, SCORTCH_DTYPE_INT32);
+
+    EXPECT_EQ (scortch_local_tensor_get_dtype (tensor), SCORTCH_DTYPE_INT32);
+    EXPECT_THAT (bytes_of <int32_t> (tensor), ElementsAre (1, 2));
+  }
+
+  TEST (ScortchLocalTensor, get_data_round_trips_nested_arrays) {
+    g_autoptr(GVariant) data = g_variant_ref_sink (nested_variant_arrays ({ 2, 3, 4 }, "ad"));
+    g_autoptr(ScortchLocalTensor) tensor = scortch_local_tensor_new ();
+
+    ASSERT_TRUE (scortch_local_tensor_set_data (tensor, data, nullptr));
+
+    g_autoptr(GError) error = nullptr;
+    g_autoptr(GVariant) round_trip = g_variant_ref_sink (scortch_local_tensor_get_data (tensor, &error));
+
+    ASSERT_THAT (error, IsNull ());
+    EXPECT_TRUE (g_variant_equal (data, round_trip));
+  }
+
+  TEST (ScortchLocalTensor, get_data_rows_share_one_buffer) {
+    int64_t const values[] = { 1, 2, 3, 4, 5, 6 };
+    g_autoptr(GBytes) bytes = g_bytes_new (values, sizeof (values));
+    g_autoptr(ScortchLocalTensor) tensor =
+      scortch_local_tensor_new_from_bytes (bytes,
+                                           dimensions_variant ({ 3, 2 }),
+                                           SCORTCH_DTYPE_INT64,
+                                           nullptr);
+    g_autoptr(GVariant) data = g_variant_ref_sink (scortch_local_tensor_get_data (tensor, nullptr));
+
+    g_autoptr(GVariant) first_child = g_variant_get_child_value (data, 0);
+    g_autoptr(GVariant) second_child = g_variant_get_child_value (data, 1);
+    g_autoptr(GVariant) first_row = g_variant_get_variant (first_child);
+    g_autoptr(GVariant) second_row = g_variant_get_variant (second_child);
+
+    EXPECT_EQ (static_cast <char const *> (g_variant_get_data (first_row)) + 2 * sizeof (int64_t),
+               static_cast <char const *> (g_variant_get_data (second_row)));
+  }
+
+  TEST (ScortchLocalTensor, get_data_does_not_see_later_writes) {
+    g_autoptr(ScortchLocalTensor) tensor = tensor_from_values <double> ({ 1, 2 },
+                                                                        { 1, 2 },
+                                                                        SCORTCH_DTYPE_FLOAT64);
+    g_autoptr(GVariant) data = g_variant_ref_sink (scortch_local_tensor_get_data (tensor, nullptr));
+
+    /* The tensor is contiguous, but the variant is still a copy */
+    ASSERT_TRUE (scortch_local_tensor_fill (tensor, 0, nullptr));
+
+    g_autoptr(GVariant) expected = g_variant_ref_sink (g_variant_new_parsed ("[<[1.0, 2.0]>]"));
+
+    EXPECT_TRUE (g_variant_equal (data, expected));
+  }
+
+  TEST (ScortchLocalTensor, new_from_mapped_file) {
+    int64_t const values[] = { 0, 1, 2, 3, 4, 5, 6 };
+    g_autofree gchar *path = write_temporary_file (values, sizeof (values));
+    g_autoptr(GError) error = nullptr;
+    g_autoptr(ScortchLocalTensor) tensor =
+      scortch_local_tensor_new_from_mapped_file (path,
+                                                 dimensions_variant ({ 2, 3 }),
+                                                 SCORTCH_DTYPE_INT64,
+                                                 sizeof (int64_t),
+                                                 SCORTCH_MAPPED_FILE_FLAGS_NONE,
+                                                 &error);
+
+    g_unlink (path);
+
+    ASSERT_THAT (error, IsNull ());
+    EXPECT_THAT (dimensions_of (tensor), ElementsAre (2, 3));
+    EXPECT_THAT (bytes_of <int64_t> (tensor), ElementsAre (1, 2, 3, 4, 5, 6));
+  }
+
+  TEST (ScortchLocalTensor, new_from_mapped_file_copy_on_write) {
+    double const values[] = { 1.0, 2.0 };
+    g_autofree gchar *path = write_temporary_file (values, sizeof (values));
+    g_autoptr(GError) error = nullptr;
+    g_autoptr(ScortchLocalTensor) tensor =
+      scortch_local_tensor_new_from_mapped_file (path,
+                                                 dimensions_variant ({ 2 }),
+                                                 SCORTCH_DTYPE_FLOAT64,
+                                                 0,
+                                                 SCORTCH_MAPPED_FILE_FLAGS_COPY_ON_WRITE,
+                                                 &error);
+
+    g_unlink (path);
+
+    ASSERT_THAT (error, IsNull ());
+    EXPECT_THAT (bytes_of <double> (tensor), ElementsAre (1.0, 2.0));
+
+    ASSERT_TRUE (scortch_local_tensor_fill (tensor, 3.0, &error));
+    EXPECT_THAT (bytes_of <double> (tensor), ElementsAre (3.0, 3.0));
+  }
+
+  TEST (ScortchLocalTensor, new_from_mapped_file_read_only) {
+    double const values[] = { 1.0, 2.0 };
+    g_autofree gchar *path = write_temporary_file (values, sizeof (values));
+    g_autoptr(GError) error = nullptr;
+    g_autoptr(ScortchLocalTensor) tensor =
+      scortch_local_tensor_new_from_mapped_file (path,
+                                                 dimensions_variant ({ 2 }),
+                                                 SCORTCH_DTYPE_FLOAT64,
+                                                 0,
+                                                 SCORTCH_MAPPED_FILE_FLAGS_NONE,
+                                                 nullptr);
+
+    g_unlink (path);
+
+    EXPECT_FALSE (scortch_local_tensor_fill (tensor, 0, &error));
+    EXPECT_TRUE (g_error_matches (error, SCORTCH_ERROR, SCORTCH_ERROR_INVALID_OPERATION));
+    EXPECT_THAT (bytes_of <double> (tensor), ElementsAre (1.0, 2.0));
+  }
+
+  TEST (ScortchLocalTensor, new_from_mapped_file_too_short) {
+    double const values[] = { 1.0, 2.0, 3.0 };
+    g_autofree gchar *path = write_temporary_file (values, sizeof (values));
+    g_autoptr(GError) error = nullptr;
+    g_autoptr(ScortchLocalTensor) tensor =
+      scortch_local_tensor_new_from_mapped_file (path,
+                                                 dimensions_variant ({ 3 }),
+                                                 SCORTCH_DTYPE_FLOAT64,
+                                                 sizeof (double),
+                                                 SCORTCH_MAPPED_FILE_FLAGS_NONE,
+                                                 &error);
+
+    g_unlink (path);
+
+    EXPECT_THAT (tensor, IsNull ());
+    EXPECT_TRUE (g_error_matches (error, SCORTCH_ERROR, SCORTCH_ERROR_INVALID_DIMENSIONS));
+  }
+
+  TEST (ScortchLocalTensor, new_from_mapped_file_overflowing_dimensions) {
+    double const values[] = { 1.0, 2.0, 3.0 };
+    g_autofree gchar *path = write_temporary_file (values, sizeof (values));
+    g_autoptr(GError) error = nullptr;
+
+    /* Unchecked, the size would wrap around to 16 bytes, which fits */
+    g_autoptr(ScortchLocalTensor) tensor =
+      scortch_local_tensor_new_from_mapped_file (path,
+                                                 dimensions_variant ({ (G_GINT64_CONSTANT (1) << 61) + 2 }),
+                                                 SCORTCH_DTYPE_FLOAT64,
+                                                 0,
+                                                 SCORTCH_MAPPED_FILE_FLAGS_NONE,
+                                                 &error);
+
+    g_unlink (path);
+
+    EXPECT_THAT (tensor, IsNull ());
+    EXPECT_TRUE (g_error_matches (error, SCORTCH_ERROR, SCORTCH_ERROR_INVALID_DIMENSIONS));
+  }
+
+  TEST (ScortchLocalTensor, new_from_mapped_file_missing) {
+    g_autoptr(GError) error = nullptr;
+    g_autoptr(ScortchLocalTensor) tensor =
+      scortch_local_tensor_new_from_mapped_file ("/nonexistent/scortch-tensor",
+                                                 dimensions_variant ({ 1 }),
+                                                 SCORTCH_DTYPE_FLOAT64,
+                                                 0,
+                                                 SCORTCH_MAPPED_FILE_FLAGS_NONE,
+                                                 &error);
+
+    EXPECT_THAT (tensor, IsNull ());
+    EXPECT_TRUE (g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT));
+  }
+
+  TEST (ScortchLocalTensor, reserve_keeps_dimensions_and_data) {
+    g_autoptr(GError) error = nullptr;
+    g_autoptr(ScortchLocalTensor) tensor = tensor_from_values <double> ({ 1, 2, 3, 4 },
+                                                                        { 2, 2 },
+                                                                        SCORTCH_DTYPE_FLOAT64);
+
+    ASSERT_TRUE (scortch_local_tensor_reserve (tensor, 10, &error));
+
+    EXPECT_THAT (scortch_local_tensor_get_capacity (tensor), Eq (10));
+    EXPECT_THAT (dimensions_of (tensor), ElementsAre (2, 2));
+    EXPECT_THAT (bytes_of <double> (tensor), ElementsAre (1, 2, 3, 4));
+  }
+
+  TEST (ScortchLocalTensor, reserve_never_shrinks) {
+    g_autoptr(GError) error = nullptr;
+    g_autoptr(ScortchLocalTensor) tensor = tensor_from_values <double> ({ 1, 2, 3 },
+                                                                        { 3 },
+                                                                        SCORTCH_DTYPE_FLOAT64);
+
+    ASSERT_TRUE (scortch_local_tensor_reserve (tensor, 1, &error));
+
+    EXPECT_THAT (scortch_local_tensor_get_capacity (tensor), Eq (3));
+    EXPECT_THAT (bytes_of <double> (tensor), ElementsAre (1, 2, 3));
+  }
+
+  TEST (ScortchLocalTensor, reserve_too_much_fails) {
+    g_autoptr(GError) error = nullptr;
+    g_autoptr(ScortchLocalTensor) tensor = tensor_from_values <double> ({ 1, 2, 3, 4 },
+                                                                        { 2, 2 },
+                                                                        SCORTCH_DTYPE_FLOAT64);
+
+    EXPECT_FALSE (scortch_local_tensor_reserve (tensor, G_MAXINT64 / 2, &error));
+    EXPECT_TRUE (g_error_matches (error, SCORTCH_ERROR, SCORTCH_ERROR_INVALID_OPERATION));
+    EXPECT_THAT (scortch_local_tensor_get_capacity (tensor), Eq (2));
+    EXPECT_THAT (bytes_of <double> (tensor), ElementsAre (1, 2, 3, 4));
+  }
+
+  TEST (ScortchLocalTensor, append_rows_from_variant) {
+    g_autoptr(GError) error = nullptr;
+    g_autoptr(ScortchLocalTensor) tensor = tensor_from_values <double> ({ 1, 2 },
+                                                                        { 1, 2 },
+                                                                        SCORTCH_DTYPE_FLOAT64);
+
+    ASSERT_TRUE (scortch_local_tensor_append_rows (tensor,
+                                                   g_variant_new_parsed ("[<[3.0, 4.0]>, <[5.0, 6.0]>]"),
+                                                   &error));
+
+    EXPECT_THAT (dimensions_of (tensor), ElementsAre (3, 2));
+    EXPECT_THAT (bytes_of <double> (tensor), ElementsAre (1, 2, 3, 4, 5, 6));
+  }
+
+  TEST (ScortchLocalTensor, append_rows_converts_to_dtype) {
+    g_autoptr(GError) error = nullptr;
+    g_autoptr(ScortchLocalTensor) tensor = tensor_from_values <int64_t> ({ 1, 2 },
+                                                                         { 1, 2 },
+                                                                         SCORTCH_DTYPE_INT64);
+
+    ASSERT_TRUE (scortch_local_tensor_append_rows (tensor,
+                                                   g_variant_new_parsed ("[<[3.0, 4.0]>]"),
+                                                   &error));
+
+    EXPECT_THAT (scortch_local_tensor_get_dtype (tensor), Eq (SCORTCH_DTYPE_INT64));
+    EXPECT_THAT (bytes_of <int64_t> (tensor), ElementsAre (1, 2, 3, 4));
+  }
+
+  TEST (ScortchLocalTensor, append_rows_from_bytes) {
+    g_autoptr(GError) error = nullptr;
+    g_autoptr(ScortchLocalTensor) tensor = tensor_from_values <float> ({ 1, 2 },
+                                                                       { 1, 2 },
+                                                                       SCORTCH_DTYPE_FLOAT32);
+    float const values[] = { 3, 4, 5, 6 };
+    g_autoptr(GBytes) bytes = g_bytes_new (values, sizeof (values));
+
+    ASSERT_TRUE (scortch_local_tensor_append_rows_from_bytes (tensor, bytes, &error));
+
+    EXPECT_THAT (dimensions_of (tensor), ElementsAre (3, 2));
+    EXPECT_THAT (bytes_of <float> (tensor), ElementsAre (1, 2, 3, 4, 5, 6));
+  }
+
+  TEST (ScortchLocalTensor, append_one_row_at_a_time_grows_geometrically) {
+    g_autoptr(ScortchLocalTensor) tensor =
+      SCORTCH_LOCAL_TENSOR (g_object_new (SCORTCH_TYPE_LOCAL_TENSOR,
+                                          "dimensions", dimensions_variant ({ 0, 2 }),
+                                          NULL));
+    std::vector <double> expected;
+    int n_reallocations = 0;
+    gint64 capacity = scortch_local_tensor_get_capacity (tensor);
+
+    for (int i = 0; i < 1000; ++i)
+      {
+        g_autoptr(GError) error = nullptr;
+        double const row[] = { static_cast <double> (i), static_cast <double> (-i) };
+        g_autoptr(GBytes) bytes = g_bytes_new (row, sizeof (row));
+
+        ASSERT_TRUE (scortch_local_tensor_append_rows_from_bytes (tensor, bytes, &error));
+
+        if (scortch_local_tensor_get_capacity (tensor) != capacity)
+          {
+            capacity = scortch_local_tensor_get_capacity (tensor);
+            ++n_reallocations;
+          }
+
+        expected.insert (expected.end (), row, row + 2);
+      }
+
+    EXPECT_THAT (dimensions_of (tensor), ElementsAre (1000, 2));
+    EXPECT_THAT (bytes_of <double> (tensor), Eq (expected));
+    EXPECT_THAT (capacity, Ge (1000));
+    EXPECT_THAT (n_reallocations, Eq (11));
+  }
+
+  TEST (ScortchLocalTensor, append_rows_within_reservation_does_not_reallocate) {
+    g_autoptr(GError) error = nullptr;
+    g_autoptr(ScortchLocalTensor) tensor = tensor_from_values <double> ({ 1 },
+                                                                        { 1 },
+                                                                        SCORTCH_DTYPE_FLOAT64);
+
+    ASSERT_TRUE (scortch_local_tensor_reserve (tensor, 4, &error));
+
+    for (double value : { 2.0, 3.0, 4.0 })
+      {
+        g_autoptr(GBytes) bytes = g_bytes_new (&value, sizeof (value));
+        ASSERT_TRUE (scortch_local_tensor_append_rows_from_bytes (tensor, bytes, &error));
+      }
+
+    EXPECT_THAT (scortch_local_tensor_get_capacity (tensor), Eq (4));
+    EXPECT_THAT (bytes_of <double> (tensor), ElementsAre (1, 2, 3, 4));
+  }
+
+  TEST (ScortchLocalTensor, set_data_drops_reservation) {
+    g_autoptr(GError) error = nullptr;
+    g_autoptr(ScortchLocalTensor) tensor = tensor_from_values <double> ({ 1, 2 },
+                                                                        { 2 },
+                                                                        SCORTCH_DTYPE_FLOAT64);
+
+    ASSERT_TRUE (scortch_local_tensor_reserve (tensor, 8, &error));
+    ASSERT_TRUE (scortch_local_tensor_set_data (tensor,
+                                                g_variant_new_parsed ("[3.0, 4.0, 5.0]"),
+                                                &error));
+
+    EXPECT_THAT (scortch_local_tensor_get_capacity (tensor), Eq (3));
+  }
+
+  TEST (ScortchLocalTensor, append_rows_mismatched_row_dimensions) {
+    g_autoptr(GError) error = nullptr;
+    g_autoptr(ScortchLocalTensor) tensor = tensor_from_values <double> ({ 1, 2 },
+                                                                        { 1, 2 },
+                                                                        SCORTCH_DTYPE_FLOAT64);
+
+    EXPECT_FALSE (scortch_local_tensor_append_rows (tensor,
+                                                    g_variant_new_parsed ("[<[3.0, 4.0, 5.0]>]"),
+                                                    &error));
+    EXPECT_TRUE (g_error_matches (error, SCORTCH_ERROR, SCORTCH_ERROR_INVALID_DIMENSIONS));
+    EXPECT_THAT (bytes_of <double> (tensor), ElementsAre (1, 2));
+  }
+
+  TEST (ScortchLocalTensor, append_rows_from_bytes_partial_row) {
+    g_autoptr(GError) error = nullptr;
+    g_autoptr(ScortchLocalTensor) tensor = tensor_from_values <double> ({ 1, 2 },
+                                                                        { 1, 2 },
+                                                                        SCORTCH_DTYPE_FLOAT64);
+    double const value = 3;
+    g_autoptr(GBytes) bytes = g_bytes_new (&value, sizeof (value));
+
+    EXPECT_FALSE (scortch_local_tensor_append_rows_from_bytes (tensor, bytes, &error));
+    EXPECT_TRUE (g_error_matches (error, SCORTCH_ERROR, SCORTCH_ERROR_INVALID_DIMENSIONS));
+    EXPECT_THAT (dimensions_of (tensor), ElementsAre (1, 2));
+  }
 }
@@ -0,0 +1,424 @@
+/*
+ * /tests/scortch/local-tensor-unix-test.cpp
+ *
+ * Tests for passing ScortchLocalTensor between processes
+ * as memfd file descriptors.
+ *
+ * Copyright (C) 2018 Sam Spilsbury.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <gio/gio.h>
+#include <gio/gunixfdlist.h>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <scortch/local-tensor.h>
+#include <scortch/local-tensor-operations.h>
+#include <scortch/local-tensor-unix.h>
+#include <scortch/scortch-errors.h>
+
+#include <scortch/tensor-test-helpers.h>
+
+using ::testing::ElementsAre;
+using ::testing::IsNull;
+using ::testing::Not;
+
+using scortch_test::bytes_of;
+using scortch_test::dimensions_of;
+using scortch_test::tensor_from_values;
+
+namespace {
+  void store_result (GObject      *source_object G_GNUC_UNUSED,
+                     GAsyncResult *result,
+                     gpointer      user_data)
+  {
+    *static_cast <GAsyncResult **> (user_data) = G_ASYNC_RESULT (g_object_ref (result));
+  }
+
+  /* Spin the default main context until store_result is called */
+  GAsyncResult * iterate_until_result (GAsyncResult **result)
+  {
+    while (*result == nullptr)
+      g_main_context_iteration (nullptr, TRUE);
+
+    return *result;
+  }
+
+  std::vector <int64_t> strides_of_header (GVariant *header)
+  {
+    g_autoptr(GVariant) strides = g_variant_get_child_value (header, 2);
+    size_t n_strides;
+    int64_t const *data = static_cast <int64_t const *> (g_variant_get_fixed_array (strides,
+                                                                                   &n_strides,
+                                                                                   sizeof (int64_t)));
+
+    return std::vector <int64_t> (data, data + n_strides);
+  }
+
+  /* A header for a [n_elements] float64 tensor in fd, which is
+   * appended to fd_list. */
+  GVariant * header_for_fd (GUnixFDList *fd_list, int fd, int64_t n_elements)
+  {
+    int64_t const stride = 1;
+    int index = g_unix_fd_list_append (fd_list, fd, nullptr);
+
+    return g_variant_new ("(@axs@axh)",
+                          g_variant_new_fixed_array (G_VARIANT_TYPE_INT64, &n_elements, 1, sizeof (int64_t)),
+                          "float64",
+                          g_variant_new_fixed_array (G_VARIANT_TYPE_INT64, &stride, 1, sizeof (int64_t)),
+                          index);
+  }
+
+  char const *tensor_sink_xml =
+    "<node>"
+    "  <interface name='org.scortch.TensorSink'>"
+    "    <method name='Send'>"
+    "      <arg type='(axsaxh)' name='tensor' direction='in'/>"
+    "    </method>"
+    "  </interface>"
+    "</node>";
+
+  /* Receives tensors sent to org.scortch.TensorSink.Send and
+   * keeps the last one. */
+  void handle_send (GDBusConnection       *connection G_GNUC_UNUSED,
+                    const char            *sender G_GNUC_UNUSED,
+                    const char            *object_path G_GNUC_UNUSED,
+                    const char            *interface_name G_GNUC_UNUSED,
+                    const char            *method_name G_GNUC_UNUSED,
+                    GVariant              *parameters,
+                    GDBusMethodInvocation *invocation,
+                    gpointer               user_data)
+  {
+    ScortchLocalTensor **received = static_cast <ScortchLocalTensor **> (user_data);
+    GUnixFDList *fd_list = g_dbus_message_get_unix_fd_list (g_dbus_method_invocation_get_message (invocation));
+    g_autoptr(GVariant) header = g_variant_get_child_value (parameters, 0);
+    GError *error = nullptr;
+
+    g_clear_object (received);
+    *received = scortch_local_tensor_new_from_fd_variant (header, fd_list, &error);
+
+    if (*received == nullptr)
+      g_dbus_method_invocation_take_error (invocation, error);
+    else
+      g_dbus_method_invocation_return_value (invocation, nullptr);
+  }
+
+  /* A pair of peer-to-peer D-Bus connections over a socketpair,
+   * with a tensor sink exported on the server end. */
+  class ScortchLocalTensorDBusTest :
+    public ::testing::Test
+  {
+    protected:
+      void SetUp () override
+      {
+        g_autoptr(GError) error = nullptr;
+        int fds[2];
+
+        ASSERT_EQ (socketpair (AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds), 0);
+
+        g_autoptr(GSocket) server_socket = g_socket_new_from_fd (fds[0], &error);
+        ASSERT_THAT (server_socket, Not (IsNull ())) << error->message;
+        g_autoptr(GSocket) client_socket = g_socket_new_from_fd (fds[1], &error);
+        ASSERT_THAT (client_socket, Not (IsNull ())) << error->message;
+
+        g_autoptr(GSocketConnection) server_stream = g_socket_connection_factory_create_connection (server_socket);
+        g_autoptr(GSocketConnection) client_stream = g_socket_connection_factory_create_connection (client_socket);
+        g_autofree char *guid = g_dbus_generate_guid ();
+        g_autoptr(GAsyncResult) server_result = nullptr;
+        g_autoptr(GAsyncResult) client_result = nullptr;
+
+        /* Both ends have to authenticate at the same time, so
+         * they are set up asynchronously on the same context. */
+        g_dbus_connection_new (G_IO_STREAM (server_stream),
+                               guid,
+                               G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_SERVER,
+                               nullptr,
+                               nullptr,
+                               store_result,
+                               &server_result);
+        g_dbus_connection_new (G_IO_STREAM (client_stream),
+                               nullptr,
+                               G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT,
+                               nullptr,
+                               nullptr,
+                               store_result,
+                               &client_result);
+
+        server = g_dbus_connection_new_finish (iterate_until_result (&server_result), &error);
+        ASSERT_THAT (server, Not (IsNull ())) << error->message;
+        client = g_dbus_connection_new_finish (iterate_until_result (&client_result), &error);
+        ASSERT_THAT (client, Not (IsNull ())) << error->message;
+
+        node_info = g_dbus_node_info_new_for_xml (tensor_sink_xml, &error);
+        ASSERT_THAT (node_info, Not (IsNull ())) << error->message;
+
+        static GDBusInterfaceVTable const vtable = { handle_send, nullptr, nullptr };
+        registration_id = g_dbus_connection_register_object (server,
+                                                             "/org/scortch/TensorSink",
+                                                             node_info->interfaces[0],
+                                                             &vtable,
+                                                             &received,
+                                                             nullptr,
+                                                             &error);
+        ASSERT_NE (registration_id, 0u) << error->message;
+      }
+
+      void TearDown () override
+      {
+        if (registration_id != 0)
+          g_dbus_connection_unregister_object (server, registration_id);
+
+        g_clear_pointer (&node_info, g_dbus_node_info_unref);
+        g_clear_object (&received);
+        g_clear_object (&client);
+        g_clear_object (&server);
+      }
+
+      /* Send local_tensor to the sink and wait for the reply */
+      bool send (ScortchLocalTensor *local_tensor, GError **error)
+      {
+        g_autoptr(GUnixFDList) fd_list = g_unix_fd_list_new ();
+        GVariant *header = scortch_local_tensor_to_fd_variant (local_tensor, fd_list, error);
+        g_autoptr(GAsyncResult) result = nullptr;
+
+        if (header == nullptr)
+          return false;
+
+        g_dbus_connection_call_with_unix_fd_list (client,
+                                                  nullptr,
+                                                  "/org/scortch/TensorSink",
+                                                  "org.scortch.TensorSink",
+                                                  "Send",
+                                                  g_variant_new ("(@(axsaxh))", header),
+                                                  nullptr,
+                                                  G_DBUS_CALL_FLAGS_NONE,
+                                                  -1,
+                                                  fd_list,
+                                                  nullptr,
+                                                  store_result,
+                                                  &result);
+
+        g_autoptr(GVariant) reply =
+          g_dbus_connection_call_with_unix_fd_list_finish (client,
+                                                           nullptr,
+                                                           iterate_until_result (&result),
+                                                           error);
+
+        return reply != nullptr;
+      }
+
+      GDBusConnection *server = nullptr;
+      GDBusConnection *client = nullptr;
+      GDBusNodeInfo *node_info = nullptr;
+      guint registration_id = 0;
+      ScortchLocalTensor *received = nullptr;
+  };
+}
+
+TEST (ScortchLocalTensorUnix, round_trip)
+{
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(GUnixFDList) fd_list = g_unix_fd_list_new ();
+  g_autoptr(ScortchLocalTensor) tensor = tensor_from_values <float> ({ 1, 2, 3, 4, 5, 6 },
+                                                                     { 2, 3 },
+                                                                     SCORTCH_DTYPE_FLOAT32);
+  g_autoptr(GVariant) header = g_variant_ref_sink (scortch_local_tensor_to_fd_variant (tensor, fd_list, &error));
+
+  ASSERT_THAT (header, Not (IsNull ())) << error->message;
+  EXPECT_THAT (strides_of_header (header), ElementsAre (3, 1));
+
+  g_autoptr(ScortchLocalTensor) received = scortch_local_tensor_new_from_fd_variant (header, fd_list, &error);
+
+  ASSERT_THAT (received, Not (IsNull ())) << error->message;
+  EXPECT_EQ (scortch_local_tensor_get_dtype (received), SCORTCH_DTYPE_FLOAT32);
+  EXPECT_THAT (dimensions_of (received), ElementsAre (2, 3));
+  EXPECT_THAT (bytes_of <float> (received), ElementsAre (1, 2, 3, 4, 5, 6));
+}
+
+TEST (ScortchLocalTensorUnix, transposed_tensor_keeps_strides)
+{
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(GUnixFDList) fd_list = g_unix_fd_list_new ();
+  g_autoptr(ScortchLocalTensor) matrix = tensor_from_values <int64_t> ({ 1, 2, 3, 4, 5, 6 },
+                                                                       { 2, 3 },
+                                                                       SCORTCH_DTYPE_INT64);
+  g_autoptr(ScortchLocalTensor) transposed = scortch_local_tensor_transpose (matrix, 0, 1, nullptr);
+  g_autoptr(GVariant) header = g_variant_ref_sink (scortch_local_tensor_to_fd_variant (transposed, fd_list, &error));
+
+  ASSERT_THAT (header, Not (IsNull ())) << error->message;
+  EXPECT_THAT (strides_of_header (header), ElementsAre (1, 3));
+
+  g_autoptr(ScortchLocalTensor) received = scortch_local_tensor_new_from_fd_variant (header, fd_list, &error);
+
+  ASSERT_THAT (received, Not (IsNull ())) << error->message;
+  EXPECT_THAT (dimensions_of (received), ElementsAre (3, 2));
+  EXPECT_THAT (bytes_of <int64_t> (received), ElementsAre (1, 4, 2, 5, 3, 6));
+}
+
+TEST (ScortchLocalTensorUnix, received_tensor_is_copy_on_write)
+{
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(GUnixFDList) fd_list = g_unix_fd_list_new ();
+  g_autoptr(ScortchLocalTensor) tensor = tensor_from_values <double> ({ 1, 2 },
+                                                                      { 2 },
+                                                                      SCORTCH_DTYPE_FLOAT64);
+  g_autoptr(GVariant) header = g_variant_ref_sink (scortch_local_tensor_to_fd_variant (tensor, fd_list, &error));
+  g_autoptr(ScortchLocalTensor) first = scortch_local_tensor_new_from_fd_variant (header, fd_list, &error);
+
+  ASSERT_THAT (first, Not (IsNull ())) << error->message;
+  ASSERT_TRUE (scortch_local_tensor_fill (first, 0, nullptr));
+
+  g_autoptr(ScortchLocalTensor) second = scortch_local_tensor_new_from_fd_variant (header, fd_list, &error);
+
+  ASSERT_THAT (second, Not (IsNull ())) << error->message;
+  EXPECT_THAT (bytes_of <double> (first), ElementsAre (0, 0));
+  EXPECT_THAT (bytes_of <double> (second), ElementsAre (1, 2));
+}
+
+TEST (ScortchLocalTensorUnix, empty_tensor)
+{
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(GUnixFDList) fd_list = g_unix_fd_list_new ();
+  g_autoptr(ScortchLocalTensor) tensor = scortch_local_tensor_new ();
+  g_autoptr(GVariant) header = g_variant_ref_sink (scortch_local_tensor_to_fd_variant (tensor, fd_list, &error));
+
+  ASSERT_THAT (header, Not (IsNull ())) << error->message;
+
+  g_autoptr(ScortchLocalTensor) received = scortch_local_tensor_new_from_fd_variant (header, fd_list, &error);
+
+  ASSERT_THAT (received, Not (IsNull ())) << error->message;
+  EXPECT_THAT (dimensions_of (received), ElementsAre (0));
+}
+
+TEST (ScortchLocalTensorUnix, unsealed_fd_is_rejected)
+{
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(GUnixFDList) fd_list = g_unix_fd_list_new ();
+  int fd = memfd_create ("unsealed", MFD_CLOEXEC);
+
+  ASSERT_NE (fd, -1);
+  ASSERT_EQ (ftruncate (fd, 2 * sizeof (double)), 0);
+
+  g_autoptr(GVariant) header = g_variant_ref_sink (header_for_fd (fd_list, fd, 2));
+  close (fd);
+
+  g_autoptr(ScortchLocalTensor) received = scortch_local_tensor_new_from_fd_variant (header, fd_list, &error);
+
+  EXPECT_THAT (received, IsNull ());
+  EXPECT_TRUE (g_error_matches (error, SCORTCH_ERROR, SCORTCH_ERROR_MALFORMED_DATA));
+}
+
+TEST (ScortchLocalTensorUnix, short_fd_is_rejected)
+{
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(GUnixFDList) fd_list = g_unix_fd_list_new ();
+  g_autoptr(ScortchLocalTensor) tensor = tensor_from_values <double> ({ 1, 2 },
+                                                                      { 2 },
+                                                                      SCORTCH_DTYPE_FLOAT64);
+  g_autoptr(GVariant) header = g_variant_ref_sink (scortch_local_tensor_to_fd_variant (tensor, fd_list, &error));
+
+  ASSERT_THAT (header, Not (IsNull ())) << error->message;
+
+  /* Claim more elements than the sealed memfd holds */
+  g_autoptr(GVariant) lying_header = g_variant_ref_sink (header_for_fd (fd_list,
+                                                                        g_unix_fd_list_peek_fds (fd_list, nullptr)[0],
+                                                                        3));
+  g_autoptr(ScortchLocalTensor) received = scortch_local_tensor_new_from_fd_variant (lying_header, fd_list, &error);
+
+  EXPECT_THAT (received, IsNull ());
+  EXPECT_TRUE (g_error_matches (error, SCORTCH_ERROR, SCORTCH_ERROR_INVALID_DIMENSIONS));
+}
+
+TEST (ScortchLocalTensorUnix, malformed_header_is_rejected)
+{
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(GUnixFDList) fd_list = g_unix_fd_list_new ();
+  g_autoptr(ScortchLocalTensor) received =
+    scortch_local_tensor_new_from_fd_variant (g_variant_new_parsed ("[1.0, 2.0]"), fd_list, &error);
+
+  EXPECT_THAT (received, IsNull ());
+  EXPECT_TRUE (g_error_matches (error, SCORTCH_ERROR, SCORTCH_ERROR_MALFORMED_DATA));
+}
+
+TEST (ScortchLocalTensorUnix, overflowing_header_is_rejected)
+{
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(GUnixFDList) fd_list = g_unix_fd_list_new ();
+  int64_t const dimensions[] = { (G_GINT64_CONSTANT (1) << 61) + 1 };
+  int64_t const strides[] = { 8 };
+
+  /* The last element is 2^64 elements from the first */
+  GVariant *header = g_variant_new ("(@axs@axh)",
+                                    g_variant_new_fixed_array (G_VARIANT_TYPE_INT64,
+                                                               dimensions,
+                                                               G_N_ELEMENTS (dimensions),
+                                                               sizeof (int64_t)),
+                                    "float64",
+                                    g_variant_new_fixed_array (G_VARIANT_TYPE_INT64,
+                                                               strides,
+                                                               G_N_ELEMENTS (strides),
+                                                               sizeof (int64_t)),
+                                    0);
+  g_autoptr(ScortchLocalTensor) received =
+    scortch_local_tensor_new_from_fd_variant (header, fd_list, &error);
+
+  EXPECT_THAT (received, IsNull ());
+  EXPECT_TRUE (g_error_matches (error, SCORTCH_ERROR, SCORTCH_ERROR_INVALID_DIMENSIONS));
+}
+
+TEST (ScortchLocalTensorUnix, out_of_range_fd_index_is_rejected)
+{
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(GUnixFDList) fd_list = g_unix_fd_list_new ();
+  int64_t const dimensions[] = { 2 };
+  int64_t const strides[] = { 1 };
+  GVariant *header = g_variant_new ("(@axs@axh)",
+                                    g_variant_new_fixed_array (G_VARIANT_TYPE_INT64,
+                                                               dimensions,
+                                                               G_N_ELEMENTS (dimensions),
+                                                               sizeof (int64_t)),
+                                    "float64",
+                                    g_variant_new_fixed_array (G_VARIANT_TYPE_INT64,
+                                                               strides,
+                                                               G_N_ELEMENTS (strides),
+                                                               sizeof (int64_t)),
+                                    3);
+  g_autoptr(ScortchLocalTensor) received =
+    scortch_local_tensor_new_from_fd_variant (header, fd_list, &error);
+
+  EXPECT_THAT (received, IsNull ());
+  EXPECT_TRUE (g_error_matches (error, SCORTCH_ERROR, SCORTCH_ERROR_MALFORMED_DATA));
+}
+
+TEST_F (ScortchLocalTensorDBusTest, send_over_peer_to_peer_connection)
+{
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(ScortchLocalTensor) tensor = tensor_from_values <double> ({ 1, 2, 3, 4 },
+                                                                      { 2, 2 },
+                                                                      SCORTCH_DTYPE_FLOAT64);
+
+  ASSERT_TRUE (send (tensor, &error)) << error->message;
+
+  ASSERT_THAT (received, Not (IsNull ()));
+  EXPECT_THAT (dimensions_of (received), ElementsAre (2, 2));
+  EXPECT_THAT (bytes_of <double> (received), ElementsAre (1, 2, 3, 4));
+}
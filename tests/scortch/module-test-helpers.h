@@ -0,0 +1,75 @@
+/*
+ * /tests/scortch/module-test-helpers.h
+ *
+ * Helpers to create TorchScript modules for tests.
+ *
+ * Copyright (C) 2018 Sam Spilsbury.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <unistd.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <gtest/gtest.h>
+
+#include <torch/script.h>
+#include <torch/torch.h>
+
+namespace scortch_test
+{
+  /* Saves a module computing x * weight + 1, with weight a
+   * float64 parameter of [2] filled with 2, to a temporary
+   * file which is removed again on TearDown. Fixtures can
+   * override forward_source to save a different forward. */
+  class TemporaryModuleTest :
+    public ::testing::Test
+  {
+    protected:
+      void SetUp () override
+      {
+        g_autoptr(GError) error = nullptr;
+        int fd = g_file_open_tmp ("scortch-module-XXXXXX.pt", &path, &error);
+
+        ASSERT_NE (fd, -1) << error->message;
+        close (fd);
+
+        torch::jit::Module module ("TestModule");
+        module.register_parameter ("weight",
+                                   torch::full ({ 2 }, 2.0, torch::kFloat64),
+                                   false);
+        module.define (forward_source ());
+        module.save (path);
+      }
+
+      void TearDown () override
+      {
+        g_unlink (path);
+        g_free (path);
+      }
+
+      virtual char const * forward_source () const
+      {
+        return "def forward(self, x):\n"
+               "    return x * self.weight + 1\n";
+      }
+
+      char *path = nullptr;
+  };
+}
@@ -0,0 +1,184 @@
+/*
+ * /tests/scortch/module-test.cpp
+ *
+ * Tests for the GObject Binding to TorchScript modules.
+ *
+ * Copyright (C) 2018 Sam Spilsbury.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <gio/gio.h>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <scortch/local-tensor.h>
+#include <scortch/module.h>
+#include <scortch/scortch-errors.h>
+
+#include <scortch/module-test-helpers.h>
+#include <scortch/tensor-test-helpers.h>
+
+using ::testing::ElementsAre;
+using ::testing::IsNull;
+using ::testing::Not;
+
+using scortch_test::bytes_of;
+using scortch_test::tensor_from_values;
+
+using ScortchModuleTest = scortch_test::TemporaryModuleTest;
+
+class ScortchRaisingModuleTest :
+  public scortch_test::TemporaryModuleTest
+{
+  protected:
+    char const * forward_source () const override
+    {
+      return "def forward(self, x):\n"
+             "    raise Exception(\"forward failed\")\n"
+             "    return x\n";
+    }
+};
+
+namespace {
+  void store_result (GObject      *source_object G_GNUC_UNUSED,
+                     GAsyncResult *result,
+                     gpointer      user_data)
+  {
+    *static_cast <GAsyncResult **> (user_data) = G_ASYNC_RESULT (g_object_ref (result));
+  }
+}
+
+TEST_F (ScortchModuleTest, forward)
+{
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(ScortchModule) module = scortch_module_new_from_file (path, &error);
+  g_autoptr(ScortchLocalTensor) input = tensor_from_values <double> ({ 1, 2, 3, 4 },
+                                                                     { 2, 2 },
+                                                                     SCORTCH_DTYPE_FLOAT64);
+
+  ASSERT_THAT (module, Not (IsNull ()));
+
+  g_autoptr(ScortchLocalTensor) output = scortch_module_forward (module, &input, 1, &error);
+
+  ASSERT_THAT (output, Not (IsNull ()));
+  EXPECT_THAT (bytes_of <double> (output), ElementsAre (3, 5, 7, 9));
+}
+
+TEST_F (ScortchModuleTest, eval_and_freeze)
+{
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(ScortchModule) module = scortch_module_new_from_file (path, &error);
+  g_autoptr(ScortchLocalTensor) input = tensor_from_values <double> ({ 1, 2 },
+                                                                     { 2 },
+                                                                     SCORTCH_DTYPE_FLOAT64);
+
+  ASSERT_THAT (module, Not (IsNull ()));
+  EXPECT_TRUE (scortch_module_get_training (module));
+
+  scortch_module_eval (module);
+  EXPECT_FALSE (scortch_module_get_training (module));
+
+  ASSERT_TRUE (scortch_module_freeze (module, &error));
+  EXPECT_TRUE (scortch_module_get_frozen (module));
+
+  g_autoptr(ScortchLocalTensor) output = scortch_module_forward (module, &input, 1, &error);
+
+  ASSERT_THAT (output, Not (IsNull ()));
+  EXPECT_THAT (bytes_of <double> (output), ElementsAre (3, 5));
+}
+
+TEST_F (ScortchModuleTest, forward_async)
+{
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(ScortchModule) module = scortch_module_new_from_file (path, &error);
+  g_autoptr(ScortchLocalTensor) input = tensor_from_values <double> ({ 1, 2 },
+                                                                     { 2 },
+                                                                     SCORTCH_DTYPE_FLOAT64);
+  g_autoptr(GAsyncResult) result = nullptr;
+
+  ASSERT_THAT (module, Not (IsNull ()));
+
+  scortch_module_forward_async (module, &input, 1, nullptr, store_result, &result);
+
+  while (result == nullptr)
+    g_main_context_iteration (nullptr, TRUE);
+
+  g_autoptr(ScortchLocalTensor) output = scortch_module_forward_finish (module, result, &error);
+
+  ASSERT_THAT (output, Not (IsNull ()));
+  EXPECT_THAT (bytes_of <double> (output), ElementsAre (3, 5));
+}
+
+TEST_F (ScortchModuleTest, forward_with_wrong_arguments_sets_error)
+{
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(ScortchModule) module = scortch_module_new_from_file (path, &error);
+
+  ASSERT_THAT (module, Not (IsNull ()));
+
+  g_autoptr(ScortchLocalTensor) output = scortch_module_forward (module, nullptr, 0, &error);
+
+  EXPECT_THAT (output, IsNull ());
+  EXPECT_TRUE (g_error_matches (error, SCORTCH_ERROR, SCORTCH_ERROR_INVALID_OPERATION));
+}
+
+TEST_F (ScortchRaisingModuleTest, exception_in_forward_sets_error)
+{
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(ScortchModule) module = scortch_module_new_from_file (path, &error);
+  g_autoptr(ScortchLocalTensor) input = tensor_from_values <double> ({ 1, 2 },
+                                                                     { 2 },
+                                                                     SCORTCH_DTYPE_FLOAT64);
+
+  ASSERT_THAT (module, Not (IsNull ()));
+
+  g_autoptr(ScortchLocalTensor) output = scortch_module_forward (module, &input, 1, &error);
+
+  EXPECT_THAT (output, IsNull ());
+  EXPECT_TRUE (g_error_matches (error, SCORTCH_ERROR, SCORTCH_ERROR_INVALID_OPERATION));
+}
+
+TEST_F (ScortchRaisingModuleTest, exception_in_forward_async_sets_error)
+{
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(ScortchModule) module = scortch_module_new_from_file (path, &error);
+  g_autoptr(ScortchLocalTensor) input = tensor_from_values <double> ({ 1, 2 },
+                                                                     { 2 },
+                                                                     SCORTCH_DTYPE_FLOAT64);
+  g_autoptr(GAsyncResult) result = nullptr;
+
+  ASSERT_THAT (module, Not (IsNull ()));
+
+  scortch_module_forward_async (module, &input, 1, nullptr, store_result, &result);
+
+  while (result == nullptr)
+    g_main_context_iteration (nullptr, TRUE);
+
+  g_autoptr(ScortchLocalTensor) output = scortch_module_forward_finish (module, result, &error);
+
+  EXPECT_THAT (output, IsNull ());
+  EXPECT_TRUE (g_error_matches (error, SCORTCH_ERROR, SCORTCH_ERROR_INVALID_OPERATION));
+}
+
+TEST (ScortchModule, missing_file_sets_error)
+{
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(ScortchModule) module = scortch_module_new_from_file ("/nonexistent/module.pt", &error);
+
+  EXPECT_THAT (module, IsNull ());
+  EXPECT_TRUE (g_error_matches (error, SCORTCH_ERROR, SCORTCH_ERROR_INVALID_MODULE));
+}
@@ -0,0 +1,158 @@
+/*
+ * /tests/scortch/storage-pool-test.cpp
+ *
+ * Tests for the scortch storage pool.
+ *
+ * Copyright (C) 2018 Sam Spilsbury.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <glib.h>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <scortch/local-tensor.h>
+#include <scortch/scortch-storage-pool.h>
+#include <scortch/scortch-storage-pool-internal.h>
+
+#include <scortch/tensor-test-helpers.h>
+
+using ::testing::ElementsAre;
+using ::testing::Eq;
+
+using scortch_test::bytes_of;
+using scortch_test::dimensions_variant;
+
+namespace {
+  /* A 2x2 float64 tensor, set from data so that the storage
+   * is allocated by scortch itself. */
+  ScortchLocalTensor * new_matrix ()
+  {
+    return static_cast <ScortchLocalTensor *> (g_object_new (SCORTCH_TYPE_LOCAL_TENSOR,
+                                                             "data", g_variant_new_parsed ("[<[1.0, 2.0]>, <[3.0, 4.0]>]"),
+                                                             NULL));
+  }
+
+  class ScortchStoragePoolTest :
+    public ::testing::Test
+  {
+    protected:
+      void SetUp () override
+      {
+        max_bytes = scortch_storage_pool_get_max_bytes ();
+        scortch_storage_pool_set_enabled (TRUE);
+      }
+
+      void TearDown () override
+      {
+        scortch_storage_pool_set_enabled (FALSE);
+        scortch_storage_pool_set_max_bytes (max_bytes);
+      }
+
+      guint64 max_bytes = 0;
+  };
+}
+
+TEST (ScortchStoragePool, disabled_by_default)
+{
+  guint64 misses = scortch_storage_pool_get_misses ();
+  g_autoptr(ScortchLocalTensor) tensor = new_matrix ();
+
+  EXPECT_FALSE (scortch_storage_pool_get_enabled ());
+  EXPECT_THAT (scortch_storage_pool_get_misses (), Eq (misses));
+}
+
+TEST_F (ScortchStoragePoolTest, finalized_storage_is_reused)
+{
+  guint64 hits = scortch_storage_pool_get_hits ();
+  guint64 misses = scortch_storage_pool_get_misses ();
+
+  g_object_unref (new_matrix ());
+
+  /* Blocks are rounded up to a multiple of 64 bytes */
+  EXPECT_THAT (scortch_storage_pool_get_misses (), Eq (misses + 1));
+  EXPECT_THAT (scortch_storage_pool_get_cached_bytes (), Eq (64u));
+
+  g_autoptr(ScortchLocalTensor) tensor = new_matrix ();
+
+  EXPECT_THAT (scortch_storage_pool_get_hits (), Eq (hits + 1));
+  EXPECT_THAT (scortch_storage_pool_get_cached_bytes (), Eq (0u));
+  EXPECT_THAT (bytes_of <double> (tensor), ElementsAre (1, 2, 3, 4));
+}
+
+TEST_F (ScortchStoragePoolTest, storage_beyond_max_bytes_is_freed)
+{
+  scortch_storage_pool_set_max_bytes (16);
+
+  g_object_unref (new_matrix ());
+
+  EXPECT_THAT (scortch_storage_pool_get_cached_bytes (), Eq (0u));
+}
+
+TEST_F (ScortchStoragePoolTest, lowering_max_bytes_trims)
+{
+  g_object_unref (new_matrix ());
+  scortch_storage_pool_set_max_bytes (0);
+
+  EXPECT_THAT (scortch_storage_pool_get_cached_bytes (), Eq (0u));
+}
+
+TEST_F (ScortchStoragePoolTest, disabling_frees_cached_storage)
+{
+  g_object_unref (new_matrix ());
+  scortch_storage_pool_set_enabled (FALSE);
+
+  EXPECT_THAT (scortch_storage_pool_get_cached_bytes (), Eq (0u));
+}
+
+TEST_F (ScortchStoragePoolTest, trim_frees_cached_storage)
+{
+  g_object_unref (new_matrix ());
+  scortch_storage_pool_trim ();
+
+  EXPECT_TRUE (scortch_storage_pool_get_enabled ());
+  EXPECT_THAT (scortch_storage_pool_get_cached_bytes (), Eq (0u));
+}
+
+TEST_F (ScortchStoragePoolTest, pooled_tensor_can_grow)
+{
+  g_autoptr(ScortchLocalTensor) tensor = new_matrix ();
+
+  scortch_local_tensor_set_dimensions (tensor, dimensions_variant ({ 3, 2 }));
+
+  std::vector <double> values (bytes_of <double> (tensor));
+
+  ASSERT_THAT (values.size (), Eq (6u));
+  EXPECT_THAT (std::vector <double> (values.begin (), values.begin () + 4), ElementsAre (1, 2, 3, 4));
+}
+
+TEST_F (ScortchStoragePoolTest, failed_allocation_raises_torch_error)
+{
+  /* Far more than any test machine can allocate, so that
+   * posix_memalign fails and torch::empty reports it */
+  EXPECT_THROW (scortch_storage_pool_empty ({ G_GINT64_CONSTANT (1) << 40 }, at::kDouble),
+                c10::Error);
+}
+
+TEST_F (ScortchStoragePoolTest, overflowing_size_raises_torch_error)
+{
+  guint64 misses = scortch_storage_pool_get_misses ();
+
+  EXPECT_THROW (scortch_storage_pool_empty ({ G_GINT64_CONSTANT (1) << 62, 4 }, at::kDouble),
+                c10::Error);
+  EXPECT_THAT (scortch_storage_pool_get_misses (), Eq (misses));
+}
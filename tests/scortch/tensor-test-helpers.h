@@ -0,0 +1,78 @@
+/*
+ * /tests/scortch/tensor-test-helpers.h
+ *
+ * Helpers shared between the scortch library tests.
+ *
+ * Copyright (C) 2018 Sam Spilsbury.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include <glib.h>
+
+#include <scortch/local-tensor.h>
+#include <scortch/local-tensor-operations.h>
+
+namespace scortch_test
+{
+  inline std::vector <int64_t> dimensions_of (ScortchLocalTensor *tensor)
+  {
+    size_t n_dimensions;
+    int64_t const *dimensions =
+      static_cast <int64_t const *> (g_variant_get_fixed_array (scortch_local_tensor_get_dimensions (tensor),
+                                                                &n_dimensions,
+                                                                sizeof (int64_t)));
+    return std::vector <int64_t> (dimensions, dimensions + n_dimensions);
+  }
+
+  template <typename T>
+  inline std::vector <T> bytes_of (ScortchLocalTensor *tensor)
+  {
+    g_autoptr(GBytes) bytes = scortch_local_tensor_get_bytes (tensor);
+    size_t size;
+    T const *data = static_cast <T const *> (g_bytes_get_data (bytes, &size));
+
+    return std::vector <T> (data, data + size / sizeof (T));
+  }
+
+  inline GVariant * dimensions_variant (std::vector <int64_t> const &dimensions)
+  {
+    return g_variant_new_fixed_array (G_VARIANT_TYPE ("x"),
+                                      static_cast <gconstpointer> (dimensions.data ()),
+                                      dimensions.size (),
+                                      sizeof (int64_t));
+  }
+
+  /* Create a tensor holding a copy of values. Tensors made
+   * directly over a GBytes are read-only, so the elements are
+   * cloned into storage that tests can modify in place. */
+  template <typename T>
+  inline ScortchLocalTensor * tensor_from_values (std::vector <T> const       &values,
+                                                  std::vector <int64_t> const &dimensions,
+                                                  ScortchDType                 dtype)
+  {
+    g_autoptr(GBytes) bytes = g_bytes_new (values.data (), values.size () * sizeof (T));
+    g_autoptr(ScortchLocalTensor) read_only = scortch_local_tensor_new_from_bytes (bytes,
+                                                                                   dimensions_variant (dimensions),
+                                                                                   dtype,
+                                                                                   nullptr);
+
+    return scortch_local_tensor_clone (read_only, nullptr);
+  }
+}
@@ -0,0 +1,204 @@
+/*
+ * /tests/scortch/tracing-test.cpp
+ *
+ * Tests for scortch tracing.
+ *
+ * Copyright (C) 2018 Sam Spilsbury.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <unistd.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <scortch/local-tensor.h>
+#include <scortch/local-tensor-operations.h>
+#include <scortch/scortch-tracing.h>
+
+#include <scortch/tensor-test-helpers.h>
+
+using ::testing::EndsWith;
+using ::testing::Eq;
+using ::testing::HasSubstr;
+using ::testing::Not;
+using ::testing::StartsWith;
+
+using scortch_test::tensor_from_values;
+
+namespace {
+  struct Counter
+  {
+    guint64 calls = 0;
+    guint64 bytes = 0;
+    guint64 nanoseconds = 0;
+  };
+
+  Counter lookup_counter (char const *name)
+  {
+    g_autoptr(GVariant) counters = scortch_tracing_get_counters ();
+    Counter counter;
+
+    g_variant_lookup (counters,
+                      name,
+                      "(ttt)",
+                      &counter.calls,
+                      &counter.bytes,
+                      &counter.nanoseconds);
+
+    return counter;
+  }
+
+  GVariant * matrix_data ()
+  {
+    return g_variant_new_parsed ("[<[1.0, 2.0, 3.0]>, <[4.0, 5.0, 6.0]>]");
+  }
+
+  class ScortchTracingTest :
+    public ::testing::Test
+  {
+    protected:
+      void SetUp () override
+      {
+        scortch_tracing_disable ();
+        scortch_tracing_reset_counters ();
+      }
+
+      void TearDown () override
+      {
+        scortch_tracing_disable ();
+        scortch_tracing_reset_counters ();
+      }
+  };
+}
+
+TEST_F (ScortchTracingTest, nothing_counted_when_disabled)
+{
+  g_autoptr(ScortchLocalTensor) tensor = scortch_local_tensor_new ();
+
+  ASSERT_TRUE (scortch_local_tensor_set_data (tensor, matrix_data (), nullptr));
+
+  EXPECT_FALSE (scortch_tracing_is_enabled ());
+  EXPECT_THAT (lookup_counter ("set-data").calls, Eq (0u));
+}
+
+TEST_F (ScortchTracingTest, counts_calls_and_bytes_of_set_data)
+{
+  g_autoptr(ScortchLocalTensor) tensor = scortch_local_tensor_new ();
+
+  ASSERT_TRUE (scortch_tracing_enable (nullptr, nullptr));
+  ASSERT_TRUE (scortch_local_tensor_set_data (tensor, matrix_data (), nullptr));
+  ASSERT_TRUE (scortch_local_tensor_set_data (tensor, matrix_data (), nullptr));
+
+  Counter fill = lookup_counter ("set-data-fill");
+
+  EXPECT_THAT (lookup_counter ("set-data").calls, Eq (2u));
+  EXPECT_THAT (lookup_counter ("set-data-layout").calls, Eq (2u));
+  EXPECT_THAT (fill.calls, Eq (2u));
+  EXPECT_THAT (fill.bytes, Eq (2 * 6 * sizeof (double)));
+}
+
+TEST_F (ScortchTracingTest, counts_torch_compute)
+{
+  g_autoptr(ScortchLocalTensor) left = tensor_from_values <double> ({ 1, 2 }, { 2 }, SCORTCH_DTYPE_FLOAT64);
+  g_autoptr(ScortchLocalTensor) right = tensor_from_values <double> ({ 3, 4 }, { 2 }, SCORTCH_DTYPE_FLOAT64);
+
+  ASSERT_TRUE (scortch_tracing_enable (nullptr, nullptr));
+
+  g_autoptr(ScortchLocalTensor) sum = scortch_local_tensor_add (left, right, nullptr);
+
+  EXPECT_THAT (lookup_counter ("torch-compute").calls, Eq (1u));
+}
+
+TEST_F (ScortchTracingTest, reset_counters)
+{
+  g_autoptr(ScortchLocalTensor) tensor = scortch_local_tensor_new ();
+
+  ASSERT_TRUE (scortch_tracing_enable (nullptr, nullptr));
+  ASSERT_TRUE (scortch_local_tensor_set_data (tensor, matrix_data (), nullptr));
+
+  scortch_tracing_reset_counters ();
+
+  EXPECT_THAT (lookup_counter ("set-data").calls, Eq (0u));
+}
+
+TEST_F (ScortchTracingTest, writes_trace_events)
+{
+  g_autoptr(GError) error = nullptr;
+  g_autofree char *path = nullptr;
+  int fd = g_file_open_tmp ("scortch-trace-XXXXXX.json", &path, &error);
+
+  ASSERT_NE (fd, -1) << error->message;
+  close (fd);
+
+  g_autoptr(ScortchLocalTensor) tensor = scortch_local_tensor_new ();
+
+  ASSERT_TRUE (scortch_tracing_enable (path, &error)) << error->message;
+  ASSERT_TRUE (scortch_local_tensor_set_data (tensor, matrix_data (), nullptr));
+  g_autoptr(GVariant) data = scortch_local_tensor_get_data (tensor, nullptr);
+  scortch_tracing_disable ();
+
+  g_autofree char *contents = nullptr;
+  ASSERT_TRUE (g_file_get_contents (path, &contents, nullptr, &error)) << error->message;
+  g_unlink (path);
+
+  EXPECT_THAT (contents, StartsWith ("["));
+  EXPECT_THAT (contents, HasSubstr ("\"name\": \"set-data\""));
+  EXPECT_THAT (contents, HasSubstr ("\"name\": \"get-data\""));
+  EXPECT_THAT (contents, HasSubstr ("\"ph\": \"X\""));
+  EXPECT_THAT (contents, EndsWith ("]\n"));
+}
+
+TEST_F (ScortchTracingTest, enable_again_with_same_path_restarts_trace)
+{
+  g_autoptr(GError) error = nullptr;
+  g_autofree char *path = nullptr;
+  int fd = g_file_open_tmp ("scortch-trace-XXXXXX.json", &path, &error);
+
+  ASSERT_NE (fd, -1) << error->message;
+  close (fd);
+
+  g_autoptr(ScortchLocalTensor) tensor = scortch_local_tensor_new ();
+
+  ASSERT_TRUE (scortch_tracing_enable (path, &error)) << error->message;
+  g_autoptr(GVariant) data = scortch_local_tensor_get_data (tensor, nullptr);
+  ASSERT_TRUE (scortch_tracing_enable (path, &error)) << error->message;
+  ASSERT_TRUE (scortch_local_tensor_set_data (tensor, matrix_data (), nullptr));
+  scortch_tracing_disable ();
+
+  g_autofree char *contents = nullptr;
+  ASSERT_TRUE (g_file_get_contents (path, &contents, nullptr, &error)) << error->message;
+  g_unlink (path);
+
+  /* Only the second trace is left, and it is terminated once */
+  EXPECT_THAT (contents, StartsWith ("[\n"));
+  EXPECT_THAT (contents, HasSubstr ("\"name\": \"set-data\""));
+  EXPECT_THAT (contents, Not (HasSubstr ("\"name\": \"get-data\"")));
+  EXPECT_THAT (contents, EndsWith ("]\n"));
+  EXPECT_THAT (g_strstr_len (contents, -1, "\n]"), Eq (g_strrstr (contents, "\n]")));
+}
+
+TEST_F (ScortchTracingTest, enable_fails_for_unwritable_trace_file)
+{
+  g_autoptr(GError) error = nullptr;
+
+  EXPECT_FALSE (scortch_tracing_enable ("/nonexistent-directory/trace.json", &error));
+  EXPECT_TRUE (g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT));
+  EXPECT_FALSE (scortch_tracing_is_enabled ());
+}